@@ -17,6 +17,20 @@
 
 #include "audioconfig.h"
 
+std::string getStr(const BackpressurePolicy& policy) noexcept
+{
+    switch (policy) {
+    case BackpressurePolicy::DropOldest:
+        return "Drop Oldest";
+    case BackpressurePolicy::SkipFrames:
+        return "Skip Frames";
+    case BackpressurePolicy::ReduceLoad:
+        return "Reduce Load";
+    }
+
+    return "";
+}
+
 std::vector<size_t> AudioConfig::getPossibleAnalysisSampleRates() noexcept
 {
     std::vector<size_t> rates;
@@ -27,6 +41,53 @@ std::vector<size_t> AudioConfig::getPossibleAnalysisSampleRates() noexcept
     return rates;
 }
 
+unsigned int AudioConfig::getCaptureChannelCount() const noexcept
+{
+    return inputChannelCount + (internalReference ? 0U : 1U);
+}
+
+unsigned int AudioConfig::getPlaybackChannelCount() const noexcept
+{
+    // the stimulus is mono anyway. two channels so both sides of a stereo output get it.
+    return std::min(getCaptureChannelCount(), 2U);
+}
+
+unsigned int AudioConfig::getReferenceChannel() const noexcept
+{
+    return inputAndReferenceAreSwapped ? inputChannelCount : 0U;
+}
+
+unsigned int AudioConfig::getInputChannel(unsigned int input) const noexcept
+{
+    if (internalReference || inputAndReferenceAreSwapped) {
+        return input;
+    }
+
+    return input + 1;
+}
+
+size_t AudioConfig::getCaptureBufferSamples() const noexcept
+{
+    auto samples = static_cast<size_t>(captureBufferSeconds * static_cast<double>(sampleRate));
+    return std::max(samples, 2 * LAA_MAX_FFT_LENGTH);
+}
+
+size_t AudioConfig::getHopSamples(bool reduced) const noexcept
+{
+    if (reduced) {
+        return analysisSamples;
+    }
+
+    auto hop = static_cast<size_t>(std::round(static_cast<double>(analysisSamples) * (1.0 - std::clamp(overlap, 0.0, 0.99))));
+    return std::clamp(hop, static_cast<size_t>(1), analysisSamples);
+}
+
+size_t AudioConfig::getHistoryFrames() const noexcept
+{
+    size_t frameBytes = std::max(inputChannelCount, 1U) * StateData::getBlockSize(analysisSamples) * sizeof(double);
+    return historyMegabytes * 1024 * 1024 / std::max(frameBytes, static_cast<size_t>(1));
+}
+
 double AudioConfig::samplesToSeconds(size_t count) const noexcept
 {
     return static_cast<double>(count) / static_cast<double>(sampleRate);
@@ -54,3 +115,9 @@ std::vector<unsigned int> AudioConfig::getLegalSampleRates() noexcept
     }
     return result;
 }
+
+SampleFormat AudioConfig::getNativeSampleFormat() const noexcept
+{
+    // rtaudio opens both directions with the same format, so it has to be native to both
+    return pickNativeFormat(captureDevice.nativeFormats & playbackDevice.nativeFormats);
+}
@@ -18,11 +18,31 @@
 #ifndef laa_audioconfig_h
 #define laa_audioconfig_h
 
-#include "../shared.h"
+#include "../core.h"
 #include "../state/state.h"
+#include "sampleformat.h"
 
 #include <rtaudio/RtAudio.h>
 
+/**
+ * \brief What the processing does when it cannot keep up with the capture
+ */
+enum class BackpressurePolicy {
+    /// jump ahead to the newest data, dropping everything in between
+    DropOldest,
+    /// skip every other frame until caught up
+    SkipFrames,
+    /// stop overlapping frames and skip optional processing until caught up
+    ReduceLoad
+};
+
+/**
+ * \brief Convert the BackpressurePolicy enum to a string
+ * \param policy BackpressurePolicy to stringify
+ * \return policy as a string
+ */
+std::string getStr(const BackpressurePolicy& policy) noexcept;
+
 /**
  * \brief Configuration for the audio capture and playback.
  */
@@ -33,6 +53,10 @@ struct AudioConfig {
     static constexpr size_t defaultAnalysisSamples = 32768;
     /// Default size of the Buffer for the callbacks
     static constexpr int defaultBufferFrames = 512;
+    /// Default length of the capture ring
+    static constexpr double defaultCaptureBufferSeconds = 10.0;
+    /// Default memory for the frame history
+    static constexpr size_t defaultHistoryMegabytes = 256;
 
     /// RTAudio Capture Device
     RtAudio::DeviceInfo captureDevice = {};
@@ -52,10 +76,70 @@ struct AudioConfig {
     RtAudio::StreamParameters captureParams = {};
     /// Buffer of bytes for the callback
     unsigned int bufferFrames = defaultBufferFrames;
-    /// True if output and reference are swapped on the input side
+    /// Upper limit for inputChannelCount
+    static constexpr unsigned int maxInputChannels = 32;
+
+    /// True if the reference is on the last instead of the first capture channel
     bool inputAndReferenceAreSwapped = false;
-    /// Set to 2 for external, to 1 for internal reference
-    unsigned int channelCount = 2;
+    /// True if the playback signal is used as reference, instead of a capture channel
+    bool internalReference = false;
+    /// Number of measurement channels. All of them are measured against the same reference.
+    unsigned int inputChannelCount = 1;
+    /// Format the stream is opened with. Picked from the native formats of the devices on start.
+    SampleFormat sampleFormat = SampleFormat::Float32;
+
+    /// Seconds of audio the capture ring holds before samples get lost
+    double captureBufferSeconds = defaultCaptureBufferSeconds;
+    /// How much consecutive analysis frames overlap. 0 for none, 0.5 for half a frame etc.
+    double overlap = 0.0;
+    /// What to do if the processing falls behind
+    BackpressurePolicy backpressurePolicy = BackpressurePolicy::DropOldest;
+    /// Memory the history of processed frames may use. 0 turns it off.
+    size_t historyMegabytes = defaultHistoryMegabytes;
+
+    /**
+     * \brief Number of channels we capture: all inputs, plus one for an external reference
+     * \return capture channel count
+     */
+    [[nodiscard]] unsigned int getCaptureChannelCount() const noexcept;
+
+    /**
+     * \brief Number of channels we play back on. The signal is the same on all of them.
+     * \return playback channel count
+     */
+    [[nodiscard]] unsigned int getPlaybackChannelCount() const noexcept;
+
+    /**
+     * \brief Capture channel that carries the external reference
+     * \return index into the captured channels. Only meaningful without internalReference.
+     */
+    [[nodiscard]] unsigned int getReferenceChannel() const noexcept;
+
+    /**
+     * \brief Capture channel that carries a measurement input
+     * \param input index of the input, 0..inputChannelCount
+     * \return index into the captured channels
+     */
+    [[nodiscard]] unsigned int getInputChannel(unsigned int input) const noexcept;
+
+    /**
+     * \brief Size of the capture ring. Always holds at least two of the longest analysis frames.
+     * \return samples per channel
+     */
+    [[nodiscard]] size_t getCaptureBufferSamples() const noexcept;
+
+    /**
+     * \brief Distance between the starts of two analysis frames
+     * \param reduced true if the overlap should be ignored (see BackpressurePolicy::ReduceLoad)
+     * \return hop size in samples, at least 1
+     */
+    [[nodiscard]] size_t getHopSamples(bool reduced = false) const noexcept;
+
+    /**
+     * \brief Number of processed frames that fit into historyMegabytes
+     * \return frame count, with all input channels
+     */
+    [[nodiscard]] size_t getHistoryFrames() const noexcept;
 
     /**
      * \brief Return the number of possible fft lengths
@@ -82,6 +166,12 @@ struct AudioConfig {
      * \return A vector containing the sample rates
      */
     [[nodiscard]] std::vector<unsigned int> getLegalSampleRates() noexcept;
+
+    /**
+     * \brief Return the best sample format both the input and the output device support natively
+     * \return The format to open the stream with
+     */
+    [[nodiscard]] SampleFormat getNativeSampleFormat() const noexcept;
 };
 
 #endif //laa_audioconfig_h
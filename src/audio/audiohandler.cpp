@@ -16,6 +16,33 @@
  */
 
 #include "audiohandler.h"
+#include "../prefpath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+std::string getStr(const FunctionGeneratorType& gen) noexcept
+{
+    switch (gen) {
+    case FunctionGeneratorType::Silence:
+        return "Silence";
+
+    case FunctionGeneratorType::WhiteNoise:
+        return "White Noise";
+
+    case FunctionGeneratorType::PinkNoise:
+        return "Pink Noise";
+
+    case FunctionGeneratorType::Sine:
+        return "Sine";
+
+    case FunctionGeneratorType::Sweep:
+        return "Sweep";
+    }
+
+    return "";
+}
 
 template <class T>
 void clearStateQueue(std::queue<T>& q)
@@ -24,13 +51,9 @@ void clearStateQueue(std::queue<T>& q)
     std::swap(q, empty);
 }
 
-AudioHandler::AudioHandler() noexcept
+AudioHandler::AudioHandler(std::chrono::steady_clock::time_point launchTime) noexcept
 {
     rtAudio = std::make_unique<RtAudio>();
-    if (rtAudio == nullptr) {
-        std::cout << "Could not start audio driver";
-        SDL_assert_always(false);
-    }
 
     // some defaults
     config.captureDevice = rtAudio->getDeviceInfo(rtAudio->getDefaultInputDevice());
@@ -45,28 +68,17 @@ AudioHandler::AudioHandler() noexcept
     // check if we have wisdom available
     // wisdom is this magic "resource" coming from fftw
     // essentially it saves what it knows about the most performant way to calc to the drive
-    // we ask sdl for the path. i didnt ad that function to sdl2wrap yet, so yeah
-    auto* pWisdomPath = SDL_GetPrefPath("mkalte", "laa");
-    std::string wisdomPath = pWisdomPath;
-    SDL_free(pWisdomPath); // yep
-
-    wisdomPath += "/fftwWisdom" + getVersionString() + ".fftw";
-    // try to import wisdom. this fails gracefully if it doesn't work, so we do not care
-    static_cast<void>(fftw_import_wisdom_from_filename(wisdomPath.c_str()));
-
-    // populate state pool
-    // due to the nature for fftw, this might take a while...
-    // state creation creates the fftw things!
-    for (auto rate : AudioConfig::getPossibleAnalysisSampleRates()) {
-        StatePoolArray pool;
-        for (auto& state : pool) {
-            state = std::make_shared<State>(rate);
-        }
-        statePool[rate] = pool;
-    }
+    // it lives where sdl would put it, but we do not need sdl for that
+    prefPath = getPrefPath();
+
+    // wisdom is only good for the cpu it was measured on, so the file is named after it.
+    // the background planner adds to it whenever it measured something new.
+    static_cast<void>(setFftWisdomPath(prefPath + "/" + getFftWisdomFileName()));
 
-    // save wisdom. see above
-    fftw_export_wisdom_to_filename(wisdomPath.c_str());
+    // populate state pool, just for the length we start with.
+    // the states start out with estimated plans, so this is quick. measured ones are swapped in once they are done.
+    // only one channel here, more are added on start if needed
+    ensureStatePool(config.analysisSamples);
 
     // reset everything
     resetStates();
@@ -76,11 +88,15 @@ AudioHandler::AudioHandler() noexcept
         this->processingWorker();
     });
 
+    auto setupTime = std::chrono::steady_clock::now() - launchTime;
+    startupStats.coldStartMicros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(setupTime).count());
+
     // and done!
 }
 
 AudioHandler::~AudioHandler() noexcept
 {
+    stopFileAnalysis();
     if (running) {
         stopAudio();
         rtAudio.reset();
@@ -94,32 +110,126 @@ AudioHandler::~AudioHandler() noexcept
     statePool.clear();
 }
 
+bool AudioHandler::start(const AudioConfig& newConfig, const StateFilterConfig& filterConfig, FunctionGeneratorType generator, bool simulated) noexcept
+{
+    config = newConfig;
+    stateFilterConfig.windowFilter = filterConfig.windowFilter;
+    stateFilterConfig.avgCount = filterConfig.avgCount;
+    stateFilterConfig.rejectDiscontinuous = filterConfig.rejectDiscontinuous;
+    functionGeneratorType = generator;
+    useLoopback = simulated;
+    avgResetRequested = true;
+
+    startAudio();
+    return running;
+}
+
+void AudioHandler::stop() noexcept
+{
+    stopAudio();
+    status = "Stopped";
+}
+
+const std::string& AudioHandler::getStatus() const noexcept
+{
+    return status;
+}
+
 void AudioHandler::startAudio()
 {
+    // time to first frame includes setting up the states and opening the devices
+    audioStartTime = std::chrono::steady_clock::now();
+    startupStats.firstFrameMicros = 0;
+
     // make sure the generators have the right rate
     sineGenerator.setSampleRate(config.sampleRate);
     sweepGenerator.setSampleRate(config.sampleRate);
     sweepGenerator.setLength(static_cast<double>(config.analysisSamples) / config.sampleRate);
 
     // set up channel count for internal vs. external reference
-    config.playbackParams.nChannels = config.channelCount;
-    config.captureParams.nChannels = config.channelCount;
+    config.playbackParams.nChannels = config.getPlaybackChannelCount();
+    config.captureParams.nChannels = config.getCaptureChannelCount();
 
     // assure we are not running anymore
     stopAudio();
+    stopFileAnalysis();
 
-    // opens the streams. this throws if there is an error. let it crash for now.
-    try {
-        rtAudio->openStream(&config.playbackParams, &config.captureParams, RTAUDIO_FLOAT32, config.sampleRate, &config.bufferFrames, &rtAudioCallback, this);
-        rtAudio->startStream();
-    } catch (const RtAudioError& error) {
-        status = std::string("Error: ") + error.getMessage();
-        running = false;
-        return;
+    // the input channel count might have changed, so the frames might need more states
+    ensureStatePool(config.analysisSamples);
+    resetStates();
+
+    // the ring outlives any analysis frame, so it is sized once here and not on length changes
+    ringLock.lock();
+    captureRing.configure(config.inputChannelCount + 1, config.getCaptureBufferSamples());
+    ringLock.unlock();
+    streamPosition = 0;
+    captureOverflowing = false;
+    reducedLoad = false;
+
+    // the ring is new memory, so it is not locked yet if the lock could not cover later allocations
+    if (lockMemory) {
+        auto error = lockProcessMemory(true);
+        if (!error.empty()) {
+            tuningStatus = error;
+        }
+    }
+
+    // the callback has to be more important than the processing, otherwise the processing starves it
+    RtAudio::StreamOptions streamOptions = {};
+    if (processingTuning.priority != ThreadPriority::Normal) {
+        streamOptions.flags = RTAUDIO_SCHEDULE_REALTIME;
+        streamOptions.priority = std::min(processingTuning.priorityLevel + 1, ThreadTuning::maxPriorityLevel);
+    }
+
+    // everything from here on is measured fresh
+    stats.reset();
+    processingStats.reset();
+    dutError = {};
+
+    if (useLoopback) {
+        // the simulated device has no driver that could change anything, and it speaks float
+        config.sampleFormat = SampleFormat::Float32;
+        playbackBuffer.resize(std::max(config.bufferFrames, 1U));
+        captureTargets.resize(config.getCaptureChannelCount());
+        recordSources.resize(captureRing.getChannelCount());
+
+        // the echo is a two tap fir: the direct sound and one reflection
+        dutSettings.firTaps.clear();
+        auto echoSamples = static_cast<size_t>(std::clamp(echoMs, 0.0, DutSettings::maxDelayMs) / 1000.0 * config.sampleRate);
+        if (echoSamples > 0) {
+            dutSettings.firTaps.resize(echoSamples + 1, 0.0);
+            dutSettings.firTaps.front() = 1.0;
+            dutSettings.firTaps.back() = echoGain;
+        }
+        loopback.start(config, dutSettings, loopbackPace, &rtAudioCallback, this);
+    } else {
+        // take whatever the devices deliver natively, so the driver does not need to convert
+        config.sampleFormat = config.getNativeSampleFormat();
+
+        // opens the streams. this throws if there is an error. let it crash for now.
+        try {
+            rtAudio->openStream(&config.playbackParams, &config.captureParams, toRtAudioFormat(config.sampleFormat), config.sampleRate, &config.bufferFrames, &rtAudioCallback, this, &streamOptions);
+            // the driver might have changed bufferFrames, so size the scratch space only now
+            playbackBuffer.resize(std::max(config.bufferFrames, 1U));
+            captureTargets.resize(config.getCaptureChannelCount());
+            recordSources.resize(captureRing.getChannelCount());
+            rtAudio->startStream();
+        } catch (const RtAudioError& error) {
+            status = std::string("Error: ") + error.getMessage();
+            running = false;
+            return;
+        }
     }
 
     running = true;
-    status = std::string("Running");
+    waitingForFirstFrame = true;
+    status = std::string(useLoopback ? "Running (Simulated)" : "Running");
+
+    // everything that goes wrong from here on ends up in the log
+    std::lock_guard<std::mutex> guard(logLock);
+    loggedStats = 0;
+    statsLog.open(prefPath + "/audio.log", std::ios::app);
+    statsLog << "start: " << config.sampleRate << "Hz, " << config.getCaptureChannelCount() << " channels, " << getStr(config.sampleFormat) << ", " << config.bufferFrames << " frames buffer" << std::endl;
 }
 
 void AudioHandler::stopAudio()
@@ -127,33 +237,235 @@ void AudioHandler::stopAudio()
     // just kill of rtaudio
     if (running) {
         resetStates();
-        rtAudio->stopStream();
-        rtAudio->closeStream();
+        if (loopback.isRunning()) {
+            loopback.stop();
+        } else {
+            rtAudio->stopStream();
+            rtAudio->closeStream();
+        }
+        stopRecording();
+        std::lock_guard<std::mutex> guard(logLock);
+        statsLog << "stop: " << stats.toString() << std::endl;
+        statsLog << "processing: " << processingStats.toString() << std::endl;
+        statsLog << "startup: " << startupStats.toString() << std::endl;
+        statsLog.close();
     }
 
     running = false;
 }
 
+void AudioHandler::startFileAnalysis() noexcept
+{
+    stopFileAnalysis();
+
+    if (!fileSource.open(filePath, rawFormat, static_cast<size_t>(rawChannelCount), static_cast<unsigned int>(rawSampleRate))) {
+        fileStatus = fileSource.getError();
+        return;
+    }
+
+    // the states get their rate and length from the config
+    config.sampleRate = fileSource.getSampleRate();
+    resetStates();
+
+    auto settings = OfflineAnalyzer::fromConfig(config, fileSource.getChannelCount());
+    settings.filterConfig.windowFilter = stateFilterConfig.windowFilter;
+    settings.filterConfig.avgCount = stateFilterConfig.avgCount;
+    settings.filterConfig.rejectDiscontinuous = stateFilterConfig.rejectDiscontinuous;
+
+    fileStatus = "Analyzing";
+    analyzingFile = true;
+    fileThread = std::thread([this, settings]() {
+        offlineAnalyzer.run(fileSource, settings, &workerPool);
+
+        // whatever we got, even if cancelled, is worth a look
+        if (offlineAnalyzer.getFramesDone() > 0) {
+            auto result = std::make_shared<StateFrame>(offlineAnalyzer.takeResult());
+            processingLock.lock();
+            std::atomic_store(&doneFrame, result);
+            ++frameCount;
+            processingLock.unlock();
+        }
+        analyzingFile = false;
+    });
+}
+
+void AudioHandler::stopFileAnalysis() noexcept
+{
+    if (fileThread.joinable()) {
+        offlineAnalyzer.cancel();
+        fileThread.join();
+    }
+}
+
+void AudioHandler::startRecording() noexcept
+{
+    // one file per session, named after when it started
+    auto now = std::time(nullptr);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    std::array<char, 32> timeString = {};
+    std::strftime(timeString.data(), timeString.size(), "%Y%m%d-%H%M%S", &local);
+    std::string path = prefPath + "/laa-" + timeString.data() + getExtension(recordingFormat);
+
+    if (!recorder.start(path, recordingFormat, captureRing.getChannelCount(), config.sampleRate)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(logLock);
+    statsLog << "recording: " << path << ", " << captureRing.getChannelCount() << " channels, reference first" << std::endl;
+}
+
+void AudioHandler::stopRecording() noexcept
+{
+    if (!recorder.isRecording()) {
+        return;
+    }
+
+    recorder.stop();
+    std::lock_guard<std::mutex> guard(logLock);
+    statsLog << "recording stopped: " << recorder.getBytesWritten() << " bytes written, " << recorder.getBytesLost() << " bytes lost" << std::endl;
+}
+
 void AudioHandler::resetStates() noexcept
 {
-    // halt the audio world
+    // halt the processing world. the callback keeps on going, it does not care.
+    ringLock.lock();
     processingLock.lock();
-    callbackLock.lock();
+    poolLock.lock();
 
     // clear them all
-    doneState = nullptr;
-    captureState = nullptr;
-    clearStateQueue(unusedStates);
-    clearStateQueue(processStates);
+    retireFrame(std::atomic_exchange(&doneFrame, FramePtr(nullptr)));
+    clearStateQueue(unusedFrames);
+
+    // whatever is in the ring was captured with the old settings
+    captureRing.consume(captureRing.getReadable());
+
+    // the history outlives stopping, but not a change of length or channels
+    historyLock.lock();
+    resizeHistory();
+    historyLock.unlock();
 
-    // fill in the proper ones
-    for (auto& state : statePool[config.analysisSamples]) {
-        unusedStates.push(state);
+    // fill in the proper ones. frames somebody still holds wait until they are let go of.
+    for (auto& frame : statePool[config.analysisSamples]) {
+        if (frame.use_count() == 1) {
+            unusedFrames.push(frame);
+        } else {
+            retireFrame(frame);
+        }
     }
 
     // can run again
-    callbackLock.unlock();
+    poolLock.unlock();
     processingLock.unlock();
+    ringLock.unlock();
+}
+
+void AudioHandler::ensureStatePool(size_t length) noexcept
+{
+    // build the new pool on the side, the old frames might still be in use somewhere
+    StatePoolArray pool;
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        pool = statePool[length];
+    }
+    pool.resize(std::max(pool.size(), basePoolFrames));
+
+    size_t channels = config.inputChannelCount;
+    bool changed = false;
+    for (auto& frame : pool) {
+        if (frame != nullptr && frame->size() == channels) {
+            continue;
+        }
+
+        // fresh states throughout. the old frame might still be read by the ui or the history, so none of its states may go back into the pool.
+        // the plans come from the cache, so this is just allocating.
+        auto rebuilt = std::make_shared<StateFrame>(channels);
+        for (auto& state : *rebuilt) {
+            state = std::make_shared<State>(length);
+        }
+        frame = rebuilt;
+        changed = true;
+    }
+
+    if (changed) {
+        std::lock_guard<std::mutex> guard(poolLock);
+        statePool[length] = pool;
+    }
+}
+
+AudioHandler::FramePtr AudioHandler::growStatePool(size_t length) noexcept
+{
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        if (statePool[length].size() >= basePoolFrames + config.getHistoryFrames()) {
+            return nullptr;
+        }
+    }
+
+    // only the processing thread grows the pool, so nobody else adds a frame while this one is built
+    auto frame = std::make_shared<StateFrame>(config.inputChannelCount);
+    for (auto& state : *frame) {
+        state = std::make_shared<State>(length);
+    }
+
+    std::lock_guard<std::mutex> guard(poolLock);
+    statePool[length].push_back(frame);
+    return frame;
+}
+
+void AudioHandler::resizeHistory() noexcept
+{
+    // keep the newest frames that still fit, the rest goes back to the pool once nobody holds it
+    std::vector<FramePtr> kept = {};
+    for (size_t age = 0; age < historyCount; ++age) {
+        const auto& frame = history[(historyNewest + history.size() - age) % history.size()];
+        if (frame->size() == config.inputChannelCount && (*frame)[0]->getData().fftLen == config.analysisSamples) {
+            kept.push_back(frame);
+        }
+    }
+
+    history.assign(config.getHistoryFrames(), nullptr);
+    historyCount = std::min(kept.size(), history.size());
+    historyNewest = historyCount > 0 ? historyCount - 1 : 0;
+    for (size_t age = 0; age < historyCount; ++age) {
+        history[historyNewest - age] = kept[age];
+    }
+}
+
+void AudioHandler::planAhead(size_t currentLength) noexcept
+{
+    // the lengths next to the current one are the most likely to be picked next, so they go first
+    auto lengths = AudioConfig::getPossibleAnalysisSampleRates();
+    auto distance = [currentLength](size_t length) {
+        return std::abs(std::log2(static_cast<double>(length)) - std::log2(static_cast<double>(currentLength)));
+    };
+    std::stable_sort(lengths.begin(), lengths.end(), [&distance](size_t a, size_t b) {
+        return distance(a) < distance(b);
+    });
+
+    // only the plans are made, the pool for a length is built once it is picked
+    for (auto length : lengths) {
+        State::plan(length);
+    }
+}
+
+void AudioHandler::applyTuning() noexcept
+{
+    // the ui only gets its cpus, a realtime ui thread would just fight the processing
+    ThreadTuning uiOnlyAffinity = {};
+    uiOnlyAffinity.affinityMask = uiTuning.affinityMask;
+
+    tuningStatus = applyThreadTuning(dataProcessor, processingTuning);
+    tuningStatus += workerPool.applyTuning(processingTuning);
+    tuningStatus += applyThreadTuning(uiOnlyAffinity);
+    tuningStatus += lockProcessMemory(lockMemory);
+    if (tuningStatus.empty()) {
+        tuningStatus = "Applied";
+    }
 }
 
 size_t AudioHandler::getFrameCount() const noexcept
@@ -161,6 +473,26 @@ size_t AudioHandler::getFrameCount() const noexcept
     return frameCount;
 }
 
+StateWindowFilter AudioHandler::getWindowFilter() const noexcept
+{
+    return stateFilterConfig.windowFilter;
+}
+
+const AudioStats& AudioHandler::getStats() const noexcept
+{
+    return stats;
+}
+
+const ProcessingStats& AudioHandler::getProcessingStats() const noexcept
+{
+    return processingStats;
+}
+
+const StartupStats& AudioHandler::getStartupStats() const noexcept
+{
+    return startupStats;
+}
+
 const AudioConfig& AudioHandler::getConfig() const noexcept
 {
     return config;
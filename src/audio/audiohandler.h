@@ -21,8 +21,21 @@
 #include "../dsp/pinknoisegenerator.h"
 #include "../dsp/sinegenerator.h"
 #include "../dsp/sweepgenerator.h"
+#include "../state/compactstate.h"
+#include "../state/roomacoustics.h"
+#include "../state/spectrogram.h"
+#include "../state/trigger.h"
+#include "../workerpool.h"
 #include "audioconfig.h"
+#include "audiostats.h"
+#include "capturering.h"
+#include "loopbackdevice.h"
+#include "offlineanalyzer.h"
+#include "recorder.h"
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <map>
 #include <mutex>
 #include <queue>
@@ -47,13 +60,26 @@ enum class FunctionGeneratorType {
  */
 std::string getStr(const FunctionGeneratorType& gen) noexcept;
 
+/**
+ * \brief A frame one of the trigger rules fired on
+ */
+struct TriggeredCapture {
+    /// one compact state per measurement channel
+    std::vector<std::shared_ptr<const CompactState>> channels = {};
+    /// the rules that fired
+    std::string reason = "";
+};
+
 /**
  * \brief Handles audio and audio UI config
  */
 class AudioHandler {
 public:
-    /// ctor
-    AudioHandler() noexcept;
+    /**
+     * \brief ctor. Probes the devices and sets up the states for the default length.
+     * \param launchTime when the program started, for StartupStats::coldStartMicros
+     */
+    explicit AudioHandler(std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now()) noexcept;
     /// deleted
     AudioHandler(const AudioHandler&) = delete;
     /// deleted
@@ -70,6 +96,27 @@ public:
      */
     void update() noexcept;
 
+    /**
+     * \brief Start capturing without the ui
+     * \param newConfig devices, channels and analysis settings
+     * \param filterConfig window and averaging, used for all channels
+     * \param generator what to play back
+     * \param simulated run against the simulated device instead of the sound card
+     * \return true if running. On failure, see getStatus().
+     */
+    bool start(const AudioConfig& newConfig, const StateFilterConfig& filterConfig, FunctionGeneratorType generator, bool simulated = false) noexcept;
+
+    /**
+     * \brief Stop capturing
+     */
+    void stop() noexcept;
+
+    /**
+     * \brief What the audio is up to
+     * \return status string
+     */
+    const std::string& getStatus() const noexcept;
+
     /**
      * \brief Gen number of frames
      * \note track the result and use it to check if there are any new frames around
@@ -78,10 +125,90 @@ public:
     size_t getFrameCount() const noexcept;
 
     /**
-     * \brief Get a copy of the data of the current state
-     * \return StateData of the current state
+     * \brief Get the data of the current state, without copying it
+     * \param channel the measurement channel to get the state of
+     * \return the current state. nullptr if there is none, or the channel does not exist.
+     *
+     * The snapshot does not change while it is held. Holding it keeps its frame from being reused,
+     * so let go of it once a newer one is around.
+     */
+    std::shared_ptr<const StateData> getSnapshot(size_t channel = 0) const noexcept;
+
+    /**
+     * \brief Take the frames the trigger rules fired on since the last call
+     * \return the captures, oldest first
+     */
+    std::vector<TriggeredCapture> takeTriggeredCaptures() noexcept;
+
+    /**
+     * \brief Number of frames in the history
+     * \return frame count. the newest one is the current frame.
+     */
+    size_t getHistorySize() const noexcept;
+
+    /**
+     * \brief Data of one channel of an older frame
+     * \param age how far back. 0 is the newest frame, getHistorySize() - 1 the oldest.
+     * \param channel the measurement channel
+     * \return the data, shared like getSnapshot(). nullptr if there is no such frame or channel.
+     */
+    std::shared_ptr<const StateData> getHistorySnapshot(size_t age, size_t channel = 0) const noexcept;
+
+    /**
+     * \brief Spectra of the last frames of one channel
+     * \return the spectrogram. safe to read from any thread.
+     */
+    const Spectrogram& getSpectrogram() const noexcept;
+
+    /**
+     * \brief Pick the channel the spectrogram shows. Changing it drops the rows it has.
+     * \param channel the measurement channel
+     */
+    void setSpectrogramChannel(size_t channel) noexcept;
+
+    /**
+     * \brief The channel the spectrogram shows
+     * \return the measurement channel
+     */
+    size_t getSpectrogramChannel() const noexcept;
+
+    /**
+     * \brief Have the processing work out the room acoustics of the frames for a while
+     *
+     * They cost an inverse dft per band, so they are only worked out while somebody shows them. Call it every time they are drawn.
+     * Until then, and a bit after the last call, StateData::acoustics of new frames is not valid.
+     */
+    void requestRoomAcoustics() noexcept;
+
+    /**
+     * \brief Number of measurement channels in the current frame
+     * \return channel count. 0 if there is no frame yet.
+     */
+    size_t getChannelCount() const noexcept;
+
+    /**
+     * \brief Window the frames are processed with
+     * \return the window filter. ui thread only.
+     */
+    StateWindowFilter getWindowFilter() const noexcept;
+
+    /**
+     * \brief Counters for overflows, dropped frames etc.
+     * \return the stats. safe to read from any thread.
      */
-    StateData getStateData() const noexcept;
+    const AudioStats& getStats() const noexcept;
+
+    /**
+     * \brief Timing of the processing
+     * \return the timings. safe to read from any thread.
+     */
+    const ProcessingStats& getProcessingStats() const noexcept;
+
+    /**
+     * \brief How long it took to get going
+     * \return the timings. safe to read from any thread.
+     */
+    const StartupStats& getStartupStats() const noexcept;
 
     /**
      * \brief Return a const ref to the current configuration
@@ -104,12 +231,30 @@ private:
      * \brief Kills of the audio backend
      */
     void stopAudio();
+    /**
+     * \brief Open filePath and analyze it on fileThread. Stops whatever ran before.
+     */
+    void startFileAnalysis() noexcept;
+    /**
+     * \brief Cancel a running file analysis and wait for it
+     */
+    void stopFileAnalysis() noexcept;
+    /**
+     * \brief Start recording everything captured to a new file in prefPath
+     */
+    void startRecording() noexcept;
+    /**
+     * \brief Stop the recording and log how it went
+     */
+    void stopRecording() noexcept;
     /**
      * \brief The member portion of the audio capture callback
-     * \param stream
-     * \param len
+     * \param out interleaved playback buffer, in config.sampleFormat
+     * \param in interleaved capture buffer, in config.sampleFormat
+     * \param frames number of frames in both buffers
+     * \param streamStatus overflow/underflow flags the driver handed us
      */
-    void audioCallback(void* out, void* in, size_t count);
+    void audioCallback(void* out, const void* in, size_t frames, RtAudioStreamStatus streamStatus);
 
     /**
      * \brief The static callback called by rtaudio internals
@@ -126,14 +271,96 @@ private:
      */
     void resetStates() noexcept;
 
+    /**
+     * \brief Make sure the pool for length has frames with one state per input channel
+     * \param length analysis length to set up
+     *
+     * Creating states plans ffts, which takes time. So this is not done under any lock.
+     */
+    void ensureStatePool(size_t length) noexcept;
+
+    /**
+     * \brief Take the next analysis frame from the capture ring and process it
+     * \return false if there was nothing to do
+     *
+     * Also applies the backpressure policy if the ring fills up.
+     */
+    bool processNextFrame() noexcept;
+
+    /**
+     * \brief Queue the ffts of all lengths with the background planner, so switching to them is quick
+     * \param currentLength the length in use. the lengths next to it go first.
+     */
+    void planAhead(size_t currentLength) noexcept;
+
+    /**
+     * \brief Apply the thread tunings and memory locking. Call from the ui thread.
+     */
+    void applyTuning() noexcept;
+
     /// current audio config
     AudioConfig config = {};
     /// rt audio instance
     std::unique_ptr<RtAudio> rtAudio = {};
+    /// stands in for rtAudio if useLoopback is set
+    LoopbackDevice loopback = {};
+    /// run against a simulated device instead of the sound card
+    bool useLoopback = false;
+    /// what the simulated device does
+    DutSettings dutSettings = {};
+    /// speed of the simulated device. 1 is real time, 0 as fast as possible.
+    double loopbackPace = 1.0;
+    /// delay of the echo the simulated device adds. 0 for none.
+    double echoMs = 0.0;
+    /// level of the echo
+    double echoGain = 0.5;
+    /// how far the last frame is off from the simulated device
+    DutError dutError = {};
+    /// frameCount dutError was computed for
+    size_t dutErrorFrame = 0;
     /// status string display
     std::string status = "Not Started";
     /// true if audio is running, false if not
     bool running = false;
+    /// where we put wisdom, logs etc.
+    std::string prefPath = {};
+    /// true once planAhead ran. the first update() does it, headless use never switches lengths.
+    bool plannedAhead = false;
+    /// counts overflows and the like
+    AudioStats stats = {};
+    /// times the processing
+    ProcessingStats processingStats = {};
+    /// times the startup
+    StartupStats startupStats = {};
+    /// when startAudio was called
+    std::chrono::steady_clock::time_point audioStartTime = {};
+    /// set by startAudio, cleared by the processing once it published a frame
+    std::atomic<bool> waitingForFirstFrame = false;
+    /// log for the stats. written by the processing worker, never by the callback
+    std::ofstream statsLog = {};
+    /// protects statsLog
+    std::mutex logLock = {};
+    /// stats.total() when we last wrote to the log
+    uint64_t loggedStats = 0;
+
+    /// path of the recording to analyze
+    std::string filePath = {};
+    /// format of headerless recordings
+    SampleFormat rawFormat = SampleFormat::Float32;
+    /// number of channels of headerless recordings
+    int rawChannelCount = 2;
+    /// sample rate of headerless recordings
+    int rawSampleRate = AudioConfig::defaultSampleRate;
+    /// the opened recording
+    FileSource fileSource = {};
+    /// analyzes fileSource
+    OfflineAnalyzer offlineAnalyzer = {};
+    /// runs offlineAnalyzer, so the ui stays responsive
+    std::thread fileThread = {};
+    /// true while fileThread is busy
+    std::atomic<bool> analyzingFile = false;
+    /// status string for the file analysis
+    std::string fileStatus = {};
 
     /// generates pink noise
     PinkNoiseGenerator pinkNoise = {};
@@ -146,38 +373,137 @@ private:
 
     /// thread worker for audio processing
     void processingWorker() noexcept;
+    /// writes the stats to the log, if they changed
+    void logStats() noexcept;
     /// std::threa for the processingWorker
     std::thread dataProcessor = {};
+    /// spreads the channels of a frame over the cores
+    WorkerPool workerPool = {};
+    /// priority and cpus for the processing thread and the worker pool. the callback runs one priority level above.
+    ThreadTuning processingTuning = {};
+    /// cpus for the ui thread. priority is ignored, drawing is not realtime.
+    ThreadTuning uiTuning = {};
+    /// true if the memory should be locked into ram
+    bool lockMemory = false;
+    /// result of the last applyTuning()
+    std::string tuningStatus = "Defaults";
     /// helps killing off the processing thread
     bool terminateThreads = false;
-    /// protects the audio queue
-    mutable std::mutex callbackLock = {};
-    /// protects the processing queue
-    mutable std::mutex processingLock = {};
+    /// protects the state pool and unusedFrames
+    mutable std::mutex poolLock = {};
+    /// serializes everything on the consumer side of captureRing, and reconfiguring it
+    std::mutex ringLock = {};
+    /// serializes publishing doneFrame against resetStates. readers do not need it.
+    std::mutex processingLock = {};
 
     /// use shared pointers so we have less of a foot gun
     using StatePtr = std::shared_ptr<State>;
-    /// pool of audio states (stateData + fluff around it)
-    using StatePoolArray = std::array<StatePtr, 5>;
-    /// map of states. map key is the analysis lengths
+    /// one frame: a state per measurement channel. The first one also does the reference for all of them.
+    using StateFrame = std::vector<StatePtr>;
+    /// frames get passed around as a whole
+    using FramePtr = std::shared_ptr<StateFrame>;
+    /// pool of audio frames (stateData + fluff around it)
+    using StatePoolArray = std::vector<FramePtr>;
+    /// frames per pool that are built up front. the pool grows past that while the history fills up.
+    static constexpr size_t basePoolFrames = 5;
+    /// map of frames. map key is the analysis lengths
     std::map<size_t, StatePoolArray> statePool = {};
 
-    /// states current available for processing
-    std::queue<StatePtr> unusedStates = {};
-
-    /// state that is current captured into
-    StatePtr captureState = nullptr;
-    /// number of samples already inside captureState
-    size_t sampleCount = 0;
-    /// states ready for processing
-    std::queue<StatePtr> processStates = {};
-    /// the state that is done with processing and can be used
-    StatePtr doneState = nullptr;
-    /// counts up every time a state is done with processing
-    size_t frameCount = 0;
-
-    /// configuration of the audio filter - shared between all states
+    /// frames current available for processing
+    std::queue<FramePtr> unusedFrames = {};
+    /// frames that were published and might still be read. they go back to unusedFrames once nobody holds them.
+    std::vector<FramePtr> retiredFrames = {};
+
+    /**
+     * \brief Put a frame that is not published anymore aside, until its readers let go of it
+     * \param frame the frame. nullptr is ignored.
+     * \note Call with poolLock held
+     */
+    void retireFrame(const FramePtr& frame) noexcept;
+
+    /**
+     * \brief Move retired frames nobody reads anymore back into unusedFrames
+     * \note Call with poolLock held
+     */
+    void reclaimFrames() noexcept;
+
+    /**
+     * \brief Add a frame to the pool for length, if the history leaves room for one
+     * \param length analysis length of the frame
+     * \return the new frame, not in unusedFrames. nullptr if the pool is full.
+     */
+    FramePtr growStatePool(size_t length) noexcept;
+
+    /**
+     * \brief Size the history for the current config, dropping frames that do not fit anymore
+     * \note Call with historyLock held
+     */
+    void resizeHistory() noexcept;
+
+    /**
+     * \brief Run the trigger rules over a processed frame, and keep it if one fires
+     * \param frame the frame, done with calc()
+     */
+    void checkTriggers(const StateFrame& frame) noexcept;
+
+    /// everything captured goes in here. channel 0 is the reference, the inputs follow.
+    CaptureRing captureRing = {};
+    /// samples played back since the stream started. the sweep restarts on every analysis length boundary.
+    uint64_t streamPosition = 0;
+    /// true while the capture ring is full, so an overflow is only counted once
+    bool captureOverflowing = false;
+    /// true while BackpressurePolicy::ReduceLoad is in effect
+    std::atomic<bool> reducedLoad = false;
+    /// scratch space for one block of playback samples, sized to the callback buffer in startAudio
+    RealVec playbackBuffer = {};
+    /// per capture channel destination pointers for deinterleave(), so the callback does not allocate
+    std::vector<double*> captureTargets = {};
+    /// archives the capture ring channels to disk
+    Recorder recorder = {};
+    /// container for new recordings
+    RecordingFormat recordingFormat = RecordingFormat::Wav;
+    /// per ring channel source pointers for the recorder, so the callback does not allocate
+    std::vector<const double*> recordSources = {};
+    /// the frame that is done with processing and can be used. only touched with std::atomic_load and std::atomic_store, it is never written to once published.
+    FramePtr doneFrame = nullptr;
+    /// counts up every time a frame is done with processing
+    std::atomic<size_t> frameCount = 0;
+    /// the last processed frames, newest at historyNewest. a ring that only shares the frames, so adding one is a pointer swap.
+    std::vector<FramePtr> history = {};
+    /// position of the newest frame in history
+    size_t historyNewest = 0;
+    /// frames in history
+    size_t historyCount = 0;
+    /// protects the history
+    mutable std::mutex historyLock = {};
+    /// spectra of the processed frames. way longer than the history, as it only keeps a row per frame.
+    Spectrogram spectrogram {};
+    /// the channel that goes into spectrogram
+    std::atomic<size_t> spectrogramChannel = 0;
+    /// one per channel, only touched by the processing worker
+    std::vector<RoomAnalyzer> roomAnalyzers = {};
+    /// when requestRoomAcoustics() was last called, in steady clock ticks
+    std::atomic<int64_t> roomAcousticsRequested = 0;
+    /// how long the room acoustics are worked out after a request
+    static constexpr std::chrono::seconds roomAcousticsHold = std::chrono::seconds(1);
+
+    /// configuration of the audio filter. the settings in here are used for all channels
     StateFilterConfig stateFilterConfig = {};
+    /// every channel averages on its own, so it needs its own filter. only touched by the processing worker.
+    std::vector<StateFilterConfig> channelFilterConfigs = {};
+    /// set by the ui to clear the averages of all channels on the next frame
+    std::atomic<bool> avgResetRequested = false;
+
+    /// the trigger rules as the ui edits them. handed to the processing as triggers when changed.
+    std::vector<TriggerRule> triggerRules = {};
+    /// the rules the processing checks every frame
+    std::vector<Trigger> triggers = {};
+    /// frames the triggers fired on, until somebody takes them
+    std::vector<TriggeredCapture> triggeredCaptures = {};
+    /// protects triggers and triggeredCaptures
+    std::mutex triggerLock = {};
+    /// frames the triggers fired on since start
+    std::atomic<size_t> triggerCount = 0;
 };
 
 #endif //laa_audiohandler_h
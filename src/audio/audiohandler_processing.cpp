@@ -17,6 +17,10 @@
 
 #include "audiohandler.h"
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
 // just switches between audio sources for playback
 double AudioHandler::genNextPlaybackSample()
 {
@@ -38,94 +42,96 @@ double AudioHandler::genNextPlaybackSample()
 
 // RT Audio does one callback call every time both the input and the output buffer are full
 // playbackCallback and captureCallback are seperate but are both fed from here
-int AudioHandler::rtAudioCallback(void* outputBuffer, void* inputBuffer, unsigned int nFrames, double, RtAudioStreamStatus, void* userData)
+int AudioHandler::rtAudioCallback(void* outputBuffer, void* inputBuffer, unsigned int nFrames, double, RtAudioStreamStatus status, void* userData)
 {
     // callback data is this, so NOLINTNEXTLINE
     auto* handler = reinterpret_cast<AudioHandler*>(userData);
-    handler->audioCallback(outputBuffer, inputBuffer, nFrames * handler->config.channelCount);
+    handler->audioCallback(outputBuffer, inputBuffer, nFrames, status);
 
     // why wouldn't we succeed?
     return 0;
 }
 
-void AudioHandler::audioCallback(void* out, void* in, size_t count)
+void AudioHandler::audioCallback(void* out, const void* in, size_t frames, RtAudioStreamStatus streamStatus)
 {
-    // this, combined with the rt audio callback, is a bit awkward but i have not had the time to clean it up yet
-    // void pointers do that. NOLINTNEXTLINE
-    auto* ptr = reinterpret_cast<float*>(in);
-    // void pointers do that. NOLINTNEXTLINE
-    auto* outPtr = reinterpret_cast<float*>(out);
+    // first see if the driver lost anything since the last call.
+    // whatever we capture next does not line up with what came before.
+    if ((streamStatus & RTAUDIO_INPUT_OVERFLOW) != 0) {
+        ++stats.inputOverflows;
+        captureRing.markGap();
+    }
+    if ((streamStatus & RTAUDIO_OUTPUT_UNDERFLOW) != 0) {
+        ++stats.outputUnderflows;
+    }
+
+    // the buffers are raw bytes in whatever format the devices hand out
+    auto* outBytes = static_cast<unsigned char*>(out);
+    const auto* inBytes = static_cast<const unsigned char*>(in);
+    const size_t sampleSize = getSampleSize(config.sampleFormat);
+    const size_t outFrameSize = sampleSize * config.playbackParams.nChannels;
+    const size_t captureChannels = config.getCaptureChannelCount();
+    const size_t inFrameSize = sampleSize * captureChannels;
 
-    // first check if there is no current capture State.
-    // We then try to get one from the unusedState queue.
-    // if there is none, we cant do things.
-    if (!captureState) {
-        callbackLock.lock();
-        if (unusedStates.empty()) {
-            callbackLock.unlock();
-            return;
+    // we work in spans, not samples.
+    // a span ends at the end of the buffer, the end of the playback scratch space, an analysis length boundary or where the ring wraps.
+    // that way everything inside of a span can be converted and copied in one go.
+    size_t done = 0;
+    while (done < frames) {
+        // restart the sweep on every analysis length boundary, so frames without overlap are in sync with it
+        auto boundaryOffset = static_cast<size_t>(streamPosition % config.analysisSamples);
+        if (boundaryOffset == 0) {
+            sweepGenerator.reset();
         }
 
-        sweepGenerator.reset(); // so they are somewhat in sync
-        captureState = unusedStates.front();
-        unusedStates.pop();
-        callbackLock.unlock();
-    }
+        size_t span = std::min({ frames - done, playbackBuffer.size(), config.analysisSamples - boundaryOffset });
+        size_t writable = captureRing.getContiguousWritable();
+        if (writable > 0) {
+            span = std::min(span, writable);
+        }
 
-    // then we loop over samples.
-    for (size_t i = 0; i + config.channelCount - 1 < count; i += config.channelCount) {
         // output
-        // next sample scaled by the output volume. Nothing to see here really
-        auto f = config.outputVolume * genNextPlaybackSample();
-
-        // id like to do this without pointer, but whatever
-        for (size_t writeOffset = 0; writeOffset < config.channelCount; ++writeOffset) {
-            outPtr[i + writeOffset] = static_cast<float>(f); //NOLINT
+        // next samples scaled by the output volume. Nothing to see here really
+        for (size_t i = 0; i < span; ++i) {
+            playbackBuffer[i] = config.outputVolume * genNextPlaybackSample();
         }
+        interleaveMono(outBytes + done * outFrameSize, playbackBuffer.data(), config.sampleFormat, config.playbackParams.nChannels, span); // NOLINT
 
         // input
-        float reference = 0.0F;
-        float input = 0.0F;
-        // samples are coming in as flaot32, but the stream is a raw pointer.
-        // also we need to decide if we have an internal or an external reference
-        if (config.channelCount == 2) { // external
-            reference = ptr[i + (config.inputAndReferenceAreSwapped ? 1 : 0)]; // NOLINT
-            input = ptr[i + (config.inputAndReferenceAreSwapped ? 0 : 1)]; // NOLINT
-        } else { // internal
-            input = ptr[i]; // NOLINT
-            reference = static_cast<float>(f); // NOLINT
-        }
-        // and convert to double, as we wanna process stuff as double
-        auto dReference = static_cast<double>(reference);
-        auto dInput = static_cast<double>(input);
-
-        // we put the samples back at the end of our current state
-        captureState->accessData().reference[sampleCount] = dReference;
-        captureState->accessData().input[sampleCount] = dInput;
-        ++sampleCount;
-
-        // and if the current state is full, we put it into processStates.
-        // we do not yet increase framecount - thats done by the audio processing thread.
-        // also, as we are already locking anyway, try to set up the next captureState. same as at the top, really
-        if (sampleCount >= config.analysisSamples) {
-            callbackLock.lock();
-            sampleCount = 0; // dont forget this!
-            processStates.push(captureState);
-            captureState = nullptr;
-
-            if (unusedStates.empty()) {
-                callbackLock.unlock();
-                return;
+        // everything goes into the ring, converted to double as we wanna process stuff as double.
+        // the processing picks the frames out of it on its own pace.
+        if (writable > 0) {
+            for (unsigned int input = 0; input < config.inputChannelCount; ++input) {
+                captureTargets[config.getInputChannel(input)] = captureRing.getWritePointer(input + 1);
             }
-            sweepGenerator.reset(); // so they are somewhat in sync
-            captureState = unusedStates.front();
-            unusedStates.pop();
-            callbackLock.unlock();
+            // we need to decide if we have an internal or an external reference.
+            if (config.internalReference) {
+                std::copy_n(playbackBuffer.data(), span, captureRing.getWritePointer(0));
+            } else {
+                captureTargets[config.getReferenceChannel()] = captureRing.getWritePointer(0);
+            }
+            deinterleave(captureTargets.data(), inBytes + done * inFrameSize, config.sampleFormat, captureChannels, span); // NOLINT
+            // the recorder gets exactly what the processing gets
+            if (recorder.isRecording()) {
+                for (size_t channel = 0; channel < recordSources.size(); ++channel) {
+                    recordSources[channel] = captureRing.getWritePointer(channel);
+                }
+                recorder.push(recordSources.data(), span);
+            }
+            captureRing.commitWrite(span);
+            captureOverflowing = false;
+        } else if (!captureOverflowing) {
+            // the processing is way behind and its policy did not catch it. we have to throw samples away.
+            ++stats.captureOverflows;
+            captureRing.markGap();
+            captureOverflowing = true;
         }
+
+        streamPosition += span;
+        done += span;
     }
 }
 
-// processes audio samples. What this really means is, get them form the queue and call calc
+// processes audio samples. What this really means is, take frames out of the ring and call calc
 void AudioHandler::processingWorker() noexcept
 {
     // needed for sleep
@@ -133,59 +139,333 @@ void AudioHandler::processingWorker() noexcept
 
     // terminateThreads is called in the dtor of AudioHandler and kills us of.
     while (!terminateThreads) {
-        // sleep (yield?) so that we dont eat all the cpu time when idle
-        std::this_thread::sleep_for(5ms);
+        // the callback cant write to disk, so we do it for it
+        logStats();
 
-        // current is our current audio state.
-        // lock, see if there is something in the queue.
-        StatePtr current = nullptr;
-        callbackLock.lock();
-        if (!processStates.empty()) {
-            current = processStates.front();
-            processStates.pop();
+        // sleep (yield?) so that we dont eat all the cpu time when idle.
+        // if there is work, we keep going until there is none.
+        if (!processNextFrame()) {
+            std::this_thread::sleep_for(5ms);
         }
-        callbackLock.unlock();
+    }
+}
+
+bool AudioHandler::processNextFrame() noexcept
+{
+    // the ring is ours until the samples are copied out
+    std::unique_lock<std::mutex> ringGuard(ringLock);
+    const size_t length = config.analysisSamples;
+    size_t readable = captureRing.getReadable();
+    if (captureRing.getChannelCount() == 0 || readable < length) {
+        return false;
+    }
+
+    // more than half the ring waiting means we are falling behind. something has to give before it overflows.
+    bool behind = readable > captureRing.getCapacity() / 2;
+    switch (config.backpressurePolicy) {
+    case BackpressurePolicy::DropOldest:
+        reducedLoad = false;
+        if (behind) {
+            // jump to the newest full frame, but stay on the hop grid
+            size_t hop = config.getHopSamples();
+            size_t skipped = (readable - length) / hop;
+            captureRing.consume(skipped * hop);
+            stats.droppedFrames += skipped;
+        }
+        break;
+    case BackpressurePolicy::SkipFrames:
+        reducedLoad = false;
+        if (behind) {
+            captureRing.consume(config.getHopSamples());
+            ++stats.droppedFrames;
+            return true;
+        }
+        break;
+    case BackpressurePolicy::ReduceLoad:
+        // only go back to full load once we caught up properly, so we do not flip every frame
+        if (behind) {
+            reducedLoad = true;
+        } else if (readable < captureRing.getCapacity() / 4) {
+            reducedLoad = false;
+        }
+        break;
+    }
+
+    // the pool is only for processing, so there should always be a frame around
+    FramePtr current = nullptr;
+    poolLock.lock();
+    reclaimFrames();
+    if (!unusedFrames.empty()) {
+        current = unusedFrames.front();
+        unusedFrames.pop();
+    }
+    poolLock.unlock();
+    // the history holds on to frames, so the pool grows until it is full
+    if (!current) {
+        current = growStatePool(length);
+    }
+
+    // the length changed and resetStates did not come around yet. the frame belongs to the old pool, drop it.
+    if (!current || current->empty() || (*current)[0]->getData().fftLen != length) {
+        return false;
+    }
+
+    // copy the frame out of the ring. the reference only goes into the first state, the others get it during processing.
+    auto& frame = *current;
+    bool discontinuous = captureRing.hasGap(length);
+    captureRing.read(0, frame[0]->accessData().reference.data(), length);
+    size_t inputs = std::min(frame.size(), captureRing.getChannelCount() - 1);
+    for (size_t input = 0; input < inputs; ++input) {
+        captureRing.read(input + 1, frame[input]->accessData().input.data(), length);
+    }
+    // flag it, so averaging etc. can decide what to do with it.
+    // the rest of the config goes in too, readers only get the snapshot.
+    for (auto& state : frame) {
+        auto& data = state->accessData();
+        data.discontinuous = discontinuous;
+        data.sampleRate = static_cast<double>(config.sampleRate);
+        data.fftDuration = config.samplesToSeconds(length);
+    }
+    if (discontinuous) {
+        ++stats.partialFrames;
+    }
+    // everything captured after the frame is how long it already waited
+    size_t backlog = captureRing.getReadable() - length;
+    captureRing.consume(config.getHopSamples(reducedLoad));
+    ringGuard.unlock();
+    auto processingStart = std::chrono::steady_clock::now();
+
+    // every channel averages on its own, but they all share the settings
+    if (channelFilterConfigs.size() < frame.size()) {
+        channelFilterConfigs.resize(frame.size());
+    }
+    bool resetAvg = avgResetRequested.exchange(false);
+    for (auto& filterConfig : channelFilterConfigs) {
+        filterConfig.windowFilter = stateFilterConfig.windowFilter;
+        filterConfig.avgCount = stateFilterConfig.avgCount;
+        filterConfig.rejectDiscontinuous = stateFilterConfig.rejectDiscontinuous;
+        filterConfig.skipOptionalStages = reducedLoad;
+        if (resetAvg) {
+            filterConfig.clearAvg();
+        }
+    }
+
+    // this takes time, and is the reason we are a thread
+    Analyzer::calcFrame(frame, channelFilterConfigs, &workerPool);
+
+    // room acoustics only while somebody shows them. frames come back from the pool, so the old ones have to go either way.
+    auto sinceRequest = std::chrono::steady_clock::now().time_since_epoch().count() - roomAcousticsRequested.load();
+    if (sinceRequest < std::chrono::duration_cast<std::chrono::steady_clock::duration>(roomAcousticsHold).count()) {
+        if (roomAnalyzers.size() < frame.size()) {
+            roomAnalyzers.resize(frame.size());
+        }
+        workerPool.parallelFor(frame.size(), [this, &frame](size_t index) {
+            auto& data = frame[index]->accessData();
+            data.acoustics = roomAnalyzers[index].calc(data);
+        });
+    } else {
+        for (auto& state : frame) {
+            state->accessData().acoustics.valid = false;
+        }
+    }
+
+    // the rules look at what calc() just made, before anybody else sees the frame
+    checkTriggers(frame);
+    // one row per frame, it outlasts the frame going back into the pool
+    size_t shownChannel = spectrogramChannel;
+    if (shownChannel < frame.size()) {
+        spectrogram.add(frame[shownChannel]->getData());
+    }
+
+    // publish the frame. readers copy the pointer, not the data, so this is quick.
+    // the old one might still be read, so it only goes back into the queue once nobody holds it anymore.
+    processingLock.lock();
+    auto previous = std::atomic_exchange(&doneFrame, current);
+    ++frameCount; // here we finally increase the frame count - just after updating the done frame.
+    processingLock.unlock();
+    poolLock.lock();
+    retireFrame(previous);
+    poolLock.unlock();
+
+    // the frame that falls out of the history is only let go of here, it goes back to the pool on its own
+    historyLock.lock();
+    if (!history.empty()) {
+        historyNewest = (historyNewest + 1) % history.size();
+        history[historyNewest] = current;
+        historyCount = std::min(historyCount + 1, history.size());
+    }
+    historyLock.unlock();
+
+    if (waitingForFirstFrame.exchange(false)) {
+        auto sinceStart = std::chrono::steady_clock::now() - audioStartTime;
+        startupStats.firstFrameMicros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(sinceStart).count());
+    }
+
+    auto micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - processingStart).count());
+    processingStats.add(micros, micros + static_cast<uint64_t>(config.samplesToSeconds(backlog) * 1e6));
+
+    return true;
+}
 
-        // if there was nothing, we got nothing to do
-        if (!current) {
+void AudioHandler::retireFrame(const FramePtr& frame) noexcept
+{
+    if (frame == nullptr || std::find(retiredFrames.begin(), retiredFrames.end(), frame) != retiredFrames.end()) {
+        return;
+    }
+    retiredFrames.push_back(frame);
+}
+
+void AudioHandler::reclaimFrames() noexcept
+{
+    auto iter = retiredFrames.begin();
+    while (iter != retiredFrames.end()) {
+        // a retired frame is not published, so nobody can grab a new reference to it. its use count only goes down.
+        // once it is down to retiredFrames and the pool owning it, nobody reads it anymore.
+        // the frames in the history are held by more than that, skip them before looking through the pools.
+        if (iter->use_count() > 2) {
+            ++iter;
+            continue;
+        }
+        bool pooled = false;
+        bool current = false;
+        for (const auto& [length, pool] : statePool) {
+            if (std::find(pool.begin(), pool.end(), *iter) != pool.end()) {
+                pooled = true;
+                current = length == config.analysisSamples;
+            }
+        }
+        if (iter->use_count() > (pooled ? 2 : 1)) {
+            ++iter;
             continue;
         }
 
-        // this takes time, and is the reason we are a thread
-        current->calc(stateFilterConfig);
+        // pairs with the release of the readers dropping their reference, so their reads are done before we write
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // frames of other lengths are put back by resetStates when their length comes around again
+        if (current) {
+            unusedFrames.push(*iter);
+        }
+        iter = retiredFrames.erase(iter);
+    }
+}
 
-        // advance the doneState
-        // we give the current state back to the unused queue, to be picked back up by the audio capture.
-        processingLock.lock();
-        if (doneState != nullptr) {
-            callbackLock.lock();
-            unusedStates.push(doneState);
-            callbackLock.unlock();
+std::shared_ptr<const StateData> AudioHandler::getSnapshot(size_t channel) const noexcept
+{
+    auto frame = std::atomic_load(&doneFrame);
+    if (frame == nullptr || channel >= frame->size()) {
+        return nullptr;
+    }
+
+    // shares ownership of the whole frame, so it stays out of the pool while the data is held
+    return std::shared_ptr<const StateData>(frame, &(*frame)[channel]->getData());
+}
+
+void AudioHandler::checkTriggers(const StateFrame& frame) noexcept
+{
+    auto time = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    std::string reason = {};
+    {
+        std::lock_guard<std::mutex> guard(triggerLock);
+        // every rule sees every frame, so they all know if their value just crossed the threshold
+        for (auto& trigger : triggers) {
+            size_t channel = trigger.getRule().channel;
+            if (channel < frame.size() && trigger.check(frame[channel]->getData(), time)) {
+                reason += (reason.empty() ? "" : ", ") + trigger.getRule().toString();
+            }
         }
-        doneState = current;
-        ++frameCount; // here we finally increase the frame count - just after updating the done state.
-        processingLock.unlock();
     }
+    if (reason.empty()) {
+        return;
+    }
+
+    // the frame goes back into the pool soon, so the capture keeps its own compact copy
+    TriggeredCapture capture;
+    capture.reason = reason;
+    for (const auto& state : frame) {
+        capture.channels.push_back(std::make_shared<const CompactState>(state->getData(), channelFilterConfigs[0].windowFilter));
+    }
+    ++triggerCount;
+
+    std::lock_guard<std::mutex> guard(triggerLock);
+    triggeredCaptures.push_back(std::move(capture));
+}
+
+std::vector<TriggeredCapture> AudioHandler::takeTriggeredCaptures() noexcept
+{
+    std::vector<TriggeredCapture> captures = {};
+    std::lock_guard<std::mutex> guard(triggerLock);
+    std::swap(captures, triggeredCaptures);
+    return captures;
 }
 
-// return a copy of the state data
-StateData AudioHandler::getStateData() const noexcept
+size_t AudioHandler::getHistorySize() const noexcept
 {
-    // first check if there is any. if not, nothing to do
-    StateData copy = {};
-    if (doneState == nullptr) {
-        return copy;
+    std::lock_guard<std::mutex> guard(historyLock);
+    return historyCount;
+}
+
+std::shared_ptr<const StateData> AudioHandler::getHistorySnapshot(size_t age, size_t channel) const noexcept
+{
+    FramePtr frame = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(historyLock);
+        if (age >= historyCount) {
+            return nullptr;
+        }
+        frame = history[(historyNewest + history.size() - age) % history.size()];
+    }
+    if (channel >= frame->size()) {
+        return nullptr;
     }
 
-    // only the processor touches the done state
-    // the processor only locks the callbacks if it can lock this lock
-    // so no need to do anything special, the processor can wait for the copy
-    processingLock.lock();
-    copy = doneState->getData();
-    processingLock.unlock();
+    return std::shared_ptr<const StateData>(frame, &(*frame)[channel]->getData());
+}
+
+const Spectrogram& AudioHandler::getSpectrogram() const noexcept
+{
+    return spectrogram;
+}
+
+void AudioHandler::setSpectrogramChannel(size_t channel) noexcept
+{
+    if (spectrogramChannel.exchange(channel) != channel) {
+        spectrogram.clear();
+    }
+}
+
+size_t AudioHandler::getSpectrogramChannel() const noexcept
+{
+    return spectrogramChannel;
+}
+
+void AudioHandler::requestRoomAcoustics() noexcept
+{
+    roomAcousticsRequested = std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+size_t AudioHandler::getChannelCount() const noexcept
+{
+    auto frame = std::atomic_load(&doneFrame);
+    return frame != nullptr ? frame->size() : 0;
+}
+
+void AudioHandler::logStats() noexcept
+{
+    uint64_t total = stats.total();
+    std::lock_guard<std::mutex> guard(logLock);
+    if (total == loggedStats || !statsLog.is_open()) {
+        return;
+    }
 
-    // copy some config infos over into the state
-    copy.sampleRate = static_cast<double>(config.sampleRate);
-    copy.fftDuration = config.samplesToSeconds(config.analysisSamples);
-    return copy;
+    loggedStats = total;
+    auto now = std::time(nullptr);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    std::array<char, 32> timeString = {};
+    std::strftime(timeString.data(), timeString.size(), "%F %T", &local);
+    statsLog << timeString.data() << " " << stats.toString() << std::endl;
 }
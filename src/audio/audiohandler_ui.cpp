@@ -18,40 +18,23 @@
 #include "../midpointslider.h"
 #include "audiohandler.h"
 
-std::string getStr(const FunctionGeneratorType& gen) noexcept
+// one checkbox per cpu, eight per row
+static void affinityCheckboxes(const char* id, uint64_t& mask)
 {
-    switch (gen) {
-    case FunctionGeneratorType::Silence:
-        return "Silence";
-
-    case FunctionGeneratorType::WhiteNoise:
-        return "White Noise";
-
-    case FunctionGeneratorType::PinkNoise:
-        return "Pink Noise";
-
-    case FunctionGeneratorType::Sine:
-        return "Sine";
-
-    case FunctionGeneratorType::Sweep:
-        return "Sweep";
-    }
-
-    return "";
-}
-
-std::string getStr(const StateWindowFilter& filter) noexcept
-{
-    switch (filter) {
-    case StateWindowFilter::None:
-        return "None";
-    case StateWindowFilter::Hamming:
-        return "Hamming";
-    case StateWindowFilter::Blackman:
-        return "Blackman";
+    ImGui::PushID(id);
+    for (unsigned int cpu = 0; cpu < getCpuCount(); ++cpu) {
+        ImGui::PushID(static_cast<int>(cpu));
+        bool enabled = (mask & (1ULL << cpu)) != 0;
+        if (ImGui::Checkbox(std::to_string(cpu).c_str(), &enabled)) {
+            mask ^= 1ULL << cpu;
+        }
+        ImGui::PopID();
+        if ((cpu + 1) % 8 != 0) {
+            ImGui::SameLine();
+        }
     }
-
-    return "";
+    ImGui::NewLine();
+    ImGui::PopID();
 }
 
 static std::string ApiName(const RtAudio::Api AApi)
@@ -88,6 +71,12 @@ static std::string ApiName(const RtAudio::Api AApi)
 
 void AudioHandler::update() noexcept
 {
+    // only the ui switches lengths, so only the ui plans them ahead
+    if (!plannedAhead) {
+        planAhead(config.analysisSamples);
+        plannedAhead = true;
+    }
+
     ImGui::Begin("Audio Settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysVerticalScrollbar);
     ImGui::PushItemWidth(-1.0F);
     if (!running) {
@@ -170,21 +159,92 @@ void AudioHandler::update() noexcept
         ImGui::TextWrapped("First Playback");
         ImGui::InputInt("##firstPlayback", &iFirstPlayback, 1, 1);
 
-        bool enableInternal = config.channelCount == 1;
-        ImGui::Checkbox("Internal Reference", &enableInternal);
-        config.channelCount = enableInternal ? 1 : 2; // 2 channels with reference, one without
-        config.playbackParams.firstChannel = std::clamp(static_cast<unsigned int>(iFirstPlayback), 0u, config.playbackDevice.outputChannels - config.channelCount);
-        config.captureParams.firstChannel = std::clamp(static_cast<unsigned int>(iFirstCapture), 0u, config.captureDevice.inputChannels - config.channelCount);
+        ImGui::Checkbox("Internal Reference", &config.internalReference);
+
+        // as many inputs as the device has left after the reference, and not more than we can handle
+        unsigned int referenceChannels = config.internalReference ? 0U : 1U;
+        unsigned int maxInputs = config.captureDevice.inputChannels > referenceChannels ? config.captureDevice.inputChannels - referenceChannels : 1U;
+        if (useLoopback) {
+            // the simulated device has as many channels as we want
+            maxInputs = AudioConfig::maxInputChannels;
+        }
+        maxInputs = std::min(maxInputs, AudioConfig::maxInputChannels);
+        auto iInputChannels = static_cast<int>(config.inputChannelCount);
+        ImGui::TextWrapped("Input Channels");
+        ImGui::InputInt("##inputChannels", &iInputChannels, 1, 1);
+        config.inputChannelCount = std::clamp(static_cast<unsigned int>(std::max(iInputChannels, 1)), 1U, maxInputs);
+
+        ImGui::TextWrapped("Capture Buffer (s)");
+        ImGui::InputDouble("##captureBuffer", &config.captureBufferSeconds, 1.0, 10.0, "%.0f");
+        config.captureBufferSeconds = std::clamp(config.captureBufferSeconds, 1.0, 120.0);
+
+        auto iHistoryMegabytes = static_cast<int>(config.historyMegabytes);
+        ImGui::TextWrapped("History (MB)");
+        ImGui::InputInt("##historyMegabytes", &iHistoryMegabytes, 16, 128);
+        config.historyMegabytes = static_cast<size_t>(std::clamp(iHistoryMegabytes, 0, 16384));
+
+        config.playbackParams.firstChannel = std::clamp(static_cast<unsigned int>(iFirstPlayback), 0u, config.playbackDevice.outputChannels - std::min(config.playbackDevice.outputChannels, config.getPlaybackChannelCount()));
+        config.captureParams.firstChannel = std::clamp(static_cast<unsigned int>(iFirstCapture), 0u, config.captureDevice.inputChannels - std::min(config.captureDevice.inputChannels, config.getCaptureChannelCount()));
     } else {
         ImGui::TextWrapped("Capture Device: %s", config.captureDevice.name.c_str());
         ImGui::TextWrapped("Playback Device: %s", config.playbackDevice.name.c_str());
         ImGui::TextWrapped("Sample Rate: %d", static_cast<int>(config.sampleRate));
+        ImGui::TextWrapped("Sample Format: %s", getStr(config.sampleFormat).c_str());
         ImGui::TextWrapped("First Playback: %d", static_cast<int>(config.playbackParams.firstChannel));
         ImGui::TextWrapped("First Capture: %d", static_cast<int>(config.playbackParams.firstChannel));
-        ImGui::TextWrapped("Internal Reference: %s", config.channelCount == 2 ? "no" : "yes");
+        ImGui::TextWrapped("Internal Reference: %s", config.internalReference ? "yes" : "no");
+        ImGui::TextWrapped("Input Channels: %d", static_cast<int>(config.inputChannelCount));
+        if (auto snapshot = getSnapshot(); snapshot != nullptr) {
+            double megabytes = static_cast<double>(snapshot->getMemoryUsage() * getChannelCount()) / (1024.0 * 1024.0);
+            ImGui::TextWrapped("Frame Memory: %.1fMB", megabytes);
+        }
+        ImGui::TextWrapped("History: %d of %d frames", static_cast<int>(getHistorySize()), static_cast<int>(config.getHistoryFrames()));
+        ImGui::TextWrapped("Capture Buffer: %.0fs, %d%% full", config.captureBufferSeconds, static_cast<int>(100 * captureRing.getReadable() / std::max(captureRing.getCapacity(), static_cast<size_t>(1))));
+        if (reducedLoad) {
+            ImGui::TextWrapped("Reduced Load!");
+        }
         if (config.inputAndReferenceAreSwapped) {
             ImGui::TextWrapped("Input and Ref Swapped!");
         }
+        if (loopback.isRunning()) {
+            ImGui::TextWrapped("Simulated: %.1fx real time", loopback.getSpeed());
+            // comparing against the simulated device walks all bins, so only do it for new frames
+            auto snapshot = getSnapshot();
+            if (dutErrorFrame != frameCount && snapshot != nullptr) {
+                dutErrorFrame = frameCount;
+                dutError = loopback.getDut().compare(*snapshot);
+            }
+            if (dutError.bins > 0) {
+                ImGui::TextWrapped("Transfer Error: %.3fdB rms, %.3fdB max", dutError.rmsDb, dutError.maxDb);
+            }
+        }
+
+        ImGui::TextWrapped("Recording");
+        if (!recorder.isRecording()) {
+            if (ImGui::BeginCombo("##recordingFormat", getStr(recordingFormat).c_str())) {
+                for (auto format : { RecordingFormat::Wav, RecordingFormat::W64, RecordingFormat::Raw }) {
+                    if (ImGui::Selectable(getStr(format).c_str(), format == recordingFormat)) {
+                        recordingFormat = format;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::Button("Record")) {
+                startRecording();
+            }
+        } else {
+            ImGui::TextWrapped("%s", recorder.getPath().c_str());
+            ImGui::TextWrapped("Written: %.1f MB", static_cast<double>(recorder.getBytesWritten()) / 1e6);
+            if (ImGui::Button("Stop Recording")) {
+                stopRecording();
+            }
+        }
+        if (recorder.getBytesLost() > 0) {
+            ImGui::TextWrapped("Recording lost %llu bytes!", static_cast<unsigned long long>(recorder.getBytesLost()));
+        }
+        if (!recorder.getError().empty()) {
+            ImGui::TextWrapped("Recording: %s", recorder.getError().c_str());
+        }
     }
 
     if (!running) {
@@ -198,7 +258,116 @@ void AudioHandler::update() noexcept
         }
     }
 
+    if (fileThread.joinable() && !analyzingFile) {
+        // done. pick up the result
+        fileThread.join();
+        if (!offlineAnalyzer.getError().empty()) {
+            fileStatus = offlineAnalyzer.getError();
+        } else {
+            fileStatus = std::to_string(offlineAnalyzer.getFramesDone()) + "/" + std::to_string(offlineAnalyzer.getFrameTotal())
+                + " frames at " + std::to_string(static_cast<int>(offlineAnalyzer.getSpeed())) + "x real time";
+        }
+    }
+
+    if (!running && ImGui::CollapsingHeader("Simulated Device")) {
+        ImGui::Checkbox("Use Simulated Device", &useLoopback);
+        ImGui::TextWrapped("Speed");
+        if (ImGui::BeginCombo("##loopbackPace", loopbackPace > 0.0 ? (std::to_string(static_cast<int>(loopbackPace)) + "x").c_str() : "Unlimited")) {
+            for (int pace : { 1, 10, 100, 0 }) {
+                if (ImGui::Selectable(pace > 0 ? (std::to_string(pace) + "x").c_str() : "Unlimited", pace == static_cast<int>(loopbackPace))) {
+                    loopbackPace = static_cast<double>(pace);
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::TextWrapped("Filter");
+        if (ImGui::BeginCombo("##dutFilter", getStr(dutSettings.filter).c_str())) {
+            for (auto filter : { DutFilter::None, DutFilter::LowPass, DutFilter::HighPass, DutFilter::Peak }) {
+                if (ImGui::Selectable(getStr(filter).c_str(), filter == dutSettings.filter)) {
+                    dutSettings.filter = filter;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        if (dutSettings.filter != DutFilter::None) {
+            ImGui::TextWrapped("Filter Frequency (Hz)");
+            ImGui::InputDouble("##dutFrequency", &dutSettings.filterFrequency, 10.0, 100.0, "%.0f");
+            dutSettings.filterFrequency = std::clamp(dutSettings.filterFrequency, 1.0, config.sampleRate / 2.0 - 1.0);
+            ImGui::TextWrapped("Filter Q");
+            ImGui::InputDouble("##dutQ", &dutSettings.filterQ, 0.1, 1.0, "%.2f");
+            dutSettings.filterQ = std::clamp(dutSettings.filterQ, 0.1, 100.0);
+        }
+        if (dutSettings.filter == DutFilter::Peak) {
+            ImGui::TextWrapped("Filter Gain (dB)");
+            ImGui::InputDouble("##dutGain", &dutSettings.filterGainDb, 1.0, 6.0, "%.1f");
+            dutSettings.filterGainDb = std::clamp(dutSettings.filterGainDb, -40.0, 40.0);
+        }
+        ImGui::TextWrapped("Echo (ms, 0 = off)");
+        ImGui::InputDouble("##dutEcho", &echoMs, 1.0, 10.0, "%.1f");
+        echoMs = std::clamp(echoMs, 0.0, 100.0);
+        if (echoMs > 0.0) {
+            ImGui::TextWrapped("Echo Level");
+            MidpointSlider("##dutEchoGain", -1.0, 1.0, 0.0, echoGain);
+        }
+        ImGui::TextWrapped("Delay (ms)");
+        ImGui::InputDouble("##dutDelay", &dutSettings.delayMs, 1.0, 10.0, "%.2f");
+        dutSettings.delayMs = std::clamp(dutSettings.delayMs, 0.0, DutSettings::maxDelayMs);
+        ImGui::TextWrapped("Noise (dBFS)");
+        ImGui::InputDouble("##dutNoise", &dutSettings.noiseDb, 1.0, 10.0, "%.0f");
+        dutSettings.noiseDb = std::clamp(dutSettings.noiseDb, -200.0, 0.0);
+        ImGui::TextWrapped("Clock Drift (ppm)");
+        ImGui::InputDouble("##dutDrift", &dutSettings.driftPpm, 1.0, 10.0, "%.1f");
+        dutSettings.driftPpm = std::clamp(dutSettings.driftPpm, -1000.0, 1000.0);
+        ImGui::TextWrapped("Dropouts (%% of buffers)");
+        auto dropoutPercent = dutSettings.dropoutRate * 100.0;
+        ImGui::InputDouble("##dutDropouts", &dropoutPercent, 0.1, 1.0, "%.2f");
+        dutSettings.dropoutRate = std::clamp(dropoutPercent / 100.0, 0.0, 1.0);
+    }
+
+    if (!running && ImGui::CollapsingHeader("File Analysis")) {
+        ImGui::TextWrapped("File (.wav, .w64 or raw)");
+        ImGui::InputText("##filePath", &filePath);
+        ImGui::TextWrapped("Raw Format");
+        if (ImGui::BeginCombo("##rawFormat", getStr(rawFormat).c_str())) {
+            for (auto format : { SampleFormat::Float32, SampleFormat::Int32, SampleFormat::Int24, SampleFormat::Int16 }) {
+                if (ImGui::Selectable(getStr(format).c_str(), format == rawFormat)) {
+                    rawFormat = format;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::TextWrapped("Raw Channels");
+        ImGui::InputInt("##rawChannels", &rawChannelCount, 1, 1);
+        rawChannelCount = std::clamp(rawChannelCount, 2, static_cast<int>(AudioConfig::maxInputChannels) + 1);
+        ImGui::TextWrapped("Raw Sample Rate");
+        ImGui::InputInt("##rawRate", &rawSampleRate, 0, 0);
+        rawSampleRate = std::max(rawSampleRate, 1);
+
+        if (analyzingFile) {
+            auto total = std::max(offlineAnalyzer.getFrameTotal(), static_cast<size_t>(1));
+            ImGui::ProgressBar(static_cast<float>(offlineAnalyzer.getFramesDone()) / static_cast<float>(total));
+            ImGui::TextWrapped("%.0fx real time", offlineAnalyzer.getSpeed());
+            if (ImGui::Button("Cancel")) {
+                offlineAnalyzer.cancel();
+            }
+        } else if (ImGui::Button("Analyze File")) {
+            startFileAnalysis();
+        }
+        ImGui::TextWrapped("File: %s", fileStatus.c_str());
+    }
+
     ImGui::TextWrapped("Status: %s", status.c_str());
+    ImGui::TextWrapped("Overflows: %llu", static_cast<unsigned long long>(stats.inputOverflows));
+    ImGui::TextWrapped("Underflows: %llu", static_cast<unsigned long long>(stats.outputUnderflows));
+    ImGui::TextWrapped("Buffer Overflows: %llu", static_cast<unsigned long long>(stats.captureOverflows));
+    ImGui::TextWrapped("Dropped Frames: %llu", static_cast<unsigned long long>(stats.droppedFrames));
+    ImGui::TextWrapped("Partial Frames: %llu", static_cast<unsigned long long>(stats.partialFrames));
+    ImGui::TextWrapped("Processing: %s", processingStats.toString().c_str());
+    ImGui::TextWrapped("Startup: %s", startupStats.toString().c_str());
+    if (ImGui::Button("Reset Counters")) {
+        stats.reset();
+        processingStats.reset();
+    }
 
     ImGui::Separator();
 
@@ -237,12 +406,17 @@ void AudioHandler::update() noexcept
 
     ImGui::Separator();
     ImGui::TextWrapped("Analysis Length");
+    if (size_t pendingPlans = getPendingFftPlans(); pendingPlans > 0) {
+        size_t finishedPlans = getFinishedFftPlans();
+        ImGui::TextWrapped("Optimizing ffts: %d/%d", static_cast<int>(finishedPlans), static_cast<int>(finishedPlans + pendingPlans));
+    }
     if (ImGui::BeginCombo("##Analysis Length", config.sampleCountToString(config.analysisSamples).c_str())) {
         for (auto&& rate : config.getPossibleAnalysisSampleRates()) {
             ImGui::PushID(static_cast<int>(rate));
             if (ImGui::Selectable(config.sampleCountToString(rate).c_str(), rate == config.analysisSamples)) {
                 config.analysisSamples = rate;
                 sweepGenerator.setLength(static_cast<double>(config.analysisSamples) / config.sampleRate);
+                ensureStatePool(config.analysisSamples);
                 resetStates();
             }
             ImGui::PopID();
@@ -250,6 +424,34 @@ void AudioHandler::update() noexcept
 
         ImGui::EndCombo();
     }
+    ImGui::TextWrapped("Overlap");
+    auto overlapPercent = static_cast<int>(config.overlap * 100.0);
+    if (ImGui::BeginCombo("##Overlap", (std::to_string(overlapPercent) + "%").c_str())) {
+        for (int percent : { 0, 50, 75, 87 }) {
+            if (ImGui::Selectable((std::to_string(percent) + "%").c_str(), percent == overlapPercent)) {
+                config.overlap = static_cast<double>(percent) / 100.0;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::TextWrapped("When Behind");
+    if (ImGui::BeginCombo("##Backpressure", getStr(config.backpressurePolicy).c_str())) {
+        for (auto policy : { BackpressurePolicy::DropOldest, BackpressurePolicy::SkipFrames, BackpressurePolicy::ReduceLoad }) {
+            if (ImGui::Selectable(getStr(policy).c_str(), policy == config.backpressurePolicy)) {
+                config.backpressurePolicy = policy;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::TextWrapped("FFT Planning");
+    if (ImGui::BeginCombo("##FftPlanEffort", getStr(getFftPlanEffort()).c_str())) {
+        for (auto effort : { FftPlanEffort::Measure, FftPlanEffort::Patient }) {
+            if (ImGui::Selectable(getStr(effort).c_str(), effort == getFftPlanEffort())) {
+                setFftPlanEffort(effort);
+            }
+        }
+        ImGui::EndCombo();
+    }
     ImGui::TextWrapped("Window Filter");
     if (ImGui::BeginCombo("##Window Config", getStr(stateFilterConfig.windowFilter).c_str())) {
         if (ImGui::Selectable("None", stateFilterConfig.windowFilter == StateWindowFilter::None)) {
@@ -268,7 +470,106 @@ void AudioHandler::update() noexcept
     ImGui::InputInt("##avgCount", &iAvgCount, 1, 1);
     stateFilterConfig.avgCount = std::clamp(static_cast<size_t>(iAvgCount), static_cast<size_t>(0), LAA_MAX_FFT_AVG);
     if (ImGui::Button("Reset Avg")) {
-        stateFilterConfig.clearAvg();
+        avgResetRequested = true;
+    }
+    ImGui::Checkbox("Reject Partial Frames", &stateFilterConfig.rejectDiscontinuous);
+
+    ImGui::Separator();
+    if (ImGui::CollapsingHeader("Triggers")) {
+        bool rulesChanged = false;
+        size_t ruleIndex = 0;
+        while (ruleIndex < triggerRules.size()) {
+            auto& rule = triggerRules[ruleIndex];
+            ImGui::PushID(static_cast<int>(ruleIndex));
+            rulesChanged |= ImGui::Checkbox("##ruleEnabled", &rule.enabled);
+            ImGui::SameLine();
+            if (ImGui::BeginCombo("##ruleKind", getStr(rule.kind).c_str())) {
+                for (auto kind : { TriggerKind::Coherence, TriggerKind::Level, TriggerKind::Interval }) {
+                    if (ImGui::Selectable(getStr(kind).c_str(), kind == rule.kind) && kind != rule.kind) {
+                        // the threshold means something else for every kind
+                        rule.kind = kind;
+                        rule.threshold = kind == TriggerKind::Coherence ? 0.9 : (kind == TriggerKind::Level ? -20.0 : 60.0);
+                        rulesChanged = true;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (rule.kind != TriggerKind::Interval) {
+                ImGui::TextWrapped("Band (Hz)");
+                rulesChanged |= ImGui::InputDouble("##ruleLow", &rule.lowFrequency, 10.0, 100.0, "%.0f");
+                rulesChanged |= ImGui::InputDouble("##ruleHigh", &rule.highFrequency, 10.0, 100.0, "%.0f");
+                rule.lowFrequency = std::clamp(rule.lowFrequency, 0.0, 96000.0);
+                rule.highFrequency = std::clamp(rule.highFrequency, rule.lowFrequency, 96000.0);
+            }
+            ImGui::TextWrapped(rule.kind == TriggerKind::Coherence ? "Above" : (rule.kind == TriggerKind::Level ? "Above (dB)" : "Every (s)"));
+            rulesChanged |= ImGui::InputDouble("##ruleThreshold", &rule.threshold, 0.01, 1.0, "%.2f");
+            if (rule.kind != TriggerKind::Interval) {
+                ImGui::TextWrapped("Hold Off (s)");
+                rulesChanged |= ImGui::InputDouble("##ruleHoldOff", &rule.holdOff, 1.0, 10.0, "%.0f");
+                rule.holdOff = std::max(rule.holdOff, 0.0);
+            }
+            if (config.inputChannelCount > 1) {
+                auto iChannel = static_cast<int>(rule.channel) + 1;
+                ImGui::TextWrapped("Channel");
+                rulesChanged |= ImGui::InputInt("##ruleChannel", &iChannel, 1, 1);
+                rule.channel = static_cast<size_t>(std::clamp(iChannel, 1, static_cast<int>(config.inputChannelCount)) - 1);
+            }
+            bool remove = ImGui::Button("Remove Rule");
+            ImGui::PopID();
+            if (remove) {
+                triggerRules.erase(triggerRules.begin() + static_cast<std::ptrdiff_t>(ruleIndex));
+                rulesChanged = true;
+                continue;
+            }
+            ++ruleIndex;
+        }
+        if (ImGui::Button("Add Rule")) {
+            triggerRules.emplace_back();
+            rulesChanged = true;
+        }
+        ImGui::TextWrapped("Triggered: %d", static_cast<int>(triggerCount));
+
+        // the processing starts over with the new rules, so nothing fires just because a rule changed
+        if (rulesChanged) {
+            std::lock_guard<std::mutex> guard(triggerLock);
+            triggers.clear();
+            for (const auto& rule : triggerRules) {
+                triggers.emplace_back(rule);
+            }
+        }
+    }
+
+    ImGui::Separator();
+    if (ImGui::CollapsingHeader("Threads")) {
+        ImGui::TextWrapped("Processing Priority");
+        if (ImGui::BeginCombo("##processingPriority", getStr(processingTuning.priority).c_str())) {
+            for (auto priority : { ThreadPriority::Normal, ThreadPriority::Fifo, ThreadPriority::RoundRobin }) {
+                if (ImGui::Selectable(getStr(priority).c_str(), priority == processingTuning.priority)) {
+                    processingTuning.priority = priority;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        if (processingTuning.priority != ThreadPriority::Normal) {
+            ImGui::TextWrapped("Priority Level");
+            ImGui::InputInt("##priorityLevel", &processingTuning.priorityLevel, 1, 10);
+            processingTuning.priorityLevel = std::clamp(processingTuning.priorityLevel, ThreadTuning::minPriorityLevel, ThreadTuning::maxPriorityLevel - 1);
+        }
+        ImGui::TextWrapped("Processing CPUs (none = all)");
+        affinityCheckboxes("processingCpus", processingTuning.affinityMask);
+        ImGui::TextWrapped("UI CPUs (none = all)");
+        affinityCheckboxes("uiCpus", uiTuning.affinityMask);
+        ImGui::Checkbox("Lock Memory", &lockMemory);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Keeps everything, the full history included, in ram. Needs an unlimited memlock limit to cover what is allocated later.");
+        }
+        if (ImGui::Button("Apply")) {
+            applyTuning();
+        }
+        if (running && processingTuning.priority != ThreadPriority::Normal) {
+            ImGui::TextWrapped("Restart audio for the callback priority.");
+        }
+        ImGui::TextWrapped("Threads: %s", tuningStatus.c_str());
     }
 
     ImGui::PopItemWidth();
@@ -0,0 +1,153 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_audiostats_h
+#define laa_audiostats_h
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Counters for everything that can go wrong between the driver and the processing
+ *
+ * Written by the audio callback and the processing, read by anyone. All of them are lock free atomics, so reading never blocks the callback.
+ */
+struct AudioStats {
+    /// the driver reported an input overflow: samples were lost before they reached us
+    std::atomic<uint64_t> inputOverflows = 0;
+    /// the driver reported an output underflow: the playback had a gap
+    std::atomic<uint64_t> outputUnderflows = 0;
+    /// the capture ring was full: samples were lost because the processing fell too far behind
+    std::atomic<uint64_t> captureOverflows = 0;
+    /// analysis frames that were captured, but skipped by the backpressure policy
+    std::atomic<uint64_t> droppedFrames = 0;
+    /// frames that contain a discontinuity (an overflow hit them while they were captured)
+    std::atomic<uint64_t> partialFrames = 0;
+
+    /**
+     * \brief Set all counters back to 0
+     */
+    void reset() noexcept
+    {
+        inputOverflows = 0;
+        outputUnderflows = 0;
+        captureOverflows = 0;
+        droppedFrames = 0;
+        partialFrames = 0;
+    }
+
+    /**
+     * \brief Sum of all counters. If this changes, something happened.
+     * \return sum of all counters
+     */
+    [[nodiscard]] uint64_t total() const noexcept
+    {
+        return inputOverflows + outputUnderflows + captureOverflows + droppedFrames + partialFrames;
+    }
+
+    /**
+     * \brief All counters in one line, for the ui and the log
+     * \return the counters as a string
+     */
+    [[nodiscard]] std::string toString() const
+    {
+        return "overflows: " + std::to_string(inputOverflows)
+            + " underflows: " + std::to_string(outputUnderflows)
+            + " buffer overflows: " + std::to_string(captureOverflows)
+            + " dropped frames: " + std::to_string(droppedFrames)
+            + " partial frames: " + std::to_string(partialFrames);
+    }
+};
+
+/**
+ * \brief Timing of the processing, for benchmarks
+ *
+ * Kept apart from AudioStats: these change on every frame, so they would flood the log.
+ */
+struct ProcessingStats {
+    /// frames processed
+    std::atomic<uint64_t> frames = 0;
+    /// time spent in processing, summed over all frames
+    std::atomic<uint64_t> totalMicros = 0;
+    /// longest time a single frame took
+    std::atomic<uint64_t> maxMicros = 0;
+    /// for the last frame: stream time between its last sample being captured and it being published
+    std::atomic<uint64_t> latencyMicros = 0;
+
+    /**
+     * \brief Set all counters back to 0
+     */
+    void reset() noexcept
+    {
+        frames = 0;
+        totalMicros = 0;
+        maxMicros = 0;
+        latencyMicros = 0;
+    }
+
+    /**
+     * \brief Account for one processed frame. Only called by the processing.
+     * \param micros time the processing took
+     * \param latency latency of the frame
+     */
+    void add(uint64_t micros, uint64_t latency) noexcept
+    {
+        ++frames;
+        totalMicros += micros;
+        if (micros > maxMicros) {
+            maxMicros = micros;
+        }
+        latencyMicros = latency;
+    }
+
+    /**
+     * \brief Everything in one line, for the ui and the log
+     * \return the timings as a string
+     */
+    [[nodiscard]] std::string toString() const
+    {
+        uint64_t count = frames;
+        double average = count > 0 ? static_cast<double>(totalMicros) / static_cast<double>(count) / 1000.0 : 0.0;
+        return "frames: " + std::to_string(count)
+            + " avg: " + std::to_string(average) + "ms"
+            + " max: " + std::to_string(static_cast<double>(maxMicros) / 1000.0) + "ms"
+            + " latency: " + std::to_string(static_cast<double>(latencyMicros) / 1000.0) + "ms";
+    }
+};
+
+/**
+ * \brief How long it took to get going
+ */
+struct StartupStats {
+    /// launch until the audio handler was set up. 0 if not known.
+    std::atomic<uint64_t> coldStartMicros = 0;
+    /// for the last start: starting the audio until the first frame was published. 0 until there is one.
+    std::atomic<uint64_t> firstFrameMicros = 0;
+
+    /**
+     * \brief Everything in one line, for the ui and the log
+     * \return the timings as a string
+     */
+    [[nodiscard]] std::string toString() const
+    {
+        return "cold start: " + std::to_string(static_cast<double>(coldStartMicros) / 1000.0) + "ms"
+            + " first frame: " + std::to_string(static_cast<double>(firstFrameMicros) / 1000.0) + "ms";
+    }
+};
+
+#endif //laa_audiostats_h
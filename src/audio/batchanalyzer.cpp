@@ -0,0 +1,181 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchanalyzer.h"
+
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <numeric>
+
+std::vector<std::string> BatchAnalyzer::collectFiles(const std::vector<std::string>& paths) noexcept
+{
+    namespace fs = std::filesystem;
+
+    std::vector<std::string> files;
+    for (const auto& path : paths) {
+        std::error_code error;
+        if (!fs::is_directory(path, error)) {
+            files.push_back(path);
+            continue;
+        }
+
+        std::vector<std::string> found;
+        for (const auto& entry : fs::directory_iterator(path, error)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            if (entry.is_regular_file(error) && (extension == ".wav" || extension == ".w64" || extension == ".raw")) {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+
+    return files;
+}
+
+bool BatchAnalyzer::run(const std::vector<std::string>& paths, const Settings& settings, WorkerPool* pool, const FileCallback& onFile) noexcept
+{
+    using namespace std::chrono;
+
+    filesDone = 0;
+    fileTotal = paths.size();
+    filesPerSecond = 0.0;
+    speed = 0.0;
+    errors.clear();
+
+    // every thread that can end up running a job gets its own analyzer, and keeps it between runs
+    std::unique_lock<std::mutex> analyzersGuard(analyzersLock);
+    analyzers.resize((pool != nullptr ? pool->getThreadCount() : 0) + 1);
+    // cancel() reaches the idle ones too, and their flag would stop their next file right away
+    for (auto& analyzer : analyzers) {
+        if (!analyzer) {
+            analyzer = std::make_unique<OfflineAnalyzer>();
+        }
+        analyzer->resetCancel();
+    }
+    analyzersGuard.unlock();
+
+    // largest first. the small ones fill the gaps at the end.
+    std::vector<uintmax_t> sizes(paths.size(), 0);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        std::error_code error;
+        sizes[i] = std::filesystem::file_size(paths[i], error);
+    }
+    std::vector<size_t> order(paths.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) {
+        return sizes[a] > sizes[b];
+    });
+
+    auto start = steady_clock::now();
+    std::atomic<double> audioSeconds = 0.0;
+    auto analyzeFile = [&](size_t index) {
+        if (cancelled) {
+            return;
+        }
+
+        const std::string& path = paths[order[index]];
+        auto& analyzer = *analyzers[pool != nullptr ? pool->getCurrentThreadIndex() : 0];
+        FileSource source;
+        std::string error;
+        bool analyzed = false;
+        if (!source.open(path, settings.rawFormat, settings.rawChannelCount, settings.rawSampleRate)) {
+            error = source.getError();
+        } else {
+            auto fileSettings = OfflineAnalyzer::fromConfig(settings.config, source.getChannelCount());
+            fileSettings.filterConfig = settings.filterConfig;
+            // the pool is busy with the files, so the inputs of a file run on this thread.
+            // without a single frame, the analyzer still holds whatever it did before, that is nothing to report.
+            analyzed = analyzer.run(source, fileSettings, nullptr) && analyzer.getFramesDone() > 0;
+            if (!analyzed && !cancelled) {
+                error = analyzer.getError().empty() ? "Analysis stopped without a result" : analyzer.getError();
+            }
+        }
+
+        double seconds = source.isOpen() ? static_cast<double>(source.getFrameCount()) / static_cast<double>(source.getSampleRate()) : 0.0;
+        {
+            std::lock_guard<std::mutex> guard(resultLock);
+            if (!error.empty()) {
+                errors.push_back(path + ": " + error);
+            } else if (analyzed && !cancelled && onFile) {
+                onFile(path, analyzer.getFrame(), source.getSampleRate(), seconds);
+            }
+        }
+
+        // atomic<double> has no fetch_add before c++20
+        double total = audioSeconds;
+        while (!audioSeconds.compare_exchange_weak(total, total + seconds)) {
+        }
+        ++filesDone;
+        double elapsed = duration<double>(steady_clock::now() - start).count();
+        if (elapsed > 0.0) {
+            filesPerSecond = static_cast<double>(filesDone) / elapsed;
+            speed = audioSeconds / elapsed;
+        }
+    };
+    if (pool != nullptr) {
+        pool->parallelFor(order.size(), analyzeFile);
+    } else {
+        for (size_t index = 0; index < order.size(); ++index) {
+            analyzeFile(index);
+        }
+    }
+
+    bool complete = !cancelled && errors.empty();
+    cancelled = false;
+    return complete;
+}
+
+void BatchAnalyzer::cancel() noexcept
+{
+    cancelled = true;
+    std::lock_guard<std::mutex> guard(analyzersLock);
+    for (auto& analyzer : analyzers) {
+        if (analyzer) {
+            analyzer->cancel();
+        }
+    }
+}
+
+size_t BatchAnalyzer::getFilesDone() const noexcept
+{
+    return filesDone;
+}
+
+size_t BatchAnalyzer::getFileTotal() const noexcept
+{
+    return fileTotal;
+}
+
+double BatchAnalyzer::getFilesPerSecond() const noexcept
+{
+    return filesPerSecond;
+}
+
+double BatchAnalyzer::getSpeed() const noexcept
+{
+    return speed;
+}
+
+const std::vector<std::string>& BatchAnalyzer::getErrors() const noexcept
+{
+    return errors;
+}
@@ -0,0 +1,127 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_batchanalyzer_h
+#define laa_batchanalyzer_h
+
+#include "offlineanalyzer.h"
+
+#include <mutex>
+
+/**
+ * \brief Analyzes many recordings at once, one file per thread
+ *
+ * Files are spread over a worker pool, largest first, so the long ones do not end up last.
+ * Every pool thread keeps its own OfflineAnalyzer, so its states are planned once and reused for every file of the same length.
+ * All of them share the fft plans of a length, see getBestFftPlan().
+ */
+class BatchAnalyzer {
+public:
+    /// called for every analyzed file, one at a time. frame holds the averages over the whole file.
+    using FileCallback = std::function<void(const std::string& path, const OfflineAnalyzer::Frame& frame, unsigned int sampleRate, double seconds)>;
+
+    /**
+     * \brief How to analyze the files
+     */
+    struct Settings {
+        /// lengths, overlap and channel mapping. see OfflineAnalyzer::fromConfig().
+        AudioConfig config = {};
+        /// window and averaging
+        StateFilterConfig filterConfig = {};
+        /// format of raw files
+        SampleFormat rawFormat = SampleFormat::Float32;
+        /// channels of raw files
+        size_t rawChannelCount = 2;
+        /// sample rate of raw files
+        unsigned int rawSampleRate = AudioConfig::defaultSampleRate;
+    };
+
+    /**
+     * \brief Expand directories into the recordings inside of them
+     * \param paths files and directories
+     * \return files. directories contribute their .wav, .w64 and .raw files, sorted by name.
+     */
+    [[nodiscard]] static std::vector<std::string> collectFiles(const std::vector<std::string>& paths) noexcept;
+
+    /**
+     * \brief Analyze files
+     * \param paths the files
+     * \param settings what to do with them
+     * \param pool optional. the files are spread over it.
+     * \param onFile called for every file that was analyzed
+     * \return true if all files were analyzed. false if any failed (see getErrors()), or on cancel().
+     * \note threads are told apart by pool->getCurrentThreadIndex(), so do not call it from a thread of pool itself.
+     */
+    bool run(const std::vector<std::string>& paths, const Settings& settings, WorkerPool* pool, const FileCallback& onFile) noexcept;
+
+    /**
+     * \brief Stop a run() in progress. Files that are being analyzed stop after their current frame. Thread safe.
+     */
+    void cancel() noexcept;
+
+    /**
+     * \brief Files done in the current or last run, failed ones included. Thread safe.
+     * \return file count
+     */
+    [[nodiscard]] size_t getFilesDone() const noexcept;
+
+    /**
+     * \brief Files in the current or last run. Thread safe.
+     * \return file count
+     */
+    [[nodiscard]] size_t getFileTotal() const noexcept;
+
+    /**
+     * \brief Throughput of the current or last run. Thread safe.
+     * \return files per second
+     */
+    [[nodiscard]] double getFilesPerSecond() const noexcept;
+
+    /**
+     * \brief How much faster than real time the current or last run is. Thread safe.
+     * \return seconds of audio per second of processing
+     */
+    [[nodiscard]] double getSpeed() const noexcept;
+
+    /**
+     * \brief What went wrong in the last run
+     * \return one "path: error" per failed file
+     */
+    [[nodiscard]] const std::vector<std::string>& getErrors() const noexcept;
+
+private:
+    /// one per pool thread, plus one for the caller
+    std::vector<std::unique_ptr<OfflineAnalyzer>> analyzers = {};
+    /// protects analyzers against cancel() from other threads while run() sets them up
+    std::mutex analyzersLock = {};
+    /// serializes the callback and errors
+    std::mutex resultLock = {};
+    /// files done
+    std::atomic<size_t> filesDone = 0;
+    /// files in total
+    std::atomic<size_t> fileTotal = 0;
+    /// files per wall clock second
+    std::atomic<double> filesPerSecond = 0.0;
+    /// audio seconds per wall clock second
+    std::atomic<double> speed = 0.0;
+    /// set by cancel()
+    std::atomic<bool> cancelled = false;
+    /// errors of the last run
+    std::vector<std::string> errors = {};
+};
+
+#endif //laa_batchanalyzer_h
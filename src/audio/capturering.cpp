@@ -0,0 +1,114 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "capturering.h"
+
+#include <algorithm>
+
+void CaptureRing::configure(size_t channelCount, size_t newCapacity) noexcept
+{
+    capacity = newCapacity;
+    channels.resize(channelCount);
+    for (auto& channel : channels) {
+        channel.assign(capacity, 0.0);
+    }
+
+    writePos = 0;
+    readPos = 0;
+    gapCount = 0;
+    for (auto& gap : gaps) {
+        gap = 0;
+    }
+}
+
+size_t CaptureRing::getCapacity() const noexcept
+{
+    return capacity;
+}
+
+size_t CaptureRing::getChannelCount() const noexcept
+{
+    return channels.size();
+}
+
+size_t CaptureRing::getWritable() const noexcept
+{
+    return capacity - getReadable();
+}
+
+size_t CaptureRing::getContiguousWritable() const noexcept
+{
+    if (capacity == 0) {
+        return 0;
+    }
+    auto index = static_cast<size_t>(writePos.load(std::memory_order_relaxed) % capacity);
+    return std::min(getWritable(), capacity - index);
+}
+
+double* CaptureRing::getWritePointer(size_t channel) noexcept
+{
+    auto index = static_cast<size_t>(writePos.load(std::memory_order_relaxed) % capacity);
+    return channels[channel].data() + index; // NOLINT
+}
+
+void CaptureRing::commitWrite(size_t count) noexcept
+{
+    writePos.store(writePos.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+void CaptureRing::markGap() noexcept
+{
+    uint64_t count = gapCount.load(std::memory_order_relaxed);
+    gaps[count % maxGaps].store(writePos.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    gapCount.store(count + 1, std::memory_order_release);
+}
+
+size_t CaptureRing::getReadable() const noexcept
+{
+    return static_cast<size_t>(writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire));
+}
+
+void CaptureRing::read(size_t channel, double* dst, size_t count) const noexcept
+{
+    // at most two pieces: up to the end of the buffer, and the rest from the start
+    auto index = static_cast<size_t>(readPos.load(std::memory_order_relaxed) % capacity);
+    size_t first = std::min(count, capacity - index);
+    const auto& src = channels[channel];
+    std::copy_n(src.begin() + static_cast<ptrdiff_t>(index), first, dst);
+    std::copy_n(src.begin(), count - first, dst + first); // NOLINT
+}
+
+bool CaptureRing::hasGap(size_t count) const noexcept
+{
+    uint64_t start = readPos.load(std::memory_order_relaxed);
+    uint64_t end = start + count;
+    uint64_t recorded = std::min<uint64_t>(gapCount.load(std::memory_order_acquire), maxGaps);
+    for (size_t i = 0; i < recorded; ++i) {
+        // a gap right at the start does not matter. the samples before it are not part of this block.
+        uint64_t gap = gaps[i].load(std::memory_order_relaxed);
+        if (gap > start && gap < end) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CaptureRing::consume(size_t count) noexcept
+{
+    readPos.store(readPos.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
@@ -0,0 +1,138 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_capturering_h
+#define laa_capturering_h
+
+#include "../core.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Continuous, multi channel capture buffer between the audio callback and the processing
+ *
+ * Single producer (the callback), single consumer (the processing worker). Neither side ever waits on the other.
+ * Positions are absolute sample counts since configure(), so every sample has a fixed place in time.
+ * If the producer finds the ring full, the samples are lost and a gap is recorded at that position.
+ */
+class CaptureRing {
+public:
+    /**
+     * \brief Set up channels and size. Throws away everything inside.
+     * \param channelCount number of channels
+     * \param capacity samples per channel
+     * \note Neither the producer nor the consumer may use the ring while this runs
+     */
+    void configure(size_t channelCount, size_t capacity) noexcept;
+
+    /**
+     * \brief Samples per channel the ring can hold
+     * \return capacity
+     */
+    [[nodiscard]] size_t getCapacity() const noexcept;
+
+    /**
+     * \brief Number of channels
+     * \return channel count
+     */
+    [[nodiscard]] size_t getChannelCount() const noexcept;
+
+    // producer side
+
+    /**
+     * \brief Number of samples that can be written without overwriting unread ones
+     * \return free space
+     */
+    [[nodiscard]] size_t getWritable() const noexcept;
+
+    /**
+     * \brief Number of samples that can be written in one piece, before the ring wraps
+     * \return contiguous free space, at most getWritable()
+     */
+    [[nodiscard]] size_t getContiguousWritable() const noexcept;
+
+    /**
+     * \brief Where the next sample of a channel goes
+     * \param channel the channel
+     * \return pointer to getContiguousWritable() samples
+     */
+    [[nodiscard]] double* getWritePointer(size_t channel) noexcept;
+
+    /**
+     * \brief Publish written samples to the consumer
+     * \param count number of samples written to every channel
+     */
+    void commitWrite(size_t count) noexcept;
+
+    /**
+     * \brief Record that the samples before the current write position and the ones after are not continuous
+     */
+    void markGap() noexcept;
+
+    // consumer side
+
+    /**
+     * \brief Number of samples ready to be read
+     * \return readable samples
+     */
+    [[nodiscard]] size_t getReadable() const noexcept;
+
+    /**
+     * \brief Copy samples from the current read position, without consuming them
+     * \param channel the channel
+     * \param dst where to put them
+     * \param count number of samples, at most getReadable()
+     */
+    void read(size_t channel, double* dst, size_t count) const noexcept;
+
+    /**
+     * \brief Check if there is a gap within the next count samples
+     * \param count number of samples from the read position
+     * \return true if they are not continuous
+     *
+     * Only the last few gaps are remembered, which is plenty as the consumer checks every frame.
+     */
+    [[nodiscard]] bool hasGap(size_t count) const noexcept;
+
+    /**
+     * \brief Advance the read position, freeing up space for the producer
+     * \param count number of samples, at most getReadable()
+     */
+    void consume(size_t count) noexcept;
+
+private:
+    /// number of gaps we remember
+    static constexpr size_t maxGaps = 16;
+
+    /// sample storage, one per channel
+    std::vector<RealVec> channels = {};
+    /// samples per channel
+    size_t capacity = 0;
+    /// absolute position of the next sample to write. only the producer changes it.
+    std::atomic<uint64_t> writePos = 0;
+    /// absolute position of the next sample to read. only the consumer changes it.
+    std::atomic<uint64_t> readPos = 0;
+    /// absolute positions of the last gaps
+    std::array<std::atomic<uint64_t>, maxGaps> gaps = {};
+    /// number of gaps ever recorded
+    std::atomic<uint64_t> gapCount = 0;
+};
+
+#endif //laa_capturering_h
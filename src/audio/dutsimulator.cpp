@@ -0,0 +1,172 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dutsimulator.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::string getStr(const DutFilter& filter) noexcept
+{
+    switch (filter) {
+    case DutFilter::None:
+        return "None";
+    case DutFilter::LowPass:
+        return "Low Pass";
+    case DutFilter::HighPass:
+        return "High Pass";
+    case DutFilter::Peak:
+        return "Peak";
+    }
+
+    return "";
+}
+
+void DutSimulator::configure(const DutSettings& newSettings, unsigned int newSampleRate) noexcept
+{
+    settings = newSettings;
+    sampleRate = static_cast<double>(newSampleRate);
+
+    switch (settings.filter) {
+    case DutFilter::None:
+        break;
+    case DutFilter::LowPass:
+        biquad.design(BiquadType::LowPass, sampleRate, settings.filterFrequency, settings.filterQ, 0.0);
+        break;
+    case DutFilter::HighPass:
+        biquad.design(BiquadType::HighPass, sampleRate, settings.filterFrequency, settings.filterQ, 0.0);
+        break;
+    case DutFilter::Peak:
+        biquad.design(BiquadType::Peak, sampleRate, settings.filterFrequency, settings.filterQ, settings.filterGainDb);
+        break;
+    }
+    biquad.reset();
+
+    firHistory.assign(settings.firTaps.size(), 0.0);
+    firPos = 0;
+    std::fill(delayLine.begin(), delayLine.end(), 0.0);
+    delayWritten = 0;
+    delaySamples = std::clamp(settings.delayMs, 0.0, DutSettings::maxDelayMs) / 1000.0 * sampleRate;
+    drift = 0.0;
+    noiseGain = std::pow(10.0, settings.noiseDb / 20.0);
+    rng.seed(settings.seed);
+    noise.reset();
+}
+
+double DutSimulator::process(double x) noexcept
+{
+    double y = settings.filter == DutFilter::None ? x : biquad.process(x);
+
+    // plain convolution. the taps are short, and this is not the part we benchmark.
+    if (!firHistory.empty()) {
+        firHistory[firPos] = y;
+        y = 0.0;
+        size_t pos = firPos;
+        for (double tap : settings.firTaps) {
+            y += tap * firHistory[pos];
+            pos = pos == 0 ? firHistory.size() - 1 : pos - 1;
+        }
+        firPos = (firPos + 1) % firHistory.size();
+    }
+
+    delayLine[delayWritten % delayLineSize] = y;
+
+    // read behind by the delay plus the drift, in between two samples.
+    // once the drift does not fit into the delay line anymore, the clocks resync, like a device would with a dropout.
+    double readBack = delaySamples + drift;
+    drift += settings.driftPpm * 1e-6;
+    if (readBack < 0.0 || readBack > static_cast<double>(delayLineSize - 2)) {
+        drift = 0.0;
+        readBack = delaySamples;
+    }
+
+    double pos = static_cast<double>(delayWritten) - readBack;
+    ++delayWritten;
+    if (pos < 0.0) {
+        return 0.0;
+    }
+
+    auto index = static_cast<uint64_t>(pos);
+    double frac = pos - static_cast<double>(index);
+    double a = delayLine[index % delayLineSize];
+    double b = delayLine[(index + 1) % delayLineSize];
+    return a + frac * (b - a);
+}
+
+double DutSimulator::nextNoise() noexcept
+{
+    return noiseGain * noise(rng);
+}
+
+bool DutSimulator::nextDropout() noexcept
+{
+    return settings.dropoutRate > 0.0 && unit(rng) < settings.dropoutRate;
+}
+
+std::complex<double> DutSimulator::getResponse(double frequency) const noexcept
+{
+    std::complex<double> response = settings.filter == DutFilter::None ? 1.0 : biquad.getResponse(frequency, sampleRate);
+
+    if (!settings.firTaps.empty()) {
+        std::complex<double> fir = 0.0;
+        for (size_t k = 0; k < settings.firTaps.size(); ++k) {
+            fir += settings.firTaps[k] * std::polar(1.0, -2.0 * LAA_PI * frequency * static_cast<double>(k) / sampleRate);
+        }
+        response *= fir;
+    }
+
+    return response;
+}
+
+DutError DutSimulator::compare(const StateData& data) const noexcept
+{
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+    static constexpr double minCoherence = 0.9;
+    // below this the expected magnitude is so small that noise alone makes huge errors
+    static constexpr double minMagnitude = 1e-3;
+
+    DutError error;
+    if (data.fftLen == 0 || data.sampleRate <= 0.0) {
+        return error;
+    }
+
+    double sumSquares = 0.0;
+    double binWidth = data.sampleRate / static_cast<double>(data.fftLen);
+    for (size_t i = 1; i < data.fftLen / 2; ++i) {
+        double frequency = static_cast<double>(i) * binWidth;
+        if (frequency < minFrequency || frequency > maxFrequency || data.coherence[i] < minCoherence) {
+            continue;
+        }
+
+        double expected = std::abs(getResponse(frequency));
+        double measured = std::abs(data.transferFunction[i]);
+        if (expected < minMagnitude || measured <= 0.0) {
+            continue;
+        }
+
+        double errorDb = 20.0 * std::log10(measured / expected);
+        sumSquares += errorDb * errorDb;
+        error.maxDb = std::max(error.maxDb, std::abs(errorDb));
+        ++error.bins;
+    }
+
+    if (error.bins > 0) {
+        error.rmsDb = std::sqrt(sumSquares / static_cast<double>(error.bins));
+    }
+    return error;
+}
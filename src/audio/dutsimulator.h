@@ -0,0 +1,166 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_dutsimulator_h
+#define laa_dutsimulator_h
+
+#include "../dsp/biquad.h"
+#include "../state/statedata.h"
+
+#include <complex>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Filter the simulated device applies
+ */
+enum class DutFilter {
+    None,
+    LowPass,
+    HighPass,
+    Peak
+};
+
+/**
+ * \brief Convert the DutFilter enum to a string
+ * \param filter DutFilter to stringify
+ * \return filter as a string
+ */
+std::string getStr(const DutFilter& filter) noexcept;
+
+/**
+ * \brief Everything the simulated device does to the stimulus
+ */
+struct DutSettings {
+    /// Longest delay the device can have
+    static constexpr double maxDelayMs = 1000.0;
+
+    /// biquad shape
+    DutFilter filter = DutFilter::Peak;
+    /// corner or center frequency of the biquad
+    double filterFrequency = 1000.0;
+    /// quality of the biquad
+    double filterQ = 1.0;
+    /// gain of the biquad, only for Peak
+    double filterGainDb = 6.0;
+    /// fir taps, applied after the biquad. empty for none.
+    std::vector<double> firTaps = {};
+    /// delay between stimulus and response
+    double delayMs = 1.0;
+    /// level of the white noise added to every input, relative to full scale
+    double noiseDb = -80.0;
+    /// how much faster the device clock runs than ours. negative for slower.
+    double driftPpm = 0.0;
+    /// chance that a buffer gets lost, 0..1
+    double dropoutRate = 0.0;
+    /// seed for noise and dropouts, so runs can be repeated exactly
+    unsigned int seed = 1;
+};
+
+/**
+ * \brief How far a measurement is from what the simulated device actually does
+ */
+struct DutError {
+    /// rms of the magnitude error
+    double rmsDb = 0.0;
+    /// largest magnitude error
+    double maxDb = 0.0;
+    /// number of bins that went into it
+    size_t bins = 0;
+};
+
+/**
+ * \brief A simulated device under test: filter, delay, drift, noise and dropouts
+ *
+ * Processes one sample at a time. Everything random comes from a seeded generator, so two runs with the same settings match.
+ */
+class DutSimulator {
+public:
+    /**
+     * \brief Set up the device, and clear all state
+     * \param settings what the device does
+     * \param sampleRate the sample rate
+     */
+    void configure(const DutSettings& settings, unsigned int sampleRate) noexcept;
+
+    /**
+     * \brief Feed a stimulus sample through filter, delay and drift
+     * \param x stimulus sample
+     * \return response sample, without noise
+     */
+    double process(double x) noexcept;
+
+    /**
+     * \brief Next noise sample. Every input calls this on its own, so their noise is uncorrelated.
+     * \return noise sample
+     */
+    double nextNoise() noexcept;
+
+    /**
+     * \brief Roll for a dropout
+     * \return true if the next buffer gets lost
+     */
+    bool nextDropout() noexcept;
+
+    /**
+     * \brief The response of filter and fir, without the delay
+     * \param frequency where to evaluate it
+     * \return complex response
+     */
+    [[nodiscard]] std::complex<double> getResponse(double frequency) const noexcept;
+
+    /**
+     * \brief Compare a measured transfer function to the simulated one
+     * \param data a processed state
+     * \return error in 20Hz..20kHz, only where the coherence is good
+     */
+    [[nodiscard]] DutError compare(const StateData& data) const noexcept;
+
+private:
+    /// size of the delay line. power of two, holds the longest delay plus a lot of drift.
+    static constexpr size_t delayLineSize = 1U << 17U;
+
+    /// the settings
+    DutSettings settings = {};
+    /// the sample rate
+    double sampleRate = 48000.0;
+    /// the filter
+    Biquad biquad = {};
+    /// past inputs of the fir
+    std::vector<double> firHistory = {};
+    /// position of the newest sample in firHistory
+    size_t firPos = 0;
+    /// the delay line
+    std::vector<double> delayLine = std::vector<double>(delayLineSize, 0.0);
+    /// samples written into the delay line
+    uint64_t delayWritten = 0;
+    /// delay in samples
+    double delaySamples = 0.0;
+    /// how many samples the clocks have drifted apart so far
+    double drift = 0.0;
+    /// noise standard deviation
+    double noiseGain = 0.0;
+    /// random numbers for noise and dropouts
+    std::mt19937 rng = {};
+    /// the noise distribution
+    std::normal_distribution<double> noise = {};
+    /// dropout distribution
+    std::uniform_real_distribution<double> unit = {};
+};
+
+#endif //laa_dutsimulator_h
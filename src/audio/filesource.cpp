@@ -0,0 +1,300 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "filesource.h"
+#include "wave64.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// wav is little endian, and so is everything we run on
+template <class T>
+static T readLe(const unsigned char* data) noexcept
+{
+    T value = {};
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// compare a chunk id
+static bool isId(const unsigned char* data, const char* id) noexcept
+{
+    return std::memcmp(data, id, 4) == 0;
+}
+
+FileSource::~FileSource() noexcept
+{
+    close();
+}
+
+bool FileSource::openWav(const std::string& path) noexcept
+{
+    if (!map(path)) {
+        return false;
+    }
+
+    static constexpr size_t riffHeaderSize = 12;
+    static constexpr size_t riffChunkHeaderSize = 8;
+    static constexpr size_t wave64HeaderSize = 40;
+    static constexpr size_t minFmtSize = 16;
+    static constexpr uint16_t formatPcm = 1;
+    static constexpr uint16_t formatFloat = 3;
+    static constexpr uint16_t formatExtensible = 0xFFFE;
+    static constexpr size_t extensibleSubformatOffset = 24;
+
+    // both are chunk based, they just differ in how a chunk looks
+    bool isRiff = mappingSize >= riffHeaderSize && isId(mapping, "RIFF") && isId(mapping + 8, "WAVE"); // NOLINT
+    bool isWave64 = mappingSize >= wave64HeaderSize
+        && std::memcmp(mapping, wave64::riffGuid.data(), wave64::guidSize) == 0
+        && std::memcmp(mapping + 24, wave64::waveGuid.data(), wave64::guidSize) == 0; // NOLINT
+    if (!isRiff && !isWave64) {
+        close();
+        error = "Not a WAV or Wave64 file";
+        return false;
+    }
+
+    // walk the chunks. we only care about fmt and data, the rest is skipped.
+    uint16_t tag = 0;
+    uint16_t bits = 0;
+    bool haveFmt = false;
+    size_t dataSize = 0;
+    size_t headerSize = isRiff ? riffChunkHeaderSize : wave64::chunkHeaderSize;
+    size_t pos = isRiff ? riffHeaderSize : wave64HeaderSize;
+    while (pos + headerSize <= mappingSize) {
+        const unsigned char* chunk = mapping + pos; // NOLINT
+        const unsigned char* body = chunk + headerSize; // NOLINT
+        size_t bodyAvailable = mappingSize - pos - headerSize;
+        bool isFmt = false;
+        bool isData = false;
+        uint64_t chunkSize = 0;
+        if (isRiff) {
+            chunkSize = readLe<uint32_t>(chunk + 4); // NOLINT
+            isFmt = isId(chunk, "fmt ");
+            isData = isId(chunk, "data");
+        } else {
+            // wave64 sizes include the chunk header
+            chunkSize = readLe<uint64_t>(chunk + wave64::guidSize); // NOLINT
+            chunkSize = chunkSize > headerSize ? chunkSize - headerSize : 0;
+            isFmt = std::memcmp(chunk, wave64::fmtGuid.data(), wave64::guidSize) == 0;
+            isData = std::memcmp(chunk, wave64::dataGuid.data(), wave64::guidSize) == 0;
+        }
+
+        if (isFmt && chunkSize >= minFmtSize && bodyAvailable >= minFmtSize) {
+            tag = readLe<uint16_t>(body);
+            channelCount = readLe<uint16_t>(body + 2); // NOLINT
+            sampleRate = readLe<uint32_t>(body + 4); // NOLINT
+            bits = readLe<uint16_t>(body + 14); // NOLINT
+            if (tag == formatExtensible && chunkSize >= extensibleSubformatOffset + 2 && bodyAvailable >= extensibleSubformatOffset + 2) {
+                tag = readLe<uint16_t>(body + extensibleSubformatOffset); // NOLINT
+            }
+            haveFmt = true;
+        } else if (isData) {
+            samples = body;
+            // recorders that died on the way leave a bogus size behind, so trust the file more than the header
+            dataSize = static_cast<size_t>(std::min<uint64_t>(chunkSize, bodyAvailable));
+            break;
+        }
+
+        // chunks are padded to an even size, wave64 ones to 8 bytes
+        if (chunkSize >= mappingSize) {
+            break;
+        }
+        pos += headerSize + static_cast<size_t>(isRiff ? chunkSize + (chunkSize & 1U) : wave64::align(static_cast<size_t>(chunkSize)));
+    }
+
+    if (!haveFmt || samples == nullptr) {
+        close();
+        error = "File without fmt or data chunk";
+        return false;
+    }
+
+    if (tag == formatFloat && bits == 32) {
+        format = SampleFormat::Float32;
+    } else if (tag == formatPcm && bits == 32) {
+        format = SampleFormat::Int32;
+    } else if (tag == formatPcm && bits == 24) {
+        format = SampleFormat::Int24;
+    } else if (tag == formatPcm && bits == 16) {
+        format = SampleFormat::Int16;
+    } else {
+        close();
+        error = "Unsupported format " + std::to_string(tag) + " with " + std::to_string(bits) + " bits";
+        return false;
+    }
+
+    if (channelCount == 0) {
+        close();
+        error = "File without channels";
+        return false;
+    }
+
+    frameCount = dataSize / (getSampleSize(format) * channelCount);
+    return true;
+}
+
+bool FileSource::open(const std::string& path, SampleFormat rawFormat, size_t rawChannelCount, unsigned int rawSampleRate) noexcept
+{
+    // anything that does not look like a wav is taken as raw samples
+    std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    return extension == ".wav" || extension == ".w64" ? openWav(path) : openRaw(path, rawFormat, rawChannelCount, rawSampleRate);
+}
+
+bool FileSource::openRaw(const std::string& path, SampleFormat newFormat, size_t newChannelCount, unsigned int newSampleRate) noexcept
+{
+    if (newChannelCount == 0) {
+        error = "Raw files need at least one channel";
+        return false;
+    }
+
+    if (!map(path)) {
+        return false;
+    }
+
+    samples = mapping;
+    format = newFormat;
+    channelCount = newChannelCount;
+    sampleRate = newSampleRate;
+    frameCount = mappingSize / (getSampleSize(format) * channelCount);
+    return true;
+}
+
+bool FileSource::map(const std::string& path) noexcept
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Could not open " + path;
+        return false;
+    }
+    LARGE_INTEGER size = {};
+    GetFileSizeEx(file, &size);
+    mappingSize = static_cast<size_t>(size.QuadPart);
+    HANDLE mapObject = mappingSize > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    if (mapObject != nullptr) {
+        mapping = static_cast<const unsigned char*>(MapViewOfFile(mapObject, FILE_MAP_READ, 0, 0, 0));
+        // the view keeps the file alive
+        CloseHandle(mapObject);
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY); // NOLINT
+    if (fd < 0) {
+        error = "Could not open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info = {};
+    fstat(fd, &info);
+    mappingSize = static_cast<size_t>(info.st_size);
+    if (mappingSize > 0) {
+        void* result = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (result != MAP_FAILED) { // NOLINT
+            mapping = static_cast<const unsigned char*>(result);
+            // we walk through it front to back, so let the kernel read ahead
+            madvise(result, mappingSize, MADV_SEQUENTIAL);
+        }
+    }
+    // the mapping keeps the file alive
+    ::close(fd);
+#endif
+
+    if (mapping == nullptr) {
+        mappingSize = 0;
+        error = "Could not map " + path;
+        return false;
+    }
+
+    error.clear();
+    return true;
+}
+
+void FileSource::close() noexcept
+{
+    if (mapping != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping);
+#else
+        // mapping is const for us, but not for munmap NOLINTNEXTLINE
+        munmap(const_cast<unsigned char*>(mapping), mappingSize);
+#endif
+    }
+
+    mapping = nullptr;
+    mappingSize = 0;
+    samples = nullptr;
+    channelCount = 0;
+    sampleRate = 0;
+    frameCount = 0;
+}
+
+bool FileSource::isOpen() const noexcept
+{
+    return mapping != nullptr;
+}
+
+const std::string& FileSource::getError() const noexcept
+{
+    return error;
+}
+
+SampleFormat FileSource::getFormat() const noexcept
+{
+    return format;
+}
+
+size_t FileSource::getChannelCount() const noexcept
+{
+    return channelCount;
+}
+
+unsigned int FileSource::getSampleRate() const noexcept
+{
+    return sampleRate;
+}
+
+size_t FileSource::getFrameCount() const noexcept
+{
+    return frameCount;
+}
+
+size_t FileSource::read(double* const* dst, size_t offset, size_t frames) const noexcept
+{
+    if (offset >= frameCount) {
+        return 0;
+    }
+
+    frames = std::min(frames, frameCount - offset);
+    deinterleave(dst, samples + offset * getSampleSize(format) * channelCount, format, channelCount, frames); // NOLINT
+    return frames;
+}
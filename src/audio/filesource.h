@@ -0,0 +1,148 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_filesource_h
+#define laa_filesource_h
+
+#include "sampleformat.h"
+
+#include <string>
+
+/**
+ * \brief A recording on disk, memory mapped
+ *
+ * Reads WAV and Wave64 files, and headerless raw PCM. Nothing is copied on open, the samples are converted straight out of the mapping.
+ */
+class FileSource {
+public:
+    /// ctor
+    FileSource() noexcept = default;
+    /// dtor. unmaps the file
+    ~FileSource() noexcept;
+    /// deleted
+    FileSource(const FileSource&) = delete;
+    /// deleted
+    FileSource(FileSource&&) = delete;
+    /// deleted
+    FileSource& operator=(const FileSource&) = delete;
+    /// deleted
+    FileSource& operator=(FileSource&&) = delete;
+
+    /**
+     * \brief Open a WAV or Wave64 file
+     * \param path path to the file
+     * \return true on success. On failure, see getError().
+     */
+    bool openWav(const std::string& path) noexcept;
+
+    /**
+     * \brief Open a headerless file of interleaved samples
+     * \param path path to the file
+     * \param format sample format of the file
+     * \param channelCount number of interleaved channels
+     * \param sampleRate sample rate of the recording
+     * \return true on success. On failure, see getError().
+     */
+    bool openRaw(const std::string& path, SampleFormat format, size_t channelCount, unsigned int sampleRate) noexcept;
+
+    /**
+     * \brief Open a file, as WAV or Wave64 if the extension says so and as raw samples otherwise
+     * \param path path to the file
+     * \param rawFormat sample format, if it is raw
+     * \param rawChannelCount number of interleaved channels, if it is raw
+     * \param rawSampleRate sample rate, if it is raw
+     * \return true on success. On failure, see getError().
+     */
+    bool open(const std::string& path, SampleFormat rawFormat, size_t rawChannelCount, unsigned int rawSampleRate) noexcept;
+
+    /**
+     * \brief Unmap the file
+     */
+    void close() noexcept;
+
+    /**
+     * \brief Check if there is an open file
+     * \return true if open
+     */
+    [[nodiscard]] bool isOpen() const noexcept;
+
+    /**
+     * \brief What went wrong on the last open
+     * \return error message
+     */
+    [[nodiscard]] const std::string& getError() const noexcept;
+
+    /**
+     * \brief Sample format of the file
+     * \return the format
+     */
+    [[nodiscard]] SampleFormat getFormat() const noexcept;
+
+    /**
+     * \brief Number of interleaved channels
+     * \return channel count
+     */
+    [[nodiscard]] size_t getChannelCount() const noexcept;
+
+    /**
+     * \brief Sample rate of the recording
+     * \return sample rate
+     */
+    [[nodiscard]] unsigned int getSampleRate() const noexcept;
+
+    /**
+     * \brief Length of the recording
+     * \return number of frames (samples per channel)
+     */
+    [[nodiscard]] size_t getFrameCount() const noexcept;
+
+    /**
+     * \brief Convert and deinterleave a block of the recording
+     * \param dst one pointer per channel. nullptr skips a channel.
+     * \param offset first frame to read
+     * \param frames number of frames to read
+     * \return number of frames actually read. Less than frames at the end of the file.
+     */
+    size_t read(double* const* dst, size_t offset, size_t frames) const noexcept;
+
+private:
+    /**
+     * \brief Map a file into memory
+     * \param path path to the file
+     * \return true on success
+     */
+    bool map(const std::string& path) noexcept;
+
+    /// the whole file
+    const unsigned char* mapping = nullptr;
+    /// size of the mapping in bytes
+    size_t mappingSize = 0;
+    /// first sample inside of the mapping
+    const unsigned char* samples = nullptr;
+    /// format of the samples
+    SampleFormat format = SampleFormat::Float32;
+    /// number of interleaved channels
+    size_t channelCount = 0;
+    /// sample rate
+    unsigned int sampleRate = 0;
+    /// number of frames
+    size_t frameCount = 0;
+    /// last error
+    std::string error = {};
+};
+
+#endif //laa_filesource_h
@@ -0,0 +1,136 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loopbackdevice.h"
+
+#include <chrono>
+
+LoopbackDevice::~LoopbackDevice() noexcept
+{
+    stop();
+}
+
+void LoopbackDevice::start(const AudioConfig& newConfig, const DutSettings& dutSettings, double newPace, RtAudioCallback newCallback, void* newUserData) noexcept
+{
+    stop();
+
+    config = newConfig;
+    pace = newPace;
+    callback = newCallback;
+    userData = newUserData;
+    dut.configure(dutSettings, config.sampleRate);
+    speed = 0.0;
+
+    running = true;
+    thread = std::thread([this]() {
+        run();
+    });
+}
+
+void LoopbackDevice::stop() noexcept
+{
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool LoopbackDevice::isRunning() const noexcept
+{
+    return running;
+}
+
+double LoopbackDevice::getSpeed() const noexcept
+{
+    return speed;
+}
+
+const DutSimulator& LoopbackDevice::getDut() const noexcept
+{
+    return dut;
+}
+
+void LoopbackDevice::run() noexcept
+{
+    using namespace std::chrono;
+
+    const size_t frames = std::max(config.bufferFrames, 1U);
+    const size_t outChannels = config.playbackParams.nChannels;
+    const size_t inChannels = config.getCaptureChannelCount();
+    const auto rate = static_cast<double>(config.sampleRate);
+
+    // which capture channel gets what. everything not mapped stays silent.
+    std::vector<bool> isInput(inChannels, false);
+    for (unsigned int input = 0; input < config.inputChannelCount; ++input) {
+        isInput[config.getInputChannel(input)] = true;
+    }
+    const size_t referenceChannel = config.internalReference ? inChannels : config.getReferenceChannel();
+
+    std::vector<float> out(frames * outChannels, 0.0F);
+    std::vector<float> in(frames * inChannels, 0.0F);
+    std::vector<double> played(frames, 0.0);
+
+    const auto bufferTime = duration_cast<steady_clock::duration>(duration<double>(static_cast<double>(frames) / rate / std::max(pace, 1e-3)));
+    const auto start = steady_clock::now();
+    auto deadline = start;
+    uint64_t streamFrames = 0;
+    RtAudioStreamStatus status = 0;
+
+    while (running) {
+        // the device keeps running during a dropout, we just never see its samples
+        bool dropout = dut.nextDropout();
+        for (size_t i = 0; i < frames; ++i) {
+            double response = dut.process(played[i]);
+            for (size_t channel = 0; channel < inChannels; ++channel) {
+                double sample = 0.0;
+                if (channel == referenceChannel) {
+                    sample = played[i];
+                } else if (isInput[channel]) {
+                    sample = response + dut.nextNoise();
+                }
+                in[i * inChannels + channel] = dropout ? 0.0F : static_cast<float>(sample);
+            }
+        }
+        if (dropout) {
+            status |= RTAUDIO_INPUT_OVERFLOW;
+        }
+
+        callback(out.data(), in.data(), static_cast<unsigned int>(frames), static_cast<double>(streamFrames) / rate, status, userData);
+        status = 0;
+
+        // all output channels carry the same signal, the first one is enough
+        for (size_t i = 0; i < frames; ++i) {
+            played[i] = out[i * outChannels];
+        }
+        streamFrames += frames;
+
+        // a real device would not wait for a late callback, it would run dry
+        if (pace > 0.0) {
+            deadline += bufferTime;
+            auto now = steady_clock::now();
+            if (now > deadline + bufferTime) {
+                status |= RTAUDIO_OUTPUT_UNDERFLOW;
+                deadline = now;
+            } else {
+                std::this_thread::sleep_until(deadline);
+            }
+        }
+
+        double elapsed = duration<double>(steady_clock::now() - start).count();
+        speed = elapsed > 0.0 ? static_cast<double>(streamFrames) / rate / elapsed : 0.0;
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_loopbackdevice_h
+#define laa_loopbackdevice_h
+
+#include "audioconfig.h"
+#include "dutsimulator.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief A software audio device with a simulated device under test between output and input
+ *
+ * Stands in for RtAudio: a thread calls the stream callback with float32 buffers, laid out like the config says.
+ * What the callback plays comes back on the next call, like on a real interface. The reference channel gets it clean, the inputs get it through the DutSimulator.
+ * Runs in real time, faster, or as fast as the callback allows, so the whole pipeline can be benchmarked without hardware.
+ */
+class LoopbackDevice {
+public:
+    /// ctor
+    LoopbackDevice() noexcept = default;
+    /// dtor. stops the device
+    ~LoopbackDevice() noexcept;
+    /// deleted
+    LoopbackDevice(const LoopbackDevice&) = delete;
+    /// deleted
+    LoopbackDevice(LoopbackDevice&&) = delete;
+    /// deleted
+    LoopbackDevice& operator=(const LoopbackDevice&) = delete;
+    /// deleted
+    LoopbackDevice& operator=(LoopbackDevice&&) = delete;
+
+    /**
+     * \brief Start calling the callback
+     * \param config channels, rate and buffer size. sampleFormat has to be Float32.
+     * \param dut what happens between output and input
+     * \param pace 1 for real time, 10 for ten times as fast, 0 for as fast as possible
+     * \param callback the stream callback
+     * \param userData handed to the callback
+     */
+    void start(const AudioConfig& config, const DutSettings& dut, double pace, RtAudioCallback callback, void* userData) noexcept;
+
+    /**
+     * \brief Stop calling the callback, and wait until the last call is done
+     */
+    void stop() noexcept;
+
+    /**
+     * \brief Check if the device is running
+     * \return true if running
+     */
+    [[nodiscard]] bool isRunning() const noexcept;
+
+    /**
+     * \brief How much faster than real time the device actually runs. Thread safe.
+     * \return stream seconds per wall clock second
+     */
+    [[nodiscard]] double getSpeed() const noexcept;
+
+    /**
+     * \brief The simulated device. Its response can be read while running.
+     * \return the simulator
+     */
+    [[nodiscard]] const DutSimulator& getDut() const noexcept;
+
+private:
+    /// device thread main
+    void run() noexcept;
+
+    /// copy of the config we were started with
+    AudioConfig config = {};
+    /// stream seconds per wall clock second we aim for. 0 for unlimited.
+    double pace = 1.0;
+    /// the stream callback
+    RtAudioCallback callback = nullptr;
+    /// handed to the callback
+    void* userData = nullptr;
+    /// the simulated device
+    DutSimulator dut = {};
+    /// the device thread
+    std::thread thread = {};
+    /// true while the thread runs
+    std::atomic<bool> running = false;
+    /// measured speed
+    std::atomic<double> speed = 0.0;
+};
+
+#endif //laa_loopbackdevice_h
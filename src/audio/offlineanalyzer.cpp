@@ -0,0 +1,157 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "offlineanalyzer.h"
+
+#include <chrono>
+
+OfflineAnalyzer::Settings OfflineAnalyzer::fromConfig(const AudioConfig& config, size_t fileChannels) noexcept
+{
+    // a file always has its reference in it, so map it like an external reference on a device with that many channels
+    Settings settings;
+    settings.analysisSamples = config.analysisSamples;
+    settings.hopSamples = config.getHopSamples();
+    settings.inputChannels.clear();
+    if (fileChannels < 2) {
+        return settings;
+    }
+
+    size_t inputs = fileChannels - 1;
+    settings.referenceChannel = config.inputAndReferenceAreSwapped ? inputs : 0;
+    for (size_t input = 0; input < inputs; ++input) {
+        settings.inputChannels.push_back(config.inputAndReferenceAreSwapped ? input : input + 1);
+    }
+
+    return settings;
+}
+
+bool OfflineAnalyzer::run(const FileSource& source, const Settings& settings, WorkerPool* pool, const FrameCallback& onFrame) noexcept
+{
+    using namespace std::chrono;
+
+    framesDone = 0;
+    frameTotal = 0;
+    speed = 0.0;
+    error.clear();
+
+    // check everything up front, so we do not fail half way through
+    const size_t length = settings.analysisSamples;
+    const size_t channels = source.getChannelCount();
+    if (!source.isOpen()) {
+        error = "No file open";
+    } else if (settings.inputChannels.empty()) {
+        error = "Need a reference and at least one input channel";
+    } else if (settings.referenceChannel >= channels) {
+        error = "Reference channel is not in the file";
+    } else if (source.getFrameCount() < length) {
+        error = "File is shorter than one analysis frame";
+    }
+    for (auto input : settings.inputChannels) {
+        if (input >= channels || input == settings.referenceChannel) {
+            error = "Input channel " + std::to_string(input) + " is not in the file, or is the reference";
+        }
+    }
+    if (!error.empty()) {
+        cancelled = false;
+        return false;
+    }
+
+    // planning is slow, keep the states if we can
+    if (frame.size() != settings.inputChannels.size() || frame[0]->getData().fftLen != length) {
+        frame.clear();
+        for (size_t i = 0; i < settings.inputChannels.size(); ++i) {
+            frame.push_back(std::make_shared<State>(length));
+        }
+    }
+    filterConfigs.assign(frame.size(), settings.filterConfig);
+    for (auto& state : frame) {
+        auto& data = state->accessData();
+        data.sampleRate = static_cast<double>(source.getSampleRate());
+        data.fftDuration = static_cast<double>(length) / data.sampleRate;
+    }
+
+    const size_t hop = std::max(settings.hopSamples, static_cast<size_t>(1));
+    frameTotal = (source.getFrameCount() - length) / hop + 1;
+    std::vector<double*> targets(channels, nullptr);
+    auto start = steady_clock::now();
+
+    for (size_t index = 0; index < frameTotal && !cancelled; ++index) {
+        // straight from the mapping into the states. the reference only goes into the first one, like in the live capture.
+        for (size_t input = 0; input < frame.size(); ++input) {
+            targets[settings.inputChannels[input]] = frame[input]->accessData().input.data();
+        }
+        targets[settings.referenceChannel] = frame[0]->accessData().reference.data();
+        source.read(targets.data(), index * hop, length);
+
+        Analyzer::calcFrame(frame, filterConfigs, pool);
+
+        if (onFrame) {
+            onFrame(index, frame);
+        }
+
+        framesDone = index + 1;
+        double elapsed = duration<double>(steady_clock::now() - start).count();
+        double processed = static_cast<double>(index * hop + length) / static_cast<double>(source.getSampleRate());
+        speed = elapsed > 0.0 ? processed / elapsed : 0.0;
+    }
+
+    bool complete = !cancelled;
+    cancelled = false;
+    return complete;
+}
+
+void OfflineAnalyzer::cancel() noexcept
+{
+    cancelled = true;
+}
+
+void OfflineAnalyzer::resetCancel() noexcept
+{
+    cancelled = false;
+}
+
+OfflineAnalyzer::Frame OfflineAnalyzer::takeResult() noexcept
+{
+    Frame result;
+    std::swap(result, frame);
+    return result;
+}
+
+const OfflineAnalyzer::Frame& OfflineAnalyzer::getFrame() const noexcept
+{
+    return frame;
+}
+
+size_t OfflineAnalyzer::getFramesDone() const noexcept
+{
+    return framesDone;
+}
+
+size_t OfflineAnalyzer::getFrameTotal() const noexcept
+{
+    return frameTotal;
+}
+
+double OfflineAnalyzer::getSpeed() const noexcept
+{
+    return speed;
+}
+
+const std::string& OfflineAnalyzer::getError() const noexcept
+{
+    return error;
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_offlineanalyzer_h
+#define laa_offlineanalyzer_h
+
+#include "../state/analyzer.h"
+#include "../workerpool.h"
+#include "audioconfig.h"
+#include "filesource.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/**
+ * \brief Runs a recording through the same processing as the live capture, as fast as the cpu allows
+ *
+ * Frames are cut from the file on the hop grid, exactly like the processing worker does with the capture ring.
+ * There is no pacing at all, and the result does not depend on timing, so it is also a deterministic benchmark.
+ */
+class OfflineAnalyzer {
+public:
+    /// one state per input channel. the first one also does the reference.
+    using Frame = Analyzer::Frame;
+    /// called after every frame, from the thread that called run()
+    using FrameCallback = std::function<void(size_t index, const Frame& frame)>;
+
+    /**
+     * \brief What to analyze, and how
+     */
+    struct Settings {
+        /// length of a frame
+        size_t analysisSamples = AudioConfig::defaultAnalysisSamples;
+        /// distance between the starts of two frames
+        size_t hopSamples = AudioConfig::defaultAnalysisSamples;
+        /// file channel with the reference
+        size_t referenceChannel = 0;
+        /// file channels with the inputs. one state per entry.
+        std::vector<size_t> inputChannels = { 1 };
+        /// window and averaging settings. every input gets its own copy.
+        StateFilterConfig filterConfig = {};
+    };
+
+    /**
+     * \brief Build the settings the live capture would use for a file
+     * \param config the audio config. reference and inputs are mapped like on the capture device.
+     * \param fileChannels number of channels in the file
+     * \return the settings
+     */
+    [[nodiscard]] static Settings fromConfig(const AudioConfig& config, size_t fileChannels) noexcept;
+
+    /**
+     * \brief Analyze a file
+     * \param source the file
+     * \param settings what to do with it
+     * \param pool optional. the inputs of a frame are spread over it.
+     * \param onFrame optional, called after every frame
+     * \return true if the whole file was analyzed. false on errors (see getError()) or cancel().
+     */
+    bool run(const FileSource& source, const Settings& settings, WorkerPool* pool, const FrameCallback& onFrame = nullptr) noexcept;
+
+    /**
+     * \brief Stop a run() in progress after the current frame. Thread safe.
+     */
+    void cancel() noexcept;
+
+    /**
+     * \brief Forget a cancel() that came in while no run() was going on. Otherwise the next run() stops right away.
+     */
+    void resetCancel() noexcept;
+
+    /**
+     * \brief Take the last frame of the last run. The analyzer plans new states on the next run.
+     * \return the frame, with the averages over the whole file in it
+     */
+    Frame takeResult() noexcept;
+
+    /**
+     * \brief Look at the last frame of the last run, without taking it. Valid until the next run().
+     * \return the frame
+     */
+    [[nodiscard]] const Frame& getFrame() const noexcept;
+
+    /**
+     * \brief Frames done in the current or last run. Thread safe.
+     * \return frame count
+     */
+    [[nodiscard]] size_t getFramesDone() const noexcept;
+
+    /**
+     * \brief Frames in the current or last run. Thread safe.
+     * \return frame count
+     */
+    [[nodiscard]] size_t getFrameTotal() const noexcept;
+
+    /**
+     * \brief How much faster than real time the current or last run is. Thread safe.
+     * \return seconds of audio per second of processing
+     */
+    [[nodiscard]] double getSpeed() const noexcept;
+
+    /**
+     * \brief What went wrong in the last run
+     * \return error message. empty if nothing did.
+     */
+    [[nodiscard]] const std::string& getError() const noexcept;
+
+private:
+    /// the states we process in
+    Frame frame = {};
+    /// a filter per input, so they average on their own
+    std::vector<StateFilterConfig> filterConfigs = {};
+    /// frames done
+    std::atomic<size_t> framesDone = 0;
+    /// frames in total
+    std::atomic<size_t> frameTotal = 0;
+    /// audio seconds per wall clock second
+    std::atomic<double> speed = 0.0;
+    /// set by cancel()
+    std::atomic<bool> cancelled = false;
+    /// last error
+    std::string error = {};
+};
+
+#endif //laa_offlineanalyzer_h
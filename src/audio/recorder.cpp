@@ -0,0 +1,387 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "recorder.h"
+#include "wave64.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// little endian, like everything we run on
+template <class T>
+static void putLe(unsigned char*& out, T value) noexcept
+{
+    std::memcpy(out, &value, sizeof(T));
+    out += sizeof(T); // NOLINT
+}
+
+static void putId(unsigned char*& out, const unsigned char* id, size_t size) noexcept
+{
+    std::memcpy(out, id, size);
+    out += size; // NOLINT
+}
+
+std::string getStr(const RecordingFormat& format) noexcept
+{
+    switch (format) {
+    case RecordingFormat::Wav:
+        return "WAV";
+    case RecordingFormat::W64:
+        return "Wave64";
+    case RecordingFormat::Raw:
+        return "Raw float32";
+    }
+
+    return "";
+}
+
+std::string getExtension(const RecordingFormat& format) noexcept
+{
+    switch (format) {
+    case RecordingFormat::Wav:
+        return ".wav";
+    case RecordingFormat::W64:
+        return ".w64";
+    case RecordingFormat::Raw:
+        return ".raw";
+    }
+
+    return "";
+}
+
+Recorder::~Recorder() noexcept
+{
+    stop();
+}
+
+bool Recorder::start(const std::string& newPath, RecordingFormat newFormat, size_t newChannelCount, unsigned int newSampleRate, size_t ringBytes) noexcept
+{
+    stop();
+
+    format = newFormat;
+    channelCount = newChannelCount;
+    sampleRate = newSampleRate;
+    path = newPath;
+    error.clear();
+    writeError.clear();
+    failed = false;
+    stopping = false;
+    bytesWritten = 0;
+    bytesLost = 0;
+    writePos = 0;
+    readPos = 0;
+
+    if (channelCount == 0) {
+        error = "Nothing to record";
+        return false;
+    }
+
+    // whole chunks, so a chunk never wraps around the end of the ring
+    ringSize = (std::max(ringBytes, writeChunk) + writeChunk - 1) / writeChunk * writeChunk;
+    memory.assign(writeAlignment + writeAlignment + ringSize, 0);
+    auto misalignment = reinterpret_cast<uintptr_t>(memory.data()) % writeAlignment; // NOLINT
+    header = memory.data() + (writeAlignment - misalignment) % writeAlignment; // NOLINT
+    ring = header + writeAlignment; // NOLINT
+    dataOffset = format == RecordingFormat::Raw ? 0 : writeAlignment;
+
+#ifdef __linux__
+    // not every file system can do O_DIRECT. without it, it still works, we just go through the page cache.
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644); // NOLINT
+    if (fd < 0 && errno == EINVAL) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644); // NOLINT
+    }
+    if (fd < 0) {
+        error = "Could not open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    preallocated = 0;
+#else
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        error = "Could not open " + path;
+        return false;
+    }
+    // we write in large chunks anyway
+    std::setvbuf(file, nullptr, _IONBF, 0);
+#endif
+
+    // sizes are unknown until we stop. readers that support it read to the end of the file then.
+    if (dataOffset > 0) {
+        buildHeader(std::numeric_limits<uint64_t>::max());
+        if (!writeAt(0, header, writeAlignment)) {
+            error = "Could not write header to " + path;
+            stop();
+            return false;
+        }
+    }
+
+    accepting = true;
+    writerThread = std::thread([this]() {
+        this->writer();
+    });
+    return true;
+}
+
+void Recorder::stop() noexcept
+{
+    // wait until the callback is out of push(), then let the writer drain
+    accepting = false;
+    while (pushing) {
+        std::this_thread::yield();
+    }
+    stopping = true;
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+
+    // the last chunk might be padded, and the preallocation can go
+#ifdef __linux__
+    if (fd >= 0) {
+        if (ftruncate(fd, static_cast<off_t>(dataOffset + bytesWritten)) != 0 && !failed) {
+            error = std::string("Could not truncate: ") + std::strerror(errno);
+        }
+        if (dataOffset > 0 && !failed) {
+            buildHeader(bytesWritten);
+            writeAt(0, header, writeAlignment);
+        }
+        ::close(fd);
+        fd = -1;
+    }
+#else
+    if (file != nullptr) {
+        if (dataOffset > 0 && !failed) {
+            buildHeader(bytesWritten);
+            writeAt(0, header, writeAlignment);
+        }
+        std::fclose(file);
+        file = nullptr;
+    }
+#endif
+}
+
+bool Recorder::isRecording() const noexcept
+{
+    return accepting;
+}
+
+void Recorder::push(const double* const* channels, size_t frames) noexcept
+{
+    pushing = true;
+    if (!accepting) {
+        pushing = false;
+        return;
+    }
+
+    // all or nothing. half a block would shift the channels.
+    size_t bytes = frames * channelCount * sizeof(float);
+    uint64_t pos = writePos.load(std::memory_order_relaxed);
+    if (ringSize - (pos - readPos.load(std::memory_order_acquire)) < bytes) {
+        bytesLost += bytes;
+        pushing = false;
+        return;
+    }
+
+    // the ring is a multiple of the sample size, so a sample never wraps
+    auto index = static_cast<size_t>(pos % ringSize);
+    for (size_t frame = 0; frame < frames; ++frame) {
+        for (size_t channel = 0; channel < channelCount; ++channel) {
+            auto sample = static_cast<float>(channels[channel][frame]); // NOLINT
+            std::memcpy(ring + index, &sample, sizeof(float)); // NOLINT
+            index += sizeof(float);
+            if (index == ringSize) {
+                index = 0;
+            }
+        }
+    }
+
+    writePos.store(pos + bytes, std::memory_order_release);
+    pushing = false;
+}
+
+uint64_t Recorder::getBytesWritten() const noexcept
+{
+    return bytesWritten;
+}
+
+uint64_t Recorder::getBytesLost() const noexcept
+{
+    return bytesLost;
+}
+
+const std::string& Recorder::getPath() const noexcept
+{
+    return path;
+}
+
+std::string Recorder::getError() const noexcept
+{
+    // only read writeError once the writer is done with it
+    if (failed) {
+        return writeError;
+    }
+
+    return error;
+}
+
+void Recorder::writer() noexcept
+{
+    using namespace std::chrono;
+
+    while (true) {
+        // check stopping first: once it is set, push() is done and writePos is final
+        bool draining = stopping;
+        uint64_t pos = readPos.load(std::memory_order_relaxed);
+        uint64_t available = writePos.load(std::memory_order_acquire) - pos;
+        if (available == 0 && draining) {
+            break;
+        }
+        if (available < writeChunk && !draining) {
+            std::this_thread::sleep_for(10ms);
+            continue;
+        }
+
+        // whole chunks until the very end. only the last one can be short, and that one gets padded for O_DIRECT.
+        // stop() truncates the padding away again.
+        auto index = static_cast<size_t>(pos % ringSize);
+        auto size = static_cast<size_t>(std::min<uint64_t>(available, writeChunk));
+#ifdef __linux__
+        size_t paddedSize = (size + writeAlignment - 1) / writeAlignment * writeAlignment;
+        std::fill(ring + index + size, ring + index + paddedSize, 0); // NOLINT
+#else
+        size_t paddedSize = size;
+#endif
+
+        uint64_t offset = dataOffset + bytesWritten;
+#ifdef __linux__
+        // grow the file in big steps, so it does not fragment. if the file system cant, it cant.
+        if (offset + paddedSize > preallocated) {
+            static_cast<void>(fallocate(fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(preallocated), static_cast<off_t>(preallocateStep)));
+            preallocated += preallocateStep;
+        }
+#endif
+
+        // once the disk failed, everything is thrown away, but we keep emptying the ring so push() never blocks
+        if (!failed && !writeAt(offset, ring + index, paddedSize)) { // NOLINT
+            writeError = "Write failed after " + std::to_string(bytesWritten) + " bytes: " + std::strerror(errno);
+            failed = true;
+        }
+        if (failed) {
+            bytesLost += size;
+        } else {
+            bytesWritten += size;
+        }
+
+        readPos.store(pos + size, std::memory_order_release);
+    }
+}
+
+bool Recorder::writeAt(uint64_t offset, const unsigned char* data, size_t size) noexcept
+{
+#ifdef __linux__
+    size_t done = 0;
+    while (done < size) {
+        auto res = pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done)); // NOLINT
+        if (res < 0 && errno == EINVAL && (fcntl(fd, F_GETFL) & O_DIRECT) != 0) { // NOLINT
+            // the file system took O_DIRECT on open, but does not like it for writing. go without.
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT); // NOLINT
+            continue;
+        }
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(res);
+    }
+    return true;
+#else
+    // stdio cant seek past 2GB everywhere. samples are written front to back, only the header goes back to the start.
+    if (offset == 0 && std::fseek(file, 0, SEEK_SET) != 0) {
+        return false;
+    }
+    return std::fwrite(data, 1, size, file) == size;
+#endif
+}
+
+void Recorder::buildHeader(uint64_t dataBytes) noexcept
+{
+    static constexpr uint16_t formatFloat = 3;
+    static constexpr uint16_t bitsPerSample = 32;
+    static constexpr uint32_t fmtSize = 18;
+
+    std::fill(header, header + writeAlignment, 0); // NOLINT
+    unsigned char* out = header;
+    auto channels = static_cast<uint16_t>(channelCount);
+    auto blockAlign = static_cast<uint16_t>(channelCount * sizeof(float));
+
+    // sizes saturate, so "unknown" stays as big as it gets
+    uint64_t fileBytes = std::min(dataBytes, std::numeric_limits<uint64_t>::max() - writeAlignment) + writeAlignment;
+
+    // both have the same fmt, just in different chunks, and a junk chunk that pads the header to writeAlignment
+    auto putFmt = [&]() {
+        putLe<uint16_t>(out, formatFloat);
+        putLe<uint16_t>(out, channels);
+        putLe<uint32_t>(out, sampleRate);
+        putLe<uint32_t>(out, sampleRate * blockAlign);
+        putLe<uint16_t>(out, blockAlign);
+        putLe<uint16_t>(out, bitsPerSample);
+        putLe<uint16_t>(out, 0);
+    };
+
+    if (format == RecordingFormat::Wav) {
+        static constexpr uint64_t maxSize = std::numeric_limits<uint32_t>::max();
+        static constexpr size_t chunkHeaderSize = 8;
+        putId(out, reinterpret_cast<const unsigned char*>("RIFF"), 4); // NOLINT
+        putLe<uint32_t>(out, static_cast<uint32_t>(std::min(fileBytes - chunkHeaderSize, maxSize)));
+        putId(out, reinterpret_cast<const unsigned char*>("WAVE"), 4); // NOLINT
+        putId(out, reinterpret_cast<const unsigned char*>("fmt "), 4); // NOLINT
+        putLe<uint32_t>(out, fmtSize);
+        putFmt();
+        putId(out, reinterpret_cast<const unsigned char*>("JUNK"), 4); // NOLINT
+        auto junkEnd = header + writeAlignment - chunkHeaderSize; // NOLINT
+        putLe<uint32_t>(out, static_cast<uint32_t>(junkEnd - out - 4));
+        out = junkEnd;
+        putId(out, reinterpret_cast<const unsigned char*>("data"), 4); // NOLINT
+        putLe<uint32_t>(out, static_cast<uint32_t>(std::min(dataBytes, maxSize)));
+        return;
+    }
+
+    // wave64: guids instead of ids, 64 bit sizes that include the chunk header, everything 8 byte aligned
+    static constexpr uint64_t chunkHeaderSize = wave64::chunkHeaderSize;
+    putId(out, wave64::riffGuid.data(), wave64::riffGuid.size());
+    putLe<uint64_t>(out, fileBytes);
+    putId(out, wave64::waveGuid.data(), wave64::waveGuid.size());
+    putId(out, wave64::fmtGuid.data(), wave64::fmtGuid.size());
+    putLe<uint64_t>(out, chunkHeaderSize + fmtSize);
+    putFmt();
+    out = header + wave64::align(static_cast<size_t>(out - header)); // NOLINT
+    putId(out, wave64::junkGuid.data(), wave64::junkGuid.size());
+    auto junkEnd = header + writeAlignment - chunkHeaderSize; // NOLINT
+    putLe<uint64_t>(out, static_cast<uint64_t>(junkEnd - out) + wave64::guidSize);
+    out = junkEnd;
+    putId(out, wave64::dataGuid.data(), wave64::dataGuid.size());
+    putLe<uint64_t>(out, std::min(dataBytes, std::numeric_limits<uint64_t>::max() - chunkHeaderSize) + chunkHeaderSize);
+}
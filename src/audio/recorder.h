@@ -0,0 +1,214 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_recorder_h
+#define laa_recorder_h
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Container a recording is written in
+ */
+enum class RecordingFormat {
+    /// RIFF WAV. Sizes in the header are capped at 4GB, longer files are still readable by trusting the file size.
+    Wav,
+    /// Sony Wave64. Like WAV, but with 64 bit sizes.
+    W64,
+    /// Just the samples.
+    Raw
+};
+
+/**
+ * \brief Convert the RecordingFormat enum to a string
+ * \param format RecordingFormat to stringify
+ * \return format as a string
+ */
+std::string getStr(const RecordingFormat& format) noexcept;
+
+/**
+ * \brief File extension for a RecordingFormat
+ * \param format the format
+ * \return extension, including the dot
+ */
+std::string getExtension(const RecordingFormat& format) noexcept;
+
+/**
+ * \brief Streams audio to disk
+ *
+ * The audio callback hands blocks to push(), which only converts them into a lock free ring.
+ * A writer thread takes them out in large, aligned chunks and writes them to disk.
+ * On linux the file is opened with O_DIRECT and grown with fallocate(), so the page cache does not fill up during long sessions.
+ * If the disk cannot keep up, the ring runs full and push() throws blocks away. It never waits. getBytesLost() tells how much.
+ *
+ * Samples are stored as interleaved float32.
+ */
+class Recorder {
+public:
+    /// ctor
+    Recorder() noexcept = default;
+    /// dtor. stops the recording
+    ~Recorder() noexcept;
+    /// deleted
+    Recorder(const Recorder&) = delete;
+    /// deleted
+    Recorder(Recorder&&) = delete;
+    /// deleted
+    Recorder& operator=(const Recorder&) = delete;
+    /// deleted
+    Recorder& operator=(Recorder&&) = delete;
+
+    /// Default size of the ring between push() and the writer
+    static constexpr size_t defaultRingBytes = 64 * 1024 * 1024;
+
+    /**
+     * \brief Open a file and start the writer
+     * \param path file to write. Overwritten if it exists.
+     * \param format container
+     * \param channelCount number of channels push() gets
+     * \param sampleRate sample rate for the header
+     * \param ringBytes size of the ring. Rounded up to whole write chunks.
+     * \return true on success. On failure, see getError().
+     */
+    bool start(const std::string& path, RecordingFormat format, size_t channelCount, unsigned int sampleRate, size_t ringBytes = defaultRingBytes) noexcept;
+
+    /**
+     * \brief Write out what is left, finish the header and close the file
+     */
+    void stop() noexcept;
+
+    /**
+     * \brief Check if a recording is running
+     * \return true if push() takes data
+     */
+    [[nodiscard]] bool isRecording() const noexcept;
+
+    /**
+     * \brief Hand a block of samples to the recorder. Realtime safe: never blocks, never allocates.
+     * \param channels one pointer per channel, channelCount of them
+     * \param frames samples per channel
+     */
+    void push(const double* const* channels, size_t frames) noexcept;
+
+    /**
+     * \brief Sample bytes written to disk so far
+     * \return byte count
+     */
+    [[nodiscard]] uint64_t getBytesWritten() const noexcept;
+
+    /**
+     * \brief Sample bytes thrown away because the ring was full
+     * \return byte count
+     */
+    [[nodiscard]] uint64_t getBytesLost() const noexcept;
+
+    /**
+     * \brief Path of the current or last recording
+     * \return the path
+     */
+    [[nodiscard]] const std::string& getPath() const noexcept;
+
+    /**
+     * \brief What went wrong
+     * \return error message. Empty if nothing did.
+     */
+    [[nodiscard]] std::string getError() const noexcept;
+
+private:
+    /// writer thread main
+    void writer() noexcept;
+    /**
+     * \brief Write to the file
+     * \param offset where in the file
+     * \param data what to write. Aligned to writeAlignment.
+     * \param size bytes to write. Multiple of writeAlignment.
+     * \return true on success
+     */
+    bool writeAt(uint64_t offset, const unsigned char* data, size_t size) noexcept;
+    /**
+     * \brief Build the header
+     * \param dataBytes size of the samples
+     */
+    void buildHeader(uint64_t dataBytes) noexcept;
+
+    /// O_DIRECT wants everything aligned to the block size of the device, this covers all of them
+    static constexpr size_t writeAlignment = 4096;
+    /// the writer writes this much at once
+    static constexpr size_t writeChunk = 1024 * 1024;
+    /// the file grows this much at once
+    static constexpr uint64_t preallocateStep = 256 * 1024 * 1024;
+
+    /// container
+    RecordingFormat format = RecordingFormat::Wav;
+    /// channels per frame
+    size_t channelCount = 0;
+    /// sample rate
+    unsigned int sampleRate = 0;
+    /// file path
+    std::string path = {};
+
+#ifdef __linux__
+    /// the file
+    int fd = -1;
+    /// bytes of the file that are preallocated
+    uint64_t preallocated = 0;
+#else
+    /// the file
+    std::FILE* file = nullptr;
+#endif
+    /// header size. samples start here, aligned so O_DIRECT works for them.
+    size_t dataOffset = 0;
+
+    /// backing memory of ring and header. over allocated, so both can be aligned.
+    std::vector<unsigned char> memory = {};
+    /// the header, writeAlignment bytes
+    unsigned char* header = nullptr;
+    /// the ring
+    unsigned char* ring = nullptr;
+    /// size of the ring
+    size_t ringSize = 0;
+    /// absolute write position in the ring. only push() changes it.
+    std::atomic<uint64_t> writePos = 0;
+    /// absolute read position in the ring. only the writer changes it.
+    std::atomic<uint64_t> readPos = 0;
+
+    /// true while push() takes data
+    std::atomic<bool> accepting = false;
+    /// true while push() runs, so stop() knows when the callback is out
+    std::atomic<bool> pushing = false;
+    /// tells the writer to drain and quit
+    std::atomic<bool> stopping = false;
+    /// true if the writer failed. it stops writing, push() keeps counting lost bytes.
+    std::atomic<bool> failed = false;
+    /// written by the writer thread
+    std::string writeError = {};
+    /// the writer
+    std::thread writerThread = {};
+
+    /// bytes written
+    std::atomic<uint64_t> bytesWritten = 0;
+    /// bytes lost
+    std::atomic<uint64_t> bytesLost = 0;
+    /// error on start
+    std::string error = {};
+};
+
+#endif //laa_recorder_h
@@ -0,0 +1,326 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sampleformat.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+// full scale of the integer formats. int24 is loaded into the upper bits of an int32, so it shares the int32 scale
+constexpr double int16Scale = 32768.0;
+constexpr double int32Scale = 2147483648.0;
+
+inline double loadFloat32(const unsigned char* p) noexcept
+{
+    float f = 0.0F;
+    std::memcpy(&f, p, sizeof(f));
+    return static_cast<double>(f);
+}
+
+inline double loadInt32(const unsigned char* p) noexcept
+{
+    int32_t i = 0;
+    std::memcpy(&i, p, sizeof(i));
+    return static_cast<double>(i) / int32Scale;
+}
+
+inline double loadInt24(const unsigned char* p) noexcept
+{
+    // packed little endian. shift it to the top of an int32 so the sign comes along for free
+    uint32_t u = static_cast<uint32_t>(p[0]) << 8U | static_cast<uint32_t>(p[1]) << 16U | static_cast<uint32_t>(p[2]) << 24U; // NOLINT
+    return static_cast<double>(static_cast<int32_t>(u)) / int32Scale;
+}
+
+inline double loadInt16(const unsigned char* p) noexcept
+{
+    int16_t i = 0;
+    std::memcpy(&i, p, sizeof(i));
+    return static_cast<double>(i) / int16Scale;
+}
+
+inline void storeFloat32(unsigned char* p, double d) noexcept
+{
+    auto f = static_cast<float>(d);
+    std::memcpy(p, &f, sizeof(f));
+}
+
+inline void storeInt32(unsigned char* p, double d) noexcept
+{
+    // int32Scale itself does not fit, so clip just below it
+    auto i = static_cast<int32_t>(std::clamp(d * int32Scale, -int32Scale, int32Scale - 1.0));
+    std::memcpy(p, &i, sizeof(i));
+}
+
+inline void storeInt24(unsigned char* p, double d) noexcept
+{
+    auto i = static_cast<int32_t>(std::clamp(d * int32Scale, -int32Scale, int32Scale - 1.0));
+    auto u = static_cast<uint32_t>(i);
+    p[0] = static_cast<unsigned char>(u >> 8U); // NOLINT
+    p[1] = static_cast<unsigned char>(u >> 16U); // NOLINT
+    p[2] = static_cast<unsigned char>(u >> 24U); // NOLINT
+}
+
+inline void storeInt16(unsigned char* p, double d) noexcept
+{
+    auto i = static_cast<int16_t>(std::clamp(d * int16Scale, -int16Scale, int16Scale - 1.0));
+    std::memcpy(p, &i, sizeof(i));
+}
+
+using LoadFunc = double (*)(const unsigned char*);
+using StoreFunc = void (*)(unsigned char*, double);
+
+// generic path: any channel count, one strided walk per channel
+template <LoadFunc load>
+void deinterleaveScalar(double* const* dst, const unsigned char* src, size_t sampleSize, size_t channelCount, size_t frames, size_t firstFrame) noexcept
+{
+    const size_t stride = sampleSize * channelCount;
+    for (size_t channel = 0; channel < channelCount; ++channel) {
+        double* out = dst[channel]; // NOLINT
+        if (out == nullptr) {
+            continue;
+        }
+        const unsigned char* in = src + channel * sampleSize; // NOLINT
+        for (size_t i = firstFrame; i < frames; ++i) {
+            out[i] = load(in + i * stride); // NOLINT
+        }
+    }
+}
+
+template <StoreFunc store>
+void interleaveScalar(unsigned char* dst, const double* src, size_t sampleSize, size_t channelCount, size_t frames) noexcept
+{
+    const size_t stride = sampleSize * channelCount;
+    for (size_t i = 0; i < frames; ++i) {
+        for (size_t channel = 0; channel < channelCount; ++channel) {
+            store(dst + i * stride + channel * sampleSize, src[i]); // NOLINT
+        }
+    }
+}
+
+#if defined(__SSE2__)
+// SIMD paths for the common cases (mono and stereo).
+// all of them return the number of frames they handled, the scalar path picks up the tail.
+
+size_t deinterleaveFloat32Sse(double* const* dst, const float* src, size_t channelCount, size_t frames) noexcept
+{
+    size_t i = 0;
+    if (channelCount == 1 && dst[0] != nullptr) { // NOLINT
+        double* out = dst[0]; // NOLINT
+        for (; i + 4 <= frames; i += 4) {
+            __m128 f = _mm_loadu_ps(src + i); // NOLINT
+            _mm_storeu_pd(out + i, _mm_cvtps_pd(f)); // NOLINT
+            _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(f, f))); // NOLINT
+        }
+    } else if (channelCount == 2) {
+        double* left = dst[0]; // NOLINT
+        double* right = dst[1]; // NOLINT
+        for (; i + 2 <= frames; i += 2) {
+            // l0 r0 l1 r1 -> (l0 r0) (l1 r1) -> (l0 l1) (r0 r1)
+            __m128 f = _mm_loadu_ps(src + 2 * i); // NOLINT
+            __m128d first = _mm_cvtps_pd(f);
+            __m128d second = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+            if (left != nullptr) {
+                _mm_storeu_pd(left + i, _mm_unpacklo_pd(first, second)); // NOLINT
+            }
+            if (right != nullptr) {
+                _mm_storeu_pd(right + i, _mm_unpackhi_pd(first, second)); // NOLINT
+            }
+        }
+    }
+
+    return i;
+}
+
+size_t deinterleaveInt32Sse(double* const* dst, const int32_t* src, size_t channelCount, size_t frames) noexcept
+{
+    const __m128d scale = _mm_set1_pd(1.0 / int32Scale);
+    size_t i = 0;
+    if (channelCount == 1 && dst[0] != nullptr) { // NOLINT
+        double* out = dst[0]; // NOLINT
+        for (; i + 4 <= frames; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)); // NOLINT
+            _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(v), scale)); // NOLINT
+            _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v)), scale)); // NOLINT
+        }
+    } else if (channelCount == 2) {
+        double* left = dst[0]; // NOLINT
+        double* right = dst[1]; // NOLINT
+        for (; i + 2 <= frames; i += 2) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i)); // NOLINT
+            __m128d first = _mm_mul_pd(_mm_cvtepi32_pd(v), scale);
+            __m128d second = _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v)), scale);
+            if (left != nullptr) {
+                _mm_storeu_pd(left + i, _mm_unpacklo_pd(first, second)); // NOLINT
+            }
+            if (right != nullptr) {
+                _mm_storeu_pd(right + i, _mm_unpackhi_pd(first, second)); // NOLINT
+            }
+        }
+    }
+
+    return i;
+}
+
+size_t deinterleaveInt16Sse(double* const* dst, const int16_t* src, size_t channelCount, size_t frames) noexcept
+{
+    const __m128d scale = _mm_set1_pd(1.0 / int16Scale);
+    size_t i = 0;
+    if (channelCount == 1 && dst[0] != nullptr) { // NOLINT
+        double* out = dst[0]; // NOLINT
+        for (; i + 4 <= frames; i += 4) {
+            // 4 int16 into the upper halves of 4 int32, then shift the sign back down
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)); // NOLINT
+            v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(v), scale)); // NOLINT
+            _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v)), scale)); // NOLINT
+        }
+    } else if (channelCount == 2) {
+        double* left = dst[0]; // NOLINT
+        double* right = dst[1]; // NOLINT
+        for (; i + 2 <= frames; i += 2) {
+            __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 2 * i)); // NOLINT
+            v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128d first = _mm_mul_pd(_mm_cvtepi32_pd(v), scale);
+            __m128d second = _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v)), scale);
+            if (left != nullptr) {
+                _mm_storeu_pd(left + i, _mm_unpacklo_pd(first, second)); // NOLINT
+            }
+            if (right != nullptr) {
+                _mm_storeu_pd(right + i, _mm_unpackhi_pd(first, second)); // NOLINT
+            }
+        }
+    }
+
+    return i;
+}
+#endif
+}
+
+std::string getStr(const SampleFormat& format) noexcept
+{
+    switch (format) {
+    case SampleFormat::Float32:
+        return "Float 32";
+    case SampleFormat::Int32:
+        return "Int 32";
+    case SampleFormat::Int24:
+        return "Int 24";
+    case SampleFormat::Int16:
+        return "Int 16";
+    }
+
+    return "";
+}
+
+RtAudioFormat toRtAudioFormat(SampleFormat format) noexcept
+{
+    switch (format) {
+    case SampleFormat::Float32:
+        return RTAUDIO_FLOAT32;
+    case SampleFormat::Int32:
+        return RTAUDIO_SINT32;
+    case SampleFormat::Int24:
+        return RTAUDIO_SINT24;
+    case SampleFormat::Int16:
+        return RTAUDIO_SINT16;
+    }
+
+    return RTAUDIO_FLOAT32;
+}
+
+size_t getSampleSize(SampleFormat format) noexcept
+{
+    switch (format) {
+    case SampleFormat::Float32:
+    case SampleFormat::Int32:
+        return 4;
+    case SampleFormat::Int24:
+        return 3;
+    case SampleFormat::Int16:
+        return 2;
+    }
+
+    return 4;
+}
+
+SampleFormat pickNativeFormat(RtAudioFormat nativeFormats) noexcept
+{
+    // ordered by preference. float first, as that is what we had before and it has the most headroom
+    for (auto format : { SampleFormat::Float32, SampleFormat::Int32, SampleFormat::Int24, SampleFormat::Int16 }) {
+        if ((nativeFormats & toRtAudioFormat(format)) != 0) {
+            return format;
+        }
+    }
+
+    // nothing we know. let the driver convert to float
+    return SampleFormat::Float32;
+}
+
+void deinterleave(double* const* dst, const void* src, SampleFormat format, size_t channelCount, size_t frames) noexcept
+{
+    const auto* bytes = static_cast<const unsigned char*>(src);
+    size_t done = 0;
+    switch (format) {
+    case SampleFormat::Float32:
+#if defined(__SSE2__)
+        done = deinterleaveFloat32Sse(dst, static_cast<const float*>(src), channelCount, frames);
+#endif
+        deinterleaveScalar<loadFloat32>(dst, bytes, 4, channelCount, frames, done);
+        break;
+    case SampleFormat::Int32:
+#if defined(__SSE2__)
+        done = deinterleaveInt32Sse(dst, static_cast<const int32_t*>(src), channelCount, frames);
+#endif
+        deinterleaveScalar<loadInt32>(dst, bytes, 4, channelCount, frames, done);
+        break;
+    case SampleFormat::Int24:
+        // packed 3 byte samples do not load nicely, so this stays scalar
+        deinterleaveScalar<loadInt24>(dst, bytes, 3, channelCount, frames, done);
+        break;
+    case SampleFormat::Int16:
+#if defined(__SSE2__)
+        done = deinterleaveInt16Sse(dst, static_cast<const int16_t*>(src), channelCount, frames);
+#endif
+        deinterleaveScalar<loadInt16>(dst, bytes, 2, channelCount, frames, done);
+        break;
+    }
+}
+
+void interleaveMono(void* dst, const double* src, SampleFormat format, size_t channelCount, size_t frames) noexcept
+{
+    auto* bytes = static_cast<unsigned char*>(dst);
+    switch (format) {
+    case SampleFormat::Float32:
+        interleaveScalar<storeFloat32>(bytes, src, 4, channelCount, frames);
+        break;
+    case SampleFormat::Int32:
+        interleaveScalar<storeInt32>(bytes, src, 4, channelCount, frames);
+        break;
+    case SampleFormat::Int24:
+        interleaveScalar<storeInt24>(bytes, src, 3, channelCount, frames);
+        break;
+    case SampleFormat::Int16:
+        interleaveScalar<storeInt16>(bytes, src, 2, channelCount, frames);
+        break;
+    }
+}
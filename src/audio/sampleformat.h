@@ -0,0 +1,89 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_sampleformat_h
+#define laa_sampleformat_h
+
+#include <rtaudio/RtAudio.h>
+
+#include <cstddef>
+#include <string>
+
+/**
+ * \brief Sample formats we can take from (and give to) the driver without it converting anything
+ */
+enum class SampleFormat {
+    Float32,
+    Int32,
+    Int24,
+    Int16
+};
+
+/**
+ * \brief Convert the SampleFormat enum to a string
+ * \param format SampleFormat to stringify
+ * \return format as a string
+ */
+std::string getStr(const SampleFormat& format) noexcept;
+
+/**
+ * \brief Return the RtAudioFormat flag for a SampleFormat
+ * \param format the format
+ * \return the matching RTAUDIO_* flag
+ */
+RtAudioFormat toRtAudioFormat(SampleFormat format) noexcept;
+
+/**
+ * \brief Size of one sample in bytes
+ * \param format the format
+ * \return bytes per sample. Int24 is packed, so this is 3.
+ */
+size_t getSampleSize(SampleFormat format) noexcept;
+
+/**
+ * \brief Pick the best format out of a set of native formats
+ * \param nativeFormats RtAudioFormat bitmask, as found in RtAudio::DeviceInfo::nativeFormats
+ * \return The format with the most resolution the device supports natively. Float32 if there is none.
+ */
+SampleFormat pickNativeFormat(RtAudioFormat nativeFormats) noexcept;
+
+/**
+ * \brief Deinterleave a block of samples and convert them to double
+ * \param dst one pointer per channel. Channels with a nullptr are skipped.
+ * \param src the interleaved samples, as delivered by the driver
+ * \param format format of src
+ * \param channelCount number of interleaved channels in src (and pointers in dst)
+ * \param frames number of frames (samples per channel) to convert
+ *
+ * Integer formats are scaled to -1..1.
+ * Mono and stereo blocks take a SIMD path where available.
+ */
+void deinterleave(double* const* dst, const void* src, SampleFormat format, size_t channelCount, size_t frames) noexcept;
+
+/**
+ * \brief Convert a mono block to the device format and write it to every interleaved channel
+ * \param dst the interleaved output buffer, as handed out by the driver
+ * \param src the samples to write
+ * \param format format of dst
+ * \param channelCount number of interleaved channels in dst
+ * \param frames number of frames to write
+ *
+ * Values outside of -1..1 are clipped for the integer formats.
+ */
+void interleaveMono(void* dst, const double* src, SampleFormat format, size_t channelCount, size_t frames) noexcept;
+
+#endif //laa_sampleformat_h
@@ -0,0 +1,59 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_wave64_h
+#define laa_wave64_h
+
+#include <array>
+#include <cstddef>
+
+/**
+ * \brief Bits and pieces of the Sony Wave64 format, shared between reading and writing
+ *
+ * Wave64 is RIFF WAV with 128 bit GUIDs instead of 4 byte ids, and 64 bit chunk sizes that include the chunk header.
+ */
+namespace wave64 {
+/// size of a guid
+static constexpr size_t guidSize = 16;
+/// size of a chunk header: guid and 64 bit size
+static constexpr size_t chunkHeaderSize = 24;
+/// a chunk guid
+using Guid = std::array<unsigned char, guidSize>;
+
+/// the file guid
+static constexpr Guid riffGuid = { 'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00 };
+/// the form type guid
+static constexpr Guid waveGuid = { 'w', 'a', 'v', 'e', 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+/// the format chunk guid
+static constexpr Guid fmtGuid = { 'f', 'm', 't', ' ', 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+/// the data chunk guid
+static constexpr Guid dataGuid = { 'd', 'a', 't', 'a', 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+/// the padding chunk guid
+static constexpr Guid junkGuid = { 'j', 'u', 'n', 'k', 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A };
+
+/**
+ * \brief Chunks start on 8 byte boundaries
+ * \param pos a position
+ * \return pos rounded up to the next boundary
+ */
+constexpr size_t align(size_t pos) noexcept
+{
+    return (pos + 7) / 8 * 8;
+}
+}
+
+#endif //laa_wave64_h
@@ -0,0 +1,516 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// laacli: the analysis without a window. for servers, monitoring rigs and benchmarks.
+
+#include "../audio/audiohandler.h"
+#include "../audio/batchanalyzer.h"
+#include "../prefpath.h"
+#include "resultwriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+/// set by SIGINT/SIGTERM
+static volatile std::sig_atomic_t stopRequested = 0;
+
+/**
+ * \brief Calls onStop once SIGINT or SIGTERM came in, for as long as it lives
+ *
+ * The handlers can only set stopRequested, and the analyzers only look at their own flag, so this polls in between.
+ */
+class StopWatcher {
+public:
+    /**
+     * \brief ctor. starts watching
+     * \param onStop what to do on a stop request. called from the watching thread.
+     */
+    explicit StopWatcher(std::function<void()> onStop) noexcept
+        : watcher([this, onStop = std::move(onStop)]() {
+            while (!done) {
+                if (stopRequested != 0) {
+                    onStop();
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        })
+    {
+    }
+    /// dtor. stops watching
+    ~StopWatcher() noexcept
+    {
+        done = true;
+        watcher.join();
+    }
+    /// deleted
+    StopWatcher(const StopWatcher&) = delete;
+    /// deleted
+    StopWatcher(StopWatcher&&) = delete;
+    /// deleted
+    StopWatcher& operator=(const StopWatcher&) = delete;
+    /// deleted
+    StopWatcher& operator=(StopWatcher&&) = delete;
+
+private:
+    /// set when the watcher should quit
+    std::atomic<bool> done = false;
+    /// polls stopRequested
+    std::thread watcher;
+};
+
+/**
+ * \brief Everything that can be set on the command line
+ */
+struct CliOptions {
+    /// capture, file, batch or devices
+    std::string mode = {};
+    /// file to analyze
+    std::string inputPath = {};
+    /// files and directories to analyze in batch mode
+    std::vector<std::string> inputPaths = {};
+    /// threads for batch mode. 0 for all cores.
+    size_t threads = 0;
+    /// where the results go
+    std::string outputPath = "-";
+    /// result file format
+    ResultFormat format = ResultFormat::Csv;
+    /// write smoothed results
+    bool smoothed = false;
+    /// write every frame of a file, not only the final average
+    bool allFrames = false;
+    /// capture and playback device. -1 for the default ones.
+    int device = -1;
+    /// playback device, if it differs from device
+    int playbackDevice = -1;
+    /// capture this long. 0 until stopped.
+    double seconds = 0.0;
+    /// seconds between two results while capturing
+    double interval = 1.0;
+    /// use the simulated device
+    bool simulated = false;
+    /// what to play
+    FunctionGeneratorType generator = FunctionGeneratorType::PinkNoise;
+    /// config for capture and file analysis
+    AudioConfig config = {};
+    /// window and averaging
+    StateFilterConfig filterConfig = {};
+    /// format of raw files
+    SampleFormat rawFormat = SampleFormat::Float32;
+    /// channels of raw files
+    size_t rawChannels = 2;
+};
+
+static void printUsage()
+{
+    std::cerr << "laacli " << getVersionString() << "\n"
+              << "usage: laacli devices\n"
+              << "       laacli capture [options]\n"
+              << "       laacli file <path> [options]\n"
+              << "       laacli batch <files or directories...> [options]\n"
+              << "options:\n"
+              << "  --out <path>            results, '-' for stdout (default)\n"
+              << "  --format csv|bin        result format (default csv)\n"
+              << "  --smoothed              write smoothed results\n"
+              << "  --all-frames            file: write every frame, not only the final average\n"
+              << "  --threads <n>           batch: files analyzed at once (default: all cores)\n"
+              << "  --length <samples>      analysis length (default " << AudioConfig::defaultAnalysisSamples << ")\n"
+              << "  --overlap <0..0.875>    overlap of analysis frames\n"
+              << "  --window none|hamming|blackman\n"
+              << "  --avg <n>               fft averaging\n"
+              << "  --inputs <n>            measurement channels\n"
+              << "  --swap                  reference is the last instead of the first channel\n"
+              << "  --rate <hz>             sample rate; also of raw files\n"
+              << "  --raw-format f32|s32|s24|s16, --raw-channels <n>\n"
+              << "  capture only:\n"
+              << "  --device <id>, --playback-device <id>\n"
+              << "  --internal-reference    use the playback signal as reference\n"
+              << "  --signal silence|white|pink|sine|sweep\n"
+              << "  --volume <0..1>\n"
+              << "  --seconds <s>           stop after this long (default: on ctrl+c)\n"
+              << "  --interval <s>          seconds between results (default 1)\n"
+              << "  --simulated             run against the simulated device\n";
+}
+
+static bool parseOptions(int argc, char** argv, CliOptions& options)
+{
+    // NOLINTNEXTLINE argv is what it is
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.empty()) {
+        return false;
+    }
+
+    options.mode = args[0];
+    size_t i = 1;
+    if (options.mode == "file") {
+        if (args.size() < 2) {
+            return false;
+        }
+        options.inputPath = args[1];
+        i = 2;
+    } else if (options.mode == "batch") {
+        for (; i < args.size() && args[i].rfind("--", 0) != 0; ++i) {
+            options.inputPaths.push_back(args[i]);
+        }
+        if (options.inputPaths.empty()) {
+            return false;
+        }
+    } else if (options.mode != "capture" && options.mode != "devices") {
+        return false;
+    }
+
+    for (; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        // flags first, everything else has a value
+        if (arg == "--smoothed") {
+            options.smoothed = true;
+            continue;
+        }
+        if (arg == "--all-frames") {
+            options.allFrames = true;
+            continue;
+        }
+        if (arg == "--swap") {
+            options.config.inputAndReferenceAreSwapped = true;
+            continue;
+        }
+        if (arg == "--internal-reference") {
+            options.config.internalReference = true;
+            continue;
+        }
+        if (arg == "--simulated") {
+            options.simulated = true;
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            std::cerr << "missing value for " << arg << "\n";
+            return false;
+        }
+
+        const std::string& value = args[++i];
+        try {
+            if (arg == "--out") {
+                options.outputPath = value;
+            } else if (arg == "--format") {
+                if (value != "csv" && value != "bin") {
+                    return false;
+                }
+                options.format = value == "csv" ? ResultFormat::Csv : ResultFormat::Binary;
+            } else if (arg == "--length") {
+                options.config.analysisSamples = std::stoul(value);
+            } else if (arg == "--overlap") {
+                options.config.overlap = std::clamp(std::stod(value), 0.0, 0.875);
+            } else if (arg == "--window") {
+                bool found = false;
+                for (auto window : { StateWindowFilter::None, StateWindowFilter::Hamming, StateWindowFilter::Blackman }) {
+                    std::string name = getStr(window);
+                    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
+                        return static_cast<char>(std::tolower(c));
+                    });
+                    if (name == value) {
+                        options.filterConfig.windowFilter = window;
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    return false;
+                }
+            } else if (arg == "--avg") {
+                options.filterConfig.avgCount = std::min(static_cast<size_t>(std::stoul(value)), LAA_MAX_FFT_AVG);
+            } else if (arg == "--inputs") {
+                options.config.inputChannelCount = std::clamp(static_cast<unsigned int>(std::stoul(value)), 1U, AudioConfig::maxInputChannels);
+            } else if (arg == "--rate") {
+                options.config.sampleRate = static_cast<unsigned int>(std::stoul(value));
+            } else if (arg == "--raw-format") {
+                const std::vector<std::pair<std::string, SampleFormat>> formats = { { "f32", SampleFormat::Float32 }, { "s32", SampleFormat::Int32 }, { "s24", SampleFormat::Int24 }, { "s16", SampleFormat::Int16 } };
+                auto found = std::find_if(formats.begin(), formats.end(), [&value](const auto& format) {
+                    return format.first == value;
+                });
+                if (found == formats.end()) {
+                    return false;
+                }
+                options.rawFormat = found->second;
+            } else if (arg == "--raw-channels") {
+                options.rawChannels = std::stoul(value);
+            } else if (arg == "--threads") {
+                options.threads = std::stoul(value);
+            } else if (arg == "--device") {
+                options.device = std::stoi(value);
+            } else if (arg == "--playback-device") {
+                options.playbackDevice = std::stoi(value);
+            } else if (arg == "--signal") {
+                const std::vector<std::pair<std::string, FunctionGeneratorType>> signals = { { "silence", FunctionGeneratorType::Silence }, { "white", FunctionGeneratorType::WhiteNoise }, { "pink", FunctionGeneratorType::PinkNoise }, { "sine", FunctionGeneratorType::Sine }, { "sweep", FunctionGeneratorType::Sweep } };
+                auto found = std::find_if(signals.begin(), signals.end(), [&value](const auto& signal) {
+                    return signal.first == value;
+                });
+                if (found == signals.end()) {
+                    return false;
+                }
+                options.generator = found->second;
+            } else if (arg == "--volume") {
+                options.config.outputVolume = std::clamp(std::stod(value), 0.0, 1.0);
+            } else if (arg == "--seconds") {
+                options.seconds = std::max(std::stod(value), 0.0);
+            } else if (arg == "--interval") {
+                options.interval = std::max(std::stod(value), 0.0);
+            } else {
+                std::cerr << "unknown option " << arg << "\n";
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "bad value for " << arg << ": " << value << "\n";
+            return false;
+        }
+    }
+
+    // same lengths the ui offers, the state pool only knows those
+    auto lengths = AudioConfig::getPossibleAnalysisSampleRates();
+    if (std::find(lengths.begin(), lengths.end(), options.config.analysisSamples) == lengths.end()) {
+        std::cerr << "analysis length has to be a power of two between " << LAA_MIN_FFT_LENGTH << " and " << LAA_MAX_FFT_LENGTH << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+static int listDevices()
+{
+    RtAudio rtAudio;
+    for (unsigned int i = 0; i < rtAudio.getDeviceCount(); ++i) {
+        auto device = rtAudio.getDeviceInfo(i);
+        if (!device.probed) {
+            continue;
+        }
+        std::cout << i << ": " << device.name << " (" << device.inputChannels << " in, " << device.outputChannels << " out, " << device.preferredSampleRate << "Hz)\n";
+    }
+    return 0;
+}
+
+static int analyzeFile(const CliOptions& options, ResultWriter& writer)
+{
+    FileSource source;
+    if (!source.open(options.inputPath, options.rawFormat, options.rawChannels, options.config.sampleRate)) {
+        std::cerr << source.getError() << "\n";
+        return 1;
+    }
+
+    // the states start with estimated ffts, measured ones are swapped in from the background. wisdom makes that instant.
+    static_cast<void>(setFftWisdomPath(getPrefPath() + "/" + getFftWisdomFileName()));
+
+    auto settings = OfflineAnalyzer::fromConfig(options.config, source.getChannelCount());
+    settings.filterConfig = options.filterConfig;
+    const auto sampleRate = static_cast<double>(source.getSampleRate());
+    const double hopSeconds = static_cast<double>(settings.hopSamples) / sampleRate;
+    bool writeFailed = false;
+
+    WorkerPool pool;
+    OfflineAnalyzer analyzer;
+    OfflineAnalyzer::FrameCallback onFrame = nullptr;
+    if (options.allFrames) {
+        onFrame = [&](size_t index, const OfflineAnalyzer::Frame& frame) {
+            for (size_t channel = 0; channel < frame.size() && !writeFailed; ++channel) {
+                writeFailed = !writer.write(options.inputPath, static_cast<double>(index) * hopSeconds, channel, frame[channel]->getData(), sampleRate);
+            }
+            if (writeFailed) {
+                analyzer.cancel();
+            }
+        };
+    }
+
+    bool complete = false;
+    {
+        StopWatcher watcher([&analyzer]() {
+            analyzer.cancel();
+        });
+        complete = analyzer.run(source, settings, &pool, onFrame);
+    }
+    if (!analyzer.getError().empty()) {
+        std::cerr << analyzer.getError() << "\n";
+        return 1;
+    }
+
+    if (!options.allFrames && analyzer.getFramesDone() > 0) {
+        // the averages over the whole file are stamped with its length, same as in batch mode
+        auto frame = analyzer.takeResult();
+        double time = static_cast<double>(source.getFrameCount()) / sampleRate;
+        for (size_t channel = 0; channel < frame.size() && !writeFailed; ++channel) {
+            writeFailed = !writer.write(options.inputPath, time, channel, frame[channel]->getData(), sampleRate);
+        }
+    }
+    if (writeFailed) {
+        std::cerr << writer.getError() << "\n";
+        return 1;
+    }
+
+    std::cerr << analyzer.getFramesDone() << "/" << analyzer.getFrameTotal() << " frames, " << analyzer.getSpeed() << "x real time\n";
+    return complete ? 0 : 1;
+}
+
+static int analyzeBatch(const CliOptions& options, ResultWriter& writer)
+{
+    auto files = BatchAnalyzer::collectFiles(options.inputPaths);
+    if (files.empty()) {
+        std::cerr << "no recordings found\n";
+        return 1;
+    }
+
+    static_cast<void>(setFftWisdomPath(getPrefPath() + "/" + getFftWisdomFileName()));
+
+    BatchAnalyzer::Settings settings;
+    settings.config = options.config;
+    settings.filterConfig = options.filterConfig;
+    settings.rawFormat = options.rawFormat;
+    settings.rawChannelCount = options.rawChannels;
+    settings.rawSampleRate = options.config.sampleRate;
+
+    // the caller works along, so one thread less. a single thread needs no pool at all.
+    std::unique_ptr<WorkerPool> pool = nullptr;
+    if (options.threads != 1) {
+        pool = std::make_unique<WorkerPool>(options.threads > 0 ? options.threads - 1 : 0);
+    }
+    BatchAnalyzer batch;
+    bool writeFailed = false;
+    StopWatcher watcher([&batch]() {
+        batch.cancel();
+    });
+    bool complete = batch.run(files, settings, pool.get(), [&](const std::string& path, const OfflineAnalyzer::Frame& frame, unsigned int sampleRate, double seconds) {
+        for (size_t channel = 0; channel < frame.size() && !writeFailed; ++channel) {
+            writeFailed = !writer.write(path, seconds, channel, frame[channel]->getData(), static_cast<double>(sampleRate));
+        }
+        if (writeFailed) {
+            batch.cancel();
+        }
+    });
+
+    for (const auto& error : batch.getErrors()) {
+        std::cerr << error << "\n";
+    }
+    if (writeFailed) {
+        std::cerr << writer.getError() << "\n";
+        return 1;
+    }
+    std::cerr << batch.getFilesDone() << "/" << batch.getFileTotal() << " files, " << batch.getFilesPerSecond() << " files/s, " << batch.getSpeed() << "x real time\n";
+    return complete ? 0 : 1;
+}
+
+static int capture(const CliOptions& options, ResultWriter& writer, std::chrono::steady_clock::time_point launchTime)
+{
+    using namespace std::chrono;
+
+    AudioHandler handler(launchTime);
+    AudioConfig config = options.config;
+    const auto& defaults = handler.getConfig();
+    config.captureDevice = defaults.captureDevice;
+    config.playbackDevice = defaults.playbackDevice;
+    config.captureParams = defaults.captureParams;
+    config.playbackParams = defaults.playbackParams;
+    if (options.device >= 0 || options.playbackDevice >= 0) {
+        RtAudio rtAudio;
+        auto captureId = static_cast<unsigned int>(options.device >= 0 ? options.device : options.playbackDevice);
+        auto playbackId = static_cast<unsigned int>(options.playbackDevice >= 0 ? options.playbackDevice : options.device);
+        config.captureDevice = rtAudio.getDeviceInfo(captureId);
+        config.playbackDevice = rtAudio.getDeviceInfo(playbackId);
+        config.captureParams.deviceId = captureId;
+        config.playbackParams.deviceId = playbackId;
+    }
+    // nobody scrubs back through frames here, the results are written as they come
+    config.historyMegabytes = 0;
+
+    if (!handler.start(config, options.filterConfig, options.generator, options.simulated)) {
+        std::cerr << handler.getStatus() << "\n";
+        return 1;
+    }
+    std::cerr << handler.getStatus() << ", " << config.captureDevice.name << ", ctrl+c to stop\n";
+
+    auto start = steady_clock::now();
+    auto lastWrite = start;
+    size_t lastFrame = handler.getFrameCount();
+    bool writeFailed = false;
+    while (stopRequested == 0 && !writeFailed) {
+        std::this_thread::sleep_for(10ms);
+        auto now = steady_clock::now();
+        double elapsed = duration<double>(now - start).count();
+        if (options.seconds > 0.0 && elapsed >= options.seconds) {
+            break;
+        }
+
+        size_t frame = handler.getFrameCount();
+        if (frame == lastFrame || duration<double>(now - lastWrite).count() < options.interval) {
+            continue;
+        }
+        lastFrame = frame;
+        lastWrite = now;
+        for (size_t channel = 0; channel < handler.getChannelCount() && !writeFailed; ++channel) {
+            auto data = handler.getSnapshot(channel);
+            if (data != nullptr) {
+                writeFailed = !writer.write("capture", elapsed, channel, *data, data->sampleRate);
+            }
+        }
+    }
+
+    handler.stop();
+    std::cerr << handler.getStats().toString() << "\n"
+              << handler.getProcessingStats().toString() << "\n"
+              << handler.getStartupStats().toString() << "\n";
+    if (writeFailed) {
+        std::cerr << writer.getError() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const auto launchTime = std::chrono::steady_clock::now();
+    CliOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    if (options.mode == "devices") {
+        return listDevices();
+    }
+
+    std::signal(SIGINT, [](int) {
+        stopRequested = 1;
+    });
+    std::signal(SIGTERM, [](int) {
+        stopRequested = 1;
+    });
+
+    ResultWriter writer;
+    if (!writer.open(options.outputPath, options.format, options.smoothed)) {
+        std::cerr << writer.getError() << "\n";
+        return 1;
+    }
+
+    int result = 0;
+    if (options.mode == "file") {
+        result = analyzeFile(options, writer);
+    } else if (options.mode == "batch") {
+        result = analyzeBatch(options, writer);
+    } else {
+        result = capture(options, writer, launchTime);
+    }
+    writer.close();
+    return result;
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resultwriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+std::string getStr(const ResultFormat& format) noexcept
+{
+    switch (format) {
+    case ResultFormat::Csv:
+        return "csv";
+    case ResultFormat::Binary:
+        return "bin";
+    }
+
+    return "";
+}
+
+// magnitudes of silence would be -inf, which nobody can parse
+static double toDb(double value) noexcept
+{
+    static constexpr double floor = 1e-12;
+    return 20.0 * std::log10(std::max(value, floor));
+}
+
+// append raw bytes of a value
+template <class T>
+static void append(std::string& out, const T& value) noexcept
+{
+    std::array<char, sizeof(T)> bytes = {};
+    std::memcpy(bytes.data(), &value, sizeof(T));
+    out.append(bytes.data(), bytes.size());
+}
+
+bool ResultWriter::open(const std::string& path, ResultFormat newFormat, bool newSmoothed) noexcept
+{
+    close();
+    format = newFormat;
+    smoothed = newSmoothed;
+    error.clear();
+
+    toStdout = path == "-";
+    if (toStdout && format == ResultFormat::Binary) {
+        error = "Binary results need a file";
+        return false;
+    }
+    if (!toStdout) {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            error = "Cannot open " + path;
+            return false;
+        }
+    }
+
+    if (format == ResultFormat::Csv) {
+        (toStdout ? std::cout : file) << "source,time,channel,frequency,magnitude_db,phase_deg,coherence,input_db\n";
+    }
+    return true;
+}
+
+bool ResultWriter::write(const std::string& source, double time, size_t channel, const StateData& data, double sampleRate) noexcept
+{
+    const auto& transfer = choose(smoothed, data.smoothedTransferFunction, data.transferFunction);
+    const auto& coherence = choose(smoothed, data.smoothedCoherence, data.coherence);
+    const auto& inputMag = choose(smoothed, data.smoothedAvgMag, data.avgMag);
+    const size_t bins = data.fftLen / 2;
+    const double binWidth = data.fftLen > 0 ? sampleRate / static_cast<double>(data.fftLen) : 0.0;
+
+    // build the whole state in memory first, one large write is a lot faster than many small ones
+    std::string out;
+    if (format == ResultFormat::Csv) {
+        // file names can have commas and quotes in them
+        std::string quoted = "\"";
+        for (char c : source) {
+            quoted += c == '"' ? "\"\"" : std::string(1, c);
+        }
+        quoted += "\",";
+
+        std::array<char, 160> line = {};
+        for (size_t i = 0; i < bins; ++i) {
+            out.append(quoted);
+            int length = std::snprintf(line.data(), line.size(), "%.6f,%zu,%.3f,%.4f,%.3f,%.5f,%.4f\n",
+                time, channel, static_cast<double>(i) * binWidth, toDb(mag(transfer[i])), phase(transfer[i]) * 180.0 / LAA_PI, coherence[i], toDb(inputMag[i]));
+            out.append(line.data(), static_cast<size_t>(std::max(length, 0)));
+        }
+    } else {
+        out.reserve(36 + source.size() + bins * 4 * sizeof(double));
+        out.append("LAAR");
+        append(out, binaryVersion);
+        append(out, static_cast<uint32_t>(channel));
+        append(out, static_cast<uint32_t>(bins));
+        append(out, time);
+        append(out, sampleRate);
+        append(out, static_cast<uint32_t>(source.size()));
+        out.append(source);
+        for (size_t i = 0; i < bins; ++i) {
+            append(out, toDb(mag(transfer[i])));
+            append(out, phase(transfer[i]) * 180.0 / LAA_PI);
+            append(out, coherence[i]);
+            append(out, toDb(inputMag[i]));
+        }
+    }
+
+    auto& stream = toStdout ? std::cout : file;
+    stream.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!stream) {
+        error = "Write failed";
+        return false;
+    }
+    return true;
+}
+
+void ResultWriter::close() noexcept
+{
+    if (file.is_open()) {
+        file.close();
+    }
+    std::cout.flush();
+}
+
+const std::string& ResultWriter::getError() const noexcept
+{
+    return error;
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_resultwriter_h
+#define laa_resultwriter_h
+
+#include "../state/statedata.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/**
+ * \brief File format of analysis results
+ */
+enum class ResultFormat {
+    /// one line per bin: source,time,channel,frequency,magnitude_db,phase_deg,coherence,input_db
+    Csv,
+    /// one record per state. See ResultWriter for the layout.
+    Binary
+};
+
+/**
+ * \brief Convert the ResultFormat enum to a string
+ * \param format ResultFormat to stringify
+ * \return format as a string
+ */
+std::string getStr(const ResultFormat& format) noexcept;
+
+/**
+ * \brief Writes processed states to a file, one after the other
+ *
+ * The binary format is a sequence of records, all little endian:
+ * a header of "LAAR", uint32 version, uint32 channel, uint32 bin count, float64 time, float64 sample rate,
+ * uint32 source length and the source name (not terminated),
+ * followed by bin count entries of four float64: magnitude (dB), phase (deg), coherence, input level (dB).
+ * Bin i is at i * sampleRate / (2 * bin count) Hz.
+ */
+class ResultWriter {
+public:
+    /// version of the binary records
+    static constexpr uint32_t binaryVersion = 2;
+
+    /**
+     * \brief Open a file. Truncates it.
+     * \param path where to write. "-" for stdout, csv only.
+     * \param format file format
+     * \param smoothed write the smoothed instead of the raw results
+     * \return true on success. On failure, see getError().
+     */
+    bool open(const std::string& path, ResultFormat format, bool smoothed) noexcept;
+
+    /**
+     * \brief Append a state
+     * \param source where the state comes from: a file name, or "capture"
+     * \param time seconds since the start of the capture or file
+     * \param channel measurement channel the state belongs to
+     * \param data the state
+     * \param sampleRate sample rate of the state
+     * \return true on success. On failure, see getError().
+     */
+    bool write(const std::string& source, double time, size_t channel, const StateData& data, double sampleRate) noexcept;
+
+    /**
+     * \brief Flush and close
+     */
+    void close() noexcept;
+
+    /**
+     * \brief What went wrong
+     * \return error message
+     */
+    [[nodiscard]] const std::string& getError() const noexcept;
+
+private:
+    /// the file
+    std::ofstream file = {};
+    /// true if we write to stdout instead of file
+    bool toStdout = false;
+    /// format of the file
+    ResultFormat format = ResultFormat::Csv;
+    /// write smoothed results
+    bool smoothed = false;
+    /// last error
+    std::string error = {};
+};
+
+#endif //laa_resultwriter_h
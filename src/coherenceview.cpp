@@ -20,9 +20,6 @@ void CoherenceView::update(StateManager& stateManager, std::string idHint)
 {
     ImGui::BeginChild((idHint + "Coherence").c_str());
 
-    const auto& liveState = stateManager.getLive();
-    auto& data = choose(smoothing, liveState.smoothedCoherence, liveState.coherence);
-
     auto size = ImGui::GetWindowContentRegionMax();
     PlotConfig plotConfig;
     plotConfig.size = ImVec2(size.x * 0.98F, size.y - 75.0F);
@@ -40,35 +37,32 @@ void CoherenceView::update(StateManager& stateManager, std::string idHint)
 
     BeginPlot(plotConfig);
 
-    if (liveState.visible) {
-        PlotSourceConfig sourceConfig;
-        sourceConfig.count = liveState.fftLen / 2;
-        sourceConfig.xMin = 0.0;
-        sourceConfig.xMax = liveState.sampleRate / 2.0;
-        sourceConfig.color = liveState.uniqueCol;
-        sourceConfig.active = liveState.active;
-        Plot(
-            sourceConfig,
-            [&data](size_t idx) {
-                return data[idx];
-            });
-    }
-
-    for (auto& state : stateManager.getSaved()) {
-        if (!state.visible) {
-            continue;
+    auto plotState = [this](const DisplayState& state) {
+        if (!state.visible || state.data == nullptr) {
+            return;
         }
-        auto& savedData = choose(smoothing, state.smoothedCoherence, state.coherence);
+        const auto& data = *state.data;
+        const auto& stateData = choose(smoothing, data.smoothedCoherence, data.coherence);
         PlotSourceConfig sourceConfig;
-        sourceConfig.count = state.fftLen / 2;
+        sourceConfig.count = data.fftLen / 2;
         sourceConfig.xMin = 0.0;
-        sourceConfig.xMax = state.sampleRate / 2.0;
+        sourceConfig.xMax = data.sampleRate / 2.0;
         sourceConfig.color = state.uniqueCol;
         sourceConfig.active = state.active;
         Plot(
-            sourceConfig, [&savedData](size_t idx) {
-                return savedData[idx];
+            sourceConfig, [&stateData](size_t idx) {
+                if (idx >= stateData.size()) {
+                    return 0.0;
+                }
+                return stateData[idx];
             });
+    };
+
+    for (const auto& state : stateManager.getLiveChannels()) {
+        plotState(state);
+    }
+    for (const auto& state : stateManager.getSaved()) {
+        plotState(state);
     }
 
     EndPlot();
@@ -0,0 +1,87 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "biquad.h"
+#include "../core.h"
+
+#include <cmath>
+
+void Biquad::design(BiquadType type, double sampleRate, double frequency, double q, double gainDb) noexcept
+{
+    double w0 = 2.0 * LAA_PI * frequency / sampleRate;
+    double cosW0 = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * q);
+    double a = std::pow(10.0, gainDb / 40.0);
+
+    double a0 = 1.0;
+    switch (type) {
+    case BiquadType::LowPass:
+        b0 = (1.0 - cosW0) / 2.0;
+        b1 = 1.0 - cosW0;
+        b2 = b0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosW0;
+        a2 = 1.0 - alpha;
+        break;
+    case BiquadType::HighPass:
+        b0 = (1.0 + cosW0) / 2.0;
+        b1 = -(1.0 + cosW0);
+        b2 = b0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosW0;
+        a2 = 1.0 - alpha;
+        break;
+    case BiquadType::Peak:
+        b0 = 1.0 + alpha * a;
+        b1 = -2.0 * cosW0;
+        b2 = 1.0 - alpha * a;
+        a0 = 1.0 + alpha / a;
+        a1 = -2.0 * cosW0;
+        a2 = 1.0 - alpha / a;
+        break;
+    }
+
+    // normalize, so a0 is 1
+    b0 /= a0;
+    b1 /= a0;
+    b2 /= a0;
+    a1 /= a0;
+    a2 /= a0;
+}
+
+double Biquad::process(double x) noexcept
+{
+    // transposed direct form 2
+    double y = b0 * x + z1;
+    z1 = b1 * x - a1 * y + z2;
+    z2 = b2 * x - a2 * y;
+    return y;
+}
+
+std::complex<double> Biquad::getResponse(double frequency, double sampleRate) const noexcept
+{
+    // H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2), at z = e^jw
+    std::complex<double> z1Inv = std::polar(1.0, -2.0 * LAA_PI * frequency / sampleRate);
+    std::complex<double> z2Inv = z1Inv * z1Inv;
+    return (b0 + b1 * z1Inv + b2 * z2Inv) / (1.0 + a1 * z1Inv + a2 * z2Inv);
+}
+
+void Biquad::reset() noexcept
+{
+    z1 = 0.0;
+    z2 = 0.0;
+}
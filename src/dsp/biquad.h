@@ -0,0 +1,77 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_biquad_h
+#define laa_biquad_h
+
+#include <complex>
+
+/**
+ * \brief Shapes a Biquad can take
+ */
+enum class BiquadType {
+    LowPass,
+    HighPass,
+    Peak
+};
+
+/**
+ * \brief Second order iir filter, coefficients after the RBJ audio eq cookbook
+ */
+class Biquad {
+public:
+    /**
+     * \brief Calculate the coefficients. Keeps the filter state.
+     * \param type filter shape
+     * \param sampleRate sample rate
+     * \param frequency corner or center frequency
+     * \param q quality
+     * \param gainDb gain at frequency. Only used by Peak.
+     */
+    void design(BiquadType type, double sampleRate, double frequency, double q, double gainDb) noexcept;
+
+    /**
+     * \brief Filter one sample
+     * \param x input sample
+     * \return output sample
+     */
+    double process(double x) noexcept;
+
+    /**
+     * \brief The frequency response
+     * \param frequency where to evaluate it
+     * \param sampleRate sample rate
+     * \return complex response
+     */
+    [[nodiscard]] std::complex<double> getResponse(double frequency, double sampleRate) const noexcept;
+
+    /**
+     * \brief Clear the filter state
+     */
+    void reset() noexcept;
+
+private:
+    double b0 = 1.0;
+    double b1 = 0.0;
+    double b2 = 0.0;
+    double a1 = 0.0;
+    double a2 = 0.0;
+    double z1 = 0.0;
+    double z2 = 0.0;
+};
+
+#endif //laa_biquad_h
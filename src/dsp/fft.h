@@ -21,6 +21,7 @@
 // clang-format off
 #include <cstdlib>
 #include <complex>
+#include <vector>
 #include <fftw3.h>
 // clang-format on
 
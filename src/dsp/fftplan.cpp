@@ -0,0 +1,395 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fftplan.h"
+#include "../threadtuning.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+namespace {
+/// key of a plan in the cache
+using PlanKey = std::tuple<size_t, FftKind, unsigned int>;
+/// key of a slot
+using SlotKey = std::pair<size_t, FftKind>;
+/// key of a batch plan: length, count and flags
+using BatchKey = std::tuple<size_t, size_t, unsigned int>;
+
+/**
+ * \brief Planner flags for an effort
+ * \param effort the effort
+ * \return fftw flags
+ */
+unsigned int getEffortFlags(FftPlanEffort effort) noexcept
+{
+    return effort == FftPlanEffort::Patient ? FFTW_PATIENT : FFTW_MEASURE;
+}
+
+/**
+ * \brief Plan, without looking at the cache. Call with the planner lock held.
+ * \param length dft length
+ * \param kind direction
+ * \param flags fftw flags
+ * \return the plan. nullptr if fftw could not make one, or with FFTW_WISDOM_ONLY, did not know it yet.
+ */
+fftw_plan makePlan(size_t length, FftKind kind, unsigned int flags) noexcept
+{
+    // scratch buffers, just for planning. fftw_malloc, like the buffers the plan gets executed on later.
+    // measuring overwrites them, so they cannot be anybody's data anyway.
+    auto* real = fftw_alloc_real(length);
+    auto* complex = fftw_alloc_complex(length / 2 + 1);
+    fftw_plan plan = nullptr;
+    switch (kind) {
+    case FftKind::RealToComplex:
+        plan = fftw_plan_dft_r2c_1d(static_cast<int>(length), real, complex, flags);
+        break;
+    case FftKind::ComplexToReal:
+        plan = fftw_plan_dft_c2r_1d(static_cast<int>(length), complex, real, flags | FFTW_PRESERVE_INPUT);
+        break;
+    }
+    fftw_free(complex);
+    fftw_free(real);
+    return plan;
+}
+
+/**
+ * \brief Plan a batch, without looking at the cache. Call with the planner lock held.
+ * \param length dft length
+ * \param count number of dfts
+ * \param flags fftw flags
+ * \return the plan. nullptr if fftw could not make one, or with FFTW_WISDOM_ONLY, did not know it yet.
+ */
+fftw_plan makeBatchPlan(size_t length, size_t count, unsigned int flags) noexcept
+{
+    auto* real = fftw_alloc_real(length * count);
+    auto* complex = fftw_alloc_complex((length / 2 + 1) * count);
+    int size = static_cast<int>(length);
+    fftw_plan plan = fftw_plan_many_dft_r2c(1, &size, static_cast<int>(count), real, nullptr, 1, size, complex, nullptr, 1, size / 2 + 1, flags);
+    fftw_free(complex);
+    fftw_free(real);
+    return plan;
+}
+
+/**
+ * \brief Owns the plans and the background planner
+ *
+ * Lock order is plannerLock, then cacheLock. Only plannerLock is held for long.
+ */
+class Planner {
+public:
+    /// ctor
+    Planner() noexcept = default;
+    /// deleted
+    Planner(const Planner&) = delete;
+    /// deleted
+    Planner(Planner&&) = delete;
+    /// deleted
+    Planner& operator=(const Planner&) = delete;
+    /// deleted
+    Planner& operator=(Planner&&) = delete;
+    /// dtor. waits for the plan in progress and destroys all of them
+    ~Planner() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> guard(cacheLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        for (auto& [key, plan] : plans) {
+            fftw_destroy_plan(plan);
+        }
+        for (auto& [key, plan] : batchPlans) {
+            fftw_destroy_plan(plan);
+        }
+    }
+
+    /**
+     * \brief Get a plan from the cache, or plan it. Call with plannerLock held.
+     * \param key length, kind and flags
+     * \param wisdomOnly only plan if the wisdom knows how
+     * \return the plan, or nullptr
+     */
+    fftw_plan getPlan(const PlanKey& key, bool wisdomOnly) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> guard(cacheLock);
+            auto iter = plans.find(key);
+            if (iter != plans.end()) {
+                return iter->second;
+            }
+        }
+
+        auto [length, kind, flags] = key;
+        fftw_plan plan = makePlan(length, kind, wisdomOnly ? flags | FFTW_WISDOM_ONLY : flags);
+        if (plan != nullptr) {
+            std::lock_guard<std::mutex> guard(cacheLock);
+            plans[key] = plan;
+        }
+        return plan;
+    }
+
+    /**
+     * \brief Have the worker make a better plan for a slot. Call with cacheLock held.
+     * \param key the slot
+     */
+    void queue(const SlotKey& key) noexcept
+    {
+        if (std::find(pending.begin(), pending.end(), key) != pending.end()) {
+            return;
+        }
+        pending.push_back(key);
+        if (!worker.joinable()) {
+            worker = std::thread([this]() {
+                work();
+            });
+        }
+        wake.notify_all();
+    }
+
+    /// the fftw planner and wisdom are not thread safe, only executing is
+    std::mutex plannerLock = {};
+    /// protects everything below
+    std::mutex cacheLock = {};
+    /// every plan ever made
+    std::map<PlanKey, fftw_plan> plans = {};
+    /// every batch plan ever made
+    std::map<BatchKey, fftw_plan> batchPlans = {};
+    /// the best plan per length and kind. std::map does not move its nodes, so handing out references is fine.
+    std::map<SlotKey, std::atomic<fftw_plan>> slots = {};
+    /// slots waiting for a better plan. the front is the one being worked on.
+    std::deque<SlotKey> pending = {};
+    /// how hard the worker tries
+    FftPlanEffort effort = FftPlanEffort::Measure;
+    /// where wisdom goes. empty for nowhere.
+    std::string wisdomPath = {};
+    /// plans the worker is done with
+    size_t finished = 0;
+
+private:
+    /// the background planner
+    void work() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> guard(plannerLock);
+            fftw_set_timelimit(plannerTimeLimit);
+        }
+
+        std::unique_lock<std::mutex> cacheGuard(cacheLock);
+        while (!stopping) {
+            if (pending.empty()) {
+                wake.wait(cacheGuard);
+                continue;
+            }
+
+            SlotKey key = pending.front();
+            PlanKey planKey(key.first, key.second, getEffortFlags(effort));
+            std::string path = wisdomPath;
+            cacheGuard.unlock();
+
+            fftw_plan plan = nullptr;
+            {
+                std::lock_guard<std::mutex> guard(plannerLock);
+                plan = getPlan(planKey, false);
+                // save after every plan, so quitting early does not lose what was measured.
+                // into a temporary first, a crash while writing should not cost the old wisdom.
+                if (plan != nullptr && !path.empty() && fftw_export_wisdom_to_filename((path + ".tmp").c_str()) != 0) {
+#ifdef _WIN32
+                    std::remove(path.c_str());
+#endif
+                    std::rename((path + ".tmp").c_str(), path.c_str());
+                }
+            }
+
+            cacheGuard.lock();
+            pending.pop_front();
+            ++finished;
+            // the states pick it up on their next frame. queueFftPlan() does not make a slot, so there might be none yet.
+            if (plan != nullptr) {
+                auto [iter, inserted] = slots.try_emplace(key, plan);
+                if (!inserted) {
+                    iter->second.store(plan);
+                }
+            }
+        }
+    }
+
+    /// wakes the worker
+    std::condition_variable wake = {};
+    /// runs work()
+    std::thread worker = {};
+    /// tells the worker to quit
+    bool stopping = false;
+};
+
+Planner& getPlanner() noexcept
+{
+    static Planner planner;
+    return planner;
+}
+} // namespace
+
+std::string getStr(const FftPlanEffort& effort) noexcept
+{
+    switch (effort) {
+    case FftPlanEffort::Measure:
+        return "Measure";
+    case FftPlanEffort::Patient:
+        return "Patient";
+    }
+
+    return "";
+}
+
+fftw_plan getFftBatchPlan(size_t length, size_t count) noexcept
+{
+    auto& planner = getPlanner();
+    BatchKey key(length, count, 0);
+    {
+        std::lock_guard<std::mutex> guard(planner.cacheLock);
+        std::get<2>(key) = getEffortFlags(planner.effort);
+        auto iter = planner.batchPlans.find(key);
+        if (iter != planner.batchPlans.end()) {
+            return iter->second;
+        }
+    }
+
+    // batches are not measured in the background, there are too many ways to cut them up.
+    // the wisdom might know one, otherwise estimate. either is cached under the flags the effort asks for.
+    // the background planner holds plannerLock for long, so it is only taken when there is something to plan.
+    std::lock_guard<std::mutex> plannerGuard(planner.plannerLock);
+    {
+        // somebody else might have made it while we waited
+        std::lock_guard<std::mutex> guard(planner.cacheLock);
+        auto iter = planner.batchPlans.find(key);
+        if (iter != planner.batchPlans.end()) {
+            return iter->second;
+        }
+    }
+    fftw_plan plan = makeBatchPlan(length, count, std::get<2>(key) | FFTW_WISDOM_ONLY);
+    if (plan == nullptr) {
+        plan = makeBatchPlan(length, count, FFTW_ESTIMATE);
+    }
+    if (plan != nullptr) {
+        std::lock_guard<std::mutex> guard(planner.cacheLock);
+        planner.batchPlans[key] = plan;
+    }
+    return plan;
+}
+
+const std::atomic<fftw_plan>& getBestFftPlan(size_t length, FftKind kind) noexcept
+{
+    auto& planner = getPlanner();
+    SlotKey key(length, kind);
+    unsigned int flags = 0;
+    {
+        std::lock_guard<std::mutex> guard(planner.cacheLock);
+        auto iter = planner.slots.find(key);
+        if (iter != planner.slots.end()) {
+            return iter->second;
+        }
+        flags = getEffortFlags(planner.effort);
+    }
+
+    // the wisdom might know it already, then the good plan is quick to make.
+    // otherwise estimate for now, that is quick as well.
+    std::lock_guard<std::mutex> plannerGuard(planner.plannerLock);
+    fftw_plan plan = planner.getPlan(PlanKey(length, kind, flags), true);
+    bool estimated = plan == nullptr;
+    if (estimated) {
+        plan = planner.getPlan(PlanKey(length, kind, FFTW_ESTIMATE), false);
+    }
+
+    std::lock_guard<std::mutex> cacheGuard(planner.cacheLock);
+    auto [iter, inserted] = planner.slots.try_emplace(key, plan);
+    if (inserted && estimated) {
+        planner.queue(key);
+    }
+    return iter->second;
+}
+
+void queueFftPlan(size_t length, FftKind kind) noexcept
+{
+    auto& planner = getPlanner();
+    std::lock_guard<std::mutex> guard(planner.cacheLock);
+    if (planner.slots.count(SlotKey(length, kind)) == 0) {
+        planner.queue(SlotKey(length, kind));
+    }
+}
+
+void setFftPlanEffort(FftPlanEffort effort) noexcept
+{
+    auto& planner = getPlanner();
+    std::lock_guard<std::mutex> guard(planner.cacheLock);
+    bool better = effort == FftPlanEffort::Patient && planner.effort != FftPlanEffort::Patient;
+    planner.effort = effort;
+    if (!better) {
+        return;
+    }
+    for (const auto& [key, slot] : planner.slots) {
+        planner.queue(key);
+    }
+}
+
+FftPlanEffort getFftPlanEffort() noexcept
+{
+    auto& planner = getPlanner();
+    std::lock_guard<std::mutex> guard(planner.cacheLock);
+    return planner.effort;
+}
+
+size_t getPendingFftPlans() noexcept
+{
+    auto& planner = getPlanner();
+    std::lock_guard<std::mutex> guard(planner.cacheLock);
+    return planner.pending.size();
+}
+
+size_t getFinishedFftPlans() noexcept
+{
+    auto& planner = getPlanner();
+    std::lock_guard<std::mutex> guard(planner.cacheLock);
+    return planner.finished;
+}
+
+bool setFftWisdomPath(const std::string& path) noexcept
+{
+    auto& planner = getPlanner();
+    std::lock_guard<std::mutex> plannerGuard(planner.plannerLock);
+    bool imported = fftw_import_wisdom_from_filename(path.c_str()) != 0;
+    std::lock_guard<std::mutex> cacheGuard(planner.cacheLock);
+    planner.wisdomPath = path;
+    return imported;
+}
+
+std::string getFftWisdomFileName() noexcept
+{
+    std::string name = "fftwWisdom-";
+    for (char c : getCpuName()) {
+        name += std::isalnum(static_cast<unsigned char>(c)) != 0 ? c : '_';
+    }
+    return name + ".fftw";
+}
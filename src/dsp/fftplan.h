@@ -0,0 +1,128 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_fftplan_h
+#define laa_fftplan_h
+
+#include "fft.h"
+
+#include <atomic>
+#include <string>
+
+/**
+ * \brief Directions of the 1d dfts we plan
+ */
+enum class FftKind {
+    /// real input, fftLen/2+1 complex bins out
+    RealToComplex,
+    /// complex bins in, real output. planned with FFTW_PRESERVE_INPUT.
+    ComplexToReal
+};
+
+/**
+ * \brief How hard the background planner tries
+ */
+enum class FftPlanEffort {
+    /// FFTW_MEASURE. a few seconds for all lengths.
+    Measure,
+    /// FFTW_PATIENT. a bit faster ffts, but planning takes minutes. capped by plannerTimeLimit per plan.
+    Patient
+};
+
+/**
+ * \brief Convert the FftPlanEffort enum to a string
+ * \param effort FftPlanEffort to stringify
+ * \return effort as a string
+ */
+std::string getStr(const FftPlanEffort& effort) noexcept;
+
+/// the most time the planner spends on one plan, in seconds
+constexpr double plannerTimeLimit = 20.0;
+
+/**
+ * \brief Get a plan for many real to complex dfts of the same length in one go
+ * \param length dft length
+ * \param count number of dfts
+ * \return the plan. owned by the cache, lives until the program ends. nullptr if fftw could not make one.
+ *
+ * The inputs follow each other, length values apart, the outputs length/2+1 bins apart.
+ * Uses the measured plan if the wisdom has it, otherwise an estimated one, so this is quick. Execute it like the plans of getBestFftPlan().
+ */
+fftw_plan getFftBatchPlan(size_t length, size_t count) noexcept;
+
+/**
+ * \brief Get the best plan there is for a length, and have a better one made in the background
+ * \param length dft length
+ * \param kind direction
+ * \return slot holding the best plan so far. Never empty. Lives until the program ends.
+ *
+ * If the wisdom already knows the length, that plan is used right away.
+ * Otherwise the slot starts out with a FFTW_ESTIMATE plan, which is quick to make, and the background planner swaps in a measured one once it is done.
+ * Load the slot once per frame, the plans it held stay valid.
+ * Plans are shared by everything with the same length and kind.
+ * Execute them with fftw_execute_dft_r2c() / fftw_execute_dft_c2r() on your own buffers,
+ * which have to be allocated with fftw_malloc (or be at an fft length offset into such a block), so their alignment matches.
+ */
+const std::atomic<fftw_plan>& getBestFftPlan(size_t length, FftKind kind) noexcept;
+
+/**
+ * \brief Have the background planner make a plan for a length, without waiting for it
+ * \param length dft length
+ * \param kind direction
+ *
+ * getBestFftPlan() for that length is quick afterwards, and hands out the good plan right away.
+ */
+void queueFftPlan(size_t length, FftKind kind) noexcept;
+
+/**
+ * \brief Set how hard the background planner tries. Going up replans everything handed out so far.
+ * \param effort the effort
+ */
+void setFftPlanEffort(FftPlanEffort effort) noexcept;
+
+/**
+ * \brief How hard the background planner tries
+ * \return the effort
+ */
+FftPlanEffort getFftPlanEffort() noexcept;
+
+/**
+ * \brief Number of plans the background planner still has to do
+ * \return plan count, including the one it is working on
+ */
+size_t getPendingFftPlans() noexcept;
+
+/**
+ * \brief Number of plans the background planner is done with
+ * \return plan count. with getPendingFftPlans(), that is how far along it is.
+ */
+size_t getFinishedFftPlans() noexcept;
+
+/**
+ * \brief Load wisdom, and save it there every time the background planner finishes a plan
+ * \param path wisdom file
+ * \return true if there was wisdom to load
+ */
+bool setFftWisdomPath(const std::string& path) noexcept;
+
+/**
+ * \brief File name for the wisdom of this machine
+ * \return name, without directory. wisdom is only good for the cpu it was measured on, so the cpu model is in it.
+ */
+std::string getFftWisdomFileName() noexcept;
+
+#endif //laa_fftplan_h
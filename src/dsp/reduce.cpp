@@ -0,0 +1,174 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "reduce.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// the sums run on every frame for every trigger rule, the accumulations over every bin of every trace math member.
+// so they all get a simd path, with the scalar loop picking up the tail.
+// the sums use two accumulators, so the adds do not wait on each other.
+
+double sum(const double* values, size_t count) noexcept
+{
+    size_t i = 0;
+    double result = 0.0;
+#if defined(__SSE2__)
+    __m128d first = _mm_setzero_pd();
+    __m128d second = _mm_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        first = _mm_add_pd(first, _mm_loadu_pd(values + i)); // NOLINT
+        second = _mm_add_pd(second, _mm_loadu_pd(values + i + 2)); // NOLINT
+    }
+    __m128d total = _mm_add_pd(first, second);
+    result = _mm_cvtsd_f64(_mm_add_sd(total, _mm_unpackhi_pd(total, total)));
+#endif
+    for (; i < count; ++i) {
+        result += values[i]; // NOLINT
+    }
+
+    return result;
+}
+
+double sumSquares(const double* values, size_t count) noexcept
+{
+    size_t i = 0;
+    double result = 0.0;
+#if defined(__SSE2__)
+    __m128d first = _mm_setzero_pd();
+    __m128d second = _mm_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        __m128d a = _mm_loadu_pd(values + i); // NOLINT
+        __m128d b = _mm_loadu_pd(values + i + 2); // NOLINT
+        first = _mm_add_pd(first, _mm_mul_pd(a, a));
+        second = _mm_add_pd(second, _mm_mul_pd(b, b));
+    }
+    __m128d total = _mm_add_pd(first, second);
+    result = _mm_cvtsd_f64(_mm_add_sd(total, _mm_unpackhi_pd(total, total)));
+#endif
+    for (; i < count; ++i) {
+        result += values[i] * values[i]; // NOLINT
+    }
+
+    return result;
+}
+
+void accumulate(double* out, const double* in, double scale, size_t count) noexcept
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d factor = _mm_set1_pd(scale);
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), _mm_mul_pd(factor, _mm_loadu_pd(in + i)))); // NOLINT
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] += scale * in[i]; // NOLINT
+    }
+}
+
+void accumulateSquares(double* out, const double* in, double scale, size_t count) noexcept
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d factor = _mm_set1_pd(scale);
+    for (; i + 2 <= count; i += 2) {
+        __m128d value = _mm_loadu_pd(in + i); // NOLINT
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), _mm_mul_pd(factor, _mm_mul_pd(value, value)))); // NOLINT
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] += scale * in[i] * in[i]; // NOLINT
+    }
+}
+
+void accumulateMagSquared(double* out, const double* in, double scale, size_t bins) noexcept
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d factor = _mm_set1_pd(scale);
+    for (; i + 2 <= bins; i += 2) {
+        // (re0 im0) (re1 im1) -> (re0 re1) (im0 im1)
+        __m128d first = _mm_loadu_pd(in + 2 * i); // NOLINT
+        __m128d second = _mm_loadu_pd(in + 2 * i + 2); // NOLINT
+        __m128d re = _mm_unpacklo_pd(first, second);
+        __m128d im = _mm_unpackhi_pd(first, second);
+        __m128d magSquared = _mm_add_pd(_mm_mul_pd(re, re), _mm_mul_pd(im, im));
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), _mm_mul_pd(factor, magSquared))); // NOLINT
+    }
+#endif
+    for (; i < bins; ++i) {
+        out[i] += scale * (in[2 * i] * in[2 * i] + in[2 * i + 1] * in[2 * i + 1]); // NOLINT
+    }
+}
+
+void accumulateWeightedComplex(double* out, const double* in, const double* weights, double scale, size_t bins) noexcept
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i < bins; ++i) {
+        // one bin per register, real and imaginary part share the weight
+        __m128d weight = _mm_set1_pd(scale * weights[i]); // NOLINT
+        _mm_storeu_pd(out + 2 * i, _mm_add_pd(_mm_loadu_pd(out + 2 * i), _mm_mul_pd(weight, _mm_loadu_pd(in + 2 * i)))); // NOLINT
+    }
+#endif
+    for (; i < bins; ++i) {
+        out[2 * i] += scale * weights[i] * in[2 * i]; // NOLINT
+        out[2 * i + 1] += scale * weights[i] * in[2 * i + 1]; // NOLINT
+    }
+}
+
+void accumulateWeighted(double* out, const double* in, const double* weights, double scale, size_t count) noexcept
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d factor = _mm_set1_pd(scale);
+    for (; i + 2 <= count; i += 2) {
+        __m128d weighted = _mm_mul_pd(_mm_loadu_pd(weights + i), _mm_loadu_pd(in + i)); // NOLINT
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), _mm_mul_pd(factor, weighted))); // NOLINT
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] += scale * weights[i] * in[i]; // NOLINT
+    }
+}
+
+void prefixSumSquares(double* out, const double* in, size_t count) noexcept
+{
+    size_t i = 0;
+    double carry = 0.0;
+#if defined(__SSE2__)
+    // two values at a time: [a, b] becomes [a, a + b], then everything before goes on top
+    __m128d total = _mm_setzero_pd();
+    const __m128d zero = _mm_setzero_pd();
+    for (; i + 2 <= count; i += 2) {
+        __m128d values = _mm_loadu_pd(in + i); // NOLINT
+        values = _mm_mul_pd(values, values);
+        values = _mm_add_pd(values, _mm_unpacklo_pd(zero, values));
+        values = _mm_add_pd(values, total);
+        _mm_storeu_pd(out + i, values); // NOLINT
+        total = _mm_unpackhi_pd(values, values);
+    }
+    carry = _mm_cvtsd_f64(total);
+#endif
+    for (; i < count; ++i) {
+        carry += in[i] * in[i]; // NOLINT
+        out[i] = carry; // NOLINT
+    }
+}
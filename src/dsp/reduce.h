@@ -0,0 +1,96 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_reduce_h
+#define laa_reduce_h
+
+#include <cstddef>
+
+/**
+ * \brief Sum of a range of values
+ * \param values first value
+ * \param count number of values
+ * \return the sum. 0 for an empty range.
+ */
+double sum(const double* values, size_t count) noexcept;
+
+/**
+ * \brief Sum of the squares of a range of values
+ * \param values first value
+ * \param count number of values
+ * \return the sum of squares. 0 for an empty range.
+ */
+double sumSquares(const double* values, size_t count) noexcept;
+
+/**
+ * \brief out += scale * in
+ * \param out where to add to
+ * \param in what to add
+ * \param scale factor for in. -1 takes back what 1 added.
+ * \param count number of values
+ */
+void accumulate(double* out, const double* in, double scale, size_t count) noexcept;
+
+/**
+ * \brief out += scale * in * in
+ * \param out where to add to
+ * \param in what to add the squares of
+ * \param scale factor for the squares
+ * \param count number of values
+ */
+void accumulateSquares(double* out, const double* in, double scale, size_t count) noexcept;
+
+/**
+ * \brief out += scale * |in|^2, for complex in
+ * \param out where to add to, one value per bin
+ * \param in complex values, real and imaginary part next to each other
+ * \param scale factor for the squares
+ * \param bins number of complex values
+ */
+void accumulateMagSquared(double* out, const double* in, double scale, size_t bins) noexcept;
+
+/**
+ * \brief out += scale * weights * in, for complex in
+ * \param out where to add to, complex like in
+ * \param in complex values, real and imaginary part next to each other
+ * \param weights one weight per bin
+ * \param scale factor on top of the weights
+ * \param bins number of complex values
+ */
+void accumulateWeightedComplex(double* out, const double* in, const double* weights, double scale, size_t bins) noexcept;
+
+/**
+ * \brief out += scale * weights * in
+ * \param out where to add to
+ * \param in what to add
+ * \param weights one weight per value
+ * \param scale factor on top of the weights
+ * \param count number of values
+ */
+void accumulateWeighted(double* out, const double* in, const double* weights, double scale, size_t count) noexcept;
+
+/**
+ * \brief Running sum of the squares, out[i] = in[0]^2 + ... + in[i]^2
+ * \param out the sums, count values. may not overlap in.
+ * \param in the values
+ * \param count number of values
+ *
+ * The energy between two points is the difference of their sums, so any number of ranges cost one pass.
+ */
+void prefixSumSquares(double* out, const double* in, size_t count) noexcept;
+
+#endif //laa_reduce_h
@@ -16,7 +16,7 @@
  */
 
 #include "sinegenerator.h"
-#include "../shared.h"
+#include "../core.h"
 #include <cmath>
 
 double SineGenerator::nextSample()
@@ -5,17 +5,15 @@
 #ifndef LAA_SMOOTHING_H
 #define LAA_SMOOTHING_H
 
+#include <algorithm>
 #include <cmath>
-#include <vector>
 
-template <class T, class Talloc = std::allocator<double>>
-void smooth(std::vector<T, Talloc>& out, const std::vector<T, Talloc>& in, size_t maxLen = 0)
+template <class OutContainer, class InContainer>
+void smooth(OutContainer& out, const InContainer& in, size_t maxLen = 0)
 {
-    if (out.size() != in.size()) {
-        out.resize(in.size(), 0.0F);
-    }
-    if (maxLen == 0) {
-        maxLen = out.size();
+    // out is sized by whoever owns it, so never go past either of them
+    if (maxLen == 0 || maxLen > std::min(out.size(), in.size())) {
+        maxLen = std::min(out.size(), in.size());
     }
     for (size_t writeIndex = 0; writeIndex < maxLen; ++writeIndex) {
         out[writeIndex] = 0.0;
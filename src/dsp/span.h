@@ -0,0 +1,120 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_span_h
+#define laa_span_h
+
+#include "../core.h"
+
+#include <cstddef>
+
+/**
+ * \brief A view of count values somebody else owns
+ *
+ * Works like a fixed size vector: a const Span only hands out const values.
+ * So a const StateData is read only all the way down, even though it does not own its products one by one.
+ */
+template <class T>
+class Span {
+public:
+    /// ctor. empty
+    Span() noexcept = default;
+    /**
+     * \brief ctor
+     * \param first first value
+     * \param length number of values
+     */
+    Span(T* first, size_t length) noexcept
+        : ptr(first)
+        , count(length)
+    {
+    }
+    /// copies the view, not the values
+    Span(const Span&) noexcept = default;
+    /// copies the view, not the values
+    Span(Span&&) noexcept = default;
+    /// copies the view, not the values
+    Span& operator=(const Span&) noexcept = default;
+    /// copies the view, not the values
+    Span& operator=(Span&&) noexcept = default;
+    /// dtor
+    ~Span() noexcept = default;
+
+    /// number of values
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return count;
+    }
+    /// true if there are no values
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return count == 0;
+    }
+    /// first value
+    T* data() noexcept
+    {
+        return ptr;
+    }
+    /// first value
+    const T* data() const noexcept
+    {
+        return ptr;
+    }
+    /// begin
+    T* begin() noexcept
+    {
+        return ptr;
+    }
+    /// begin
+    const T* begin() const noexcept
+    {
+        return ptr;
+    }
+    /// end
+    T* end() noexcept
+    {
+        return ptr + count; // NOLINT
+    }
+    /// end
+    const T* end() const noexcept
+    {
+        return ptr + count; // NOLINT
+    }
+    /// value at index. not range checked.
+    T& operator[](size_t index) noexcept
+    {
+        return ptr[index]; // NOLINT
+    }
+    /// value at index. not range checked.
+    const T& operator[](size_t index) const noexcept
+    {
+        return ptr[index]; // NOLINT
+    }
+
+private:
+    /// first value
+    T* ptr = nullptr;
+    /// number of values
+    size_t count = 0;
+};
+
+/// real values, viewed
+using RealSpan = Span<Real>;
+/// complex values, viewed
+using ComplexSpan = Span<Complex>;
+
+#endif //laa_span_h
@@ -16,7 +16,7 @@
  */
 
 #include "sweepgenerator.h"
-#include "../shared.h"
+#include "../core.h"
 #include <cmath>
 
 // https://ieeexplore.ieee.org/document/4813749
@@ -18,12 +18,12 @@
 #ifndef laa_hamming_h
 #define laa_hamming_h
 
-#include "../shared.h"
+#include "../core.h"
 #include <cmath>
 #include <vector>
 
-template <class T, class Talloc = std::allocator<T>>
-inline void hamming(std::vector<T, Talloc>& out, const std::vector<T, Talloc>& in)
+template <class OutContainer, class InContainer>
+inline void hamming(OutContainer& out, const InContainer& in)
 {
     auto M = static_cast<double>(in.size() - 1);
     for (size_t i = 0; i < in.size(); i++) {
@@ -32,8 +32,8 @@ inline void hamming(std::vector<T, Talloc>& out, const std::vector<T, Talloc>& i
     }
 }
 
-template <class T, class Talloc = std::allocator<T>>
-inline void blackman(std::vector<T, Talloc>& out, const std::vector<T, Talloc>& in)
+template <class OutContainer, class InContainer>
+inline void blackman(OutContainer& out, const InContainer& in)
 {
     auto M = static_cast<double>(in.size() - 1);
     for (size_t i = 0; i < in.size(); i++) {
@@ -42,8 +42,8 @@ inline void blackman(std::vector<T, Talloc>& out, const std::vector<T, Talloc>&
     }
 }
 
-template <class T, class Talloc = std::allocator<T>>
-inline void noWindow(std::vector<T, Talloc>& out, const std::vector<T, Talloc>& in)
+template <class OutContainer, class InContainer>
+inline void noWindow(OutContainer& out, const InContainer& in)
 {
     for (size_t i = 0; i < in.size(); i++) {
         out[i] = in[i];
@@ -30,13 +30,12 @@ void IrView::update(StateManager& stateManager, std::string idHint)
     ImGui::SetColumnWidth(-1, plotWidth);
 
     const auto& liveState = stateManager.getLive();
-    const auto& data = choose(smoothing, liveState.smoothedImpulseResponse, liveState.impulseResponse);
     // make sure range doesn't clip
     range = std::clamp(range, 0.0, liveState.fftDuration);
 
     PlotConfig plotConfig;
     plotConfig.label = "IR View";
-    plotConfig.size = ImVec2(plotWidth * 0.98F - 55.0F, size.y - 75.0F);
+    plotConfig.size = ImVec2(plotWidth * 0.98F - 55.0F, size.y - (showDecay ? 125.0F : 75.0F));
     plotConfig.yAxisConfig.min = -yRange;
     plotConfig.yAxisConfig.max = yRange;
     plotConfig.yAxisConfig.gridInterval = 0.1;
@@ -51,67 +50,58 @@ void IrView::update(StateManager& stateManager, std::string idHint)
         plotConfig.xAxisConfig.gridInterval = 0.01;
         plotConfig.xAxisConfig.min = -0.01F;
     }
-    BeginPlot(plotConfig);
-    if (liveState.visible) {
-        PlotSourceConfig sourceConfig;
-        sourceConfig.xMin = 0.0;
-        sourceConfig.xMax = liveState.fftDuration;
-        sourceConfig.color = liveState.uniqueCol;
-        sourceConfig.active = liveState.active;
-        sourceConfig.count = liveState.fftLen;
-        sourceConfig.antiAliasingBehaviour = AntiAliasingBehaviour::AbsMax;
-        auto clicked = Plot(
-            sourceConfig,
-            [&data, this](size_t idx) {
-                if (showAbsValues) {
-                    return std::abs(data[idx]);
-                }
-                return data[idx];
-            });
-        if (clicked) {
-            addMarker(liveState, clicked);
-        }
-    }
+    if (showDecay) {
+        drawDecay(stateManager, plotConfig.size);
+    } else {
+        BeginPlot(plotConfig);
+        auto plotState = [this](const DisplayState& state) {
+            if (!state.visible || state.data == nullptr) {
+                return;
+            }
+            const auto& data = *state.data;
+            const auto& stateData = choose(smoothing, data.smoothedImpulseResponse, data.impulseResponse);
+            PlotSourceConfig sourceConfig;
+            sourceConfig.count = data.fftLen;
+            sourceConfig.xMin = 0.0;
+            sourceConfig.xMax = data.fftDuration;
+            sourceConfig.color = state.uniqueCol;
+            sourceConfig.active = state.active;
+            sourceConfig.antiAliasingBehaviour = AntiAliasingBehaviour::AbsMax;
+            auto clicked = Plot(
+                sourceConfig, [&stateData, this](size_t idx) {
+                    if (showAbsValues) {
+                        return std::abs(stateData[idx]);
+                    }
+                    return stateData[idx];
+                });
+            if (clicked) {
+                addMarker(state, clicked);
+            }
+        };
 
-    for (auto& state : stateManager.getSaved()) {
-        if (!state.visible) {
-            continue;
+        for (const auto& state : stateManager.getLiveChannels()) {
+            plotState(state);
         }
-        const auto& stateData = choose(smoothing, state.smoothedImpulseResponse, state.impulseResponse);
-        PlotSourceConfig sourceConfig;
-        sourceConfig.count = state.fftLen;
-        sourceConfig.xMin = 0.0;
-        sourceConfig.xMax = state.fftDuration;
-        sourceConfig.color = state.uniqueCol;
-        sourceConfig.active = state.active;
-        sourceConfig.antiAliasingBehaviour = AntiAliasingBehaviour::AbsMax;
-        auto clicked = Plot(
-            sourceConfig, [&stateData, this](size_t idx) {
-                if (showAbsValues) {
-                    return std::abs(stateData[idx]);
-                }
-                return stateData[idx];
-            });
-        if (clicked) {
-            addMarker(state, clicked);
+        for (const auto& state : stateManager.getSaved()) {
+            plotState(state);
         }
-    }
 
-    // draw the markers
-    PlotMarkerConfig markerConfig = {};
-    markerConfig.drawYLine = true;
-    markerConfig.enableCustomLabel = true;
+        // draw the markers
+        PlotMarkerConfig markerConfig = {};
+        markerConfig.drawYLine = true;
+        markerConfig.enableCustomLabel = true;
 
-    for (const auto& marker : markers) {
-        markerConfig.color = marker.color;
-        markerConfig.customLabel = std::to_string(marker.clickInfo.x - refValue);
-        if (marker.isRef) {
-            markerConfig.customLabel = "Reference";
+        for (const auto& marker : markers) {
+            markerConfig.color = marker.color;
+            markerConfig.customLabel = std::to_string(marker.clickInfo.x - refValue);
+            if (marker.isRef) {
+                markerConfig.customLabel = "Reference";
+            }
+            PlotMarker(markerConfig, marker.clickInfo);
         }
-        PlotMarker(markerConfig, marker.clickInfo);
-    }
 
-    EndPlot();
+        EndPlot();
+    }
 
     // vertical slider for plot y
     ImGui::SameLine();
@@ -123,6 +113,23 @@ void IrView::update(StateManager& stateManager, std::string idHint)
     ImGui::Checkbox("Show Absolute Values", &showAbsValues);
     ImGui::SameLine();
     ImGui::Checkbox("Enable Smoothing", &smoothing);
+    ImGui::SameLine();
+    ImGui::Checkbox("Spectral Decay", &showDecay);
+    if (showDecay) {
+        float windowMs = static_cast<float>(decaySettings.windowMs);
+        float stepMs = static_cast<float>(decaySettings.stepMs);
+        int sliceCount = static_cast<int>(decaySettings.sliceCount);
+        ImGui::PushItemWidth(plotWidth / 4.0F);
+        ImGui::SliderFloat("Window (ms)", &windowMs, 5.0F, 500.0F, "%.0f");
+        ImGui::SameLine();
+        ImGui::SliderFloat("Step (ms)", &stepMs, 0.1F, 20.0F, "%.1f");
+        ImGui::SameLine();
+        ImGui::SliderInt("Slices", &sliceCount, 2, 128);
+        ImGui::PopItemWidth();
+        decaySettings.windowMs = static_cast<double>(windowMs);
+        decaySettings.stepMs = static_cast<double>(stepMs);
+        decaySettings.sliceCount = static_cast<size_t>(sliceCount);
+    }
     // now, marker selection
     ImGui::NextColumn();
     ImGui::SetColumnWidth(-1, size.x * 0.25F);
@@ -164,7 +171,7 @@ void IrView::update(StateManager& stateManager, std::string idHint)
     ImGui::EndChild();
 }
 
-void IrView::addMarker(const StateData& state, const PlotClickInfo& info) noexcept
+void IrView::addMarker(const DisplayState& state, const PlotClickInfo& info) noexcept
 {
     IrMarker marker;
     marker.clickInfo = info;
@@ -179,8 +186,9 @@ void IrView::clearRef() noexcept
     }
 }
 
-IrMarker makeMarkerFromPeak(const StateData& stateData)
+IrMarker makeMarkerFromPeak(const DisplayState& state)
 {
+    const auto& stateData = *state.data;
     size_t index = findAbsMax(stateData.impulseResponse);
     double yVal = stateData.impulseResponse[index];
     double xVal = stateData.fftDuration * static_cast<double>(index) / static_cast<double>(stateData.fftLen);
@@ -189,7 +197,7 @@ IrMarker makeMarkerFromPeak(const StateData& stateData)
     result.clickInfo.clicked = true;
     result.clickInfo.x = xVal;
     result.clickInfo.y = yVal;
-    result.color = stateData.uniqueCol;
+    result.color = state.uniqueCol;
 
     return result;
 }
@@ -198,13 +206,16 @@ void IrView::findPeak(StateManager& stateManager) noexcept
 {
     IrMarker marker = {};
     bool anyActive = false;
-    const auto& liveState = stateManager.getLive();
-    if (liveState.active) {
-        anyActive = true;
-        marker = makeMarkerFromPeak(liveState);
-    } else {
+    for (const auto& state : stateManager.getLiveChannels()) {
+        if (state.active && state.data != nullptr) {
+            marker = makeMarkerFromPeak(state);
+            anyActive = true;
+            break;
+        }
+    }
+    if (!anyActive) {
         for (const auto& state : stateManager.getSaved()) {
-            if (state.active) {
+            if (state.active && state.data != nullptr) {
                 marker = makeMarkerFromPeak(state);
                 anyActive = true;
                 break;
@@ -216,3 +227,71 @@ void IrView::findPeak(StateManager& stateManager) noexcept
         markers.push_back(marker);
     }
 }
+
+void IrView::drawDecay(StateManager& stateManager, ImVec2 plotSize) noexcept
+{
+    // the decay is for one state, the active one. live states change all the time, captures are kept by id.
+    const DisplayState* chosen = nullptr;
+    for (const auto& state : stateManager.getLiveChannels()) {
+        if (chosen == nullptr && state.active && state.data != nullptr) {
+            chosen = &state;
+        }
+    }
+    for (const auto& state : stateManager.getSaved()) {
+        if (chosen == nullptr && state.active && state.data != nullptr) {
+            chosen = &state;
+        }
+    }
+
+    std::shared_ptr<const DecayResult> result = nullptr;
+    if (chosen != nullptr) {
+        bool live = chosen->id == 0 || chosen->derived;
+        result = decayAnalyzer.get(live ? DecayAnalyzer::liveKey : chosen->id, *chosen->data, decaySettings);
+    }
+
+    PlotConfig plotConfig;
+    plotConfig.label = "Spectral Decay";
+    plotConfig.size = plotSize;
+    plotConfig.yAxisConfig.min = 0.0001;
+    plotConfig.yAxisConfig.max = 2.0;
+    plotConfig.yAxisConfig.enableLogScale = true;
+    plotConfig.yAxisConfig.gridInterval = 1.0;
+    plotConfig.yAxisConfig.gridHint = 1.0;
+    plotConfig.xAxisConfig.min = 30.0;
+    plotConfig.xAxisConfig.max = 20000.0;
+    plotConfig.xAxisConfig.enableLogScale = true;
+    plotConfig.xAxisConfig.gridInterval = 0.5;
+    plotConfig.xAxisConfig.gridHint = 1000.0;
+    BeginPlot(plotConfig);
+
+    if (result != nullptr) {
+        // the later the slice, the darker. drawn back to front, so the first slice ends up on top.
+        for (size_t slice = result->sliceCount; slice-- > 0;) {
+            PlotSourceConfig sourceConfig;
+            sourceConfig.count = result->binCount;
+            sourceConfig.xMin = 0.0;
+            sourceConfig.xMax = result->sampleRate / 2.0;
+            sourceConfig.color = ImColor(chosen->uniqueCol);
+            auto fade = 1.0F - 0.8F * static_cast<float>(slice) / static_cast<float>(result->sliceCount);
+            sourceConfig.color.Value.x *= fade;
+            sourceConfig.color.Value.y *= fade;
+            sourceConfig.color.Value.z *= fade;
+            sourceConfig.active = slice == 0;
+            const float* values = &result->magnitudes[slice * result->binCount];
+            Plot(sourceConfig, [values](size_t idx) {
+                return static_cast<double>(values[idx]); // NOLINT
+            });
+        }
+    }
+
+    EndPlot();
+
+    if (chosen == nullptr) {
+        ImGui::Text("Select a state to see its decay");
+    } else if (result != nullptr) {
+        ImGui::Text("%s: %d slices, %.1f ms apart, %d point dfts%s", chosen->name.c_str(), static_cast<int>(result->sliceCount), result->stepSeconds * 1000.0,
+            static_cast<int>(result->fftLen), decayAnalyzer.isBusy() ? ", updating..." : "");
+    } else {
+        ImGui::Text("%s", decayAnalyzer.isBusy() ? "Working out the decay..." : "Impulse response too short to slice");
+    }
+}
@@ -20,6 +20,7 @@
 
 #include "audio/audiohandler.h"
 #include "dsp/fft.h"
+#include "state/decay.h"
 #include "state/statemanager.h"
 
 struct IrMarker {
@@ -33,7 +34,7 @@ public:
     void update(StateManager& stateManager, std::string idHint);
 
 private:
-    void addMarker(const StateData& state, const PlotClickInfo& info) noexcept;
+    void addMarker(const DisplayState& state, const PlotClickInfo& info) noexcept;
     double range = 1.0;
     double yRange = 0.51;
     bool smoothing = false;
@@ -43,5 +44,13 @@ private:
     double refValue = 0.0;
     void clearRef() noexcept;
     void findPeak(StateManager& stateManager) noexcept;
+
+    /// draws the cumulative spectral decay of the active state in place of the ir
+    void drawDecay(StateManager& stateManager, ImVec2 plotSize) noexcept;
+    /// show the decay instead of the ir
+    bool showDecay = false;
+    DecaySettings decaySettings = {};
+    /// works out the decay in the background, so big irs do not stall the ui
+    DecayAnalyzer decayAnalyzer = {};
 };
 #endif //laa_irview_h
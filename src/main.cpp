@@ -17,18 +17,18 @@
 
 #include "shared.h"
 #include "viewmanager.h"
+#include <chrono>
 #include <ctime>
 #include <iostream>
 #include <memory>
 #include <random>
 
-static constexpr int startDelay = 300;
-static constexpr int initialLoopsBeforeLongLoad = 10;
 static constexpr int minimalWindowWidth = 320;
 static constexpr int minimalWindowHeight = 240;
 
 int main(int, char**)
 {
+    const auto launchTime = std::chrono::steady_clock::now();
     // we just need "random", not random
     // NOLINTNEXTLINE
     srand(static_cast<unsigned int>(time(nullptr)));
@@ -80,37 +80,7 @@ int main(int, char**)
     ImGui_ImplOpenGL3_Init(glsl_version);
     bool running = true;
 
-    // view manager takes quite a while, so show some "wait a second" text
-    // its in a loop so we actually get this out after the window is created and before we init
-    // this is also the reason for the delay
-    SDL_Delay(startDelay);
-    for (int i = 0; i < initialLoopsBeforeLongLoad; i++) {
-        SDL_Event e;
-        while (SDL_PollEvent(&e) != 0) {
-            if (ImGui_ImplSDL2_ProcessEvent(&e)) {
-                continue;
-            }
-            if (e.type == SDL_QUIT) {
-                running = false;
-            }
-        }
-        glClearColor(0.0F, 0.0F, 0.0F, 1.0F); // NOLINT
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // NOLINT
-
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplSDL2_NewFrame(window);
-        ImGui::NewFrame();
-        ImGui::Begin("Waiting info window", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
-        ImGui::Text("Setting up. This might take a while."); //NOLINT
-        ImGui::Text("Im sorry for this, but everything should be alot smoother as soon as we get going!"); //NOLINT
-        ImGui::End();
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        SDL_GL_SwapWindow(window);
-    }
-
-    // the blob above is there cause of this one
-    auto manager = std::make_unique<ViewManager>();
+    auto manager = std::make_unique<ViewManager>(launchTime);
 
     while (running) {
         SDL_Event e;
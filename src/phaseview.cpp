@@ -21,9 +21,6 @@ void PhaseView::update(StateManager& stateManager, std::string idHint)
 {
     ImGui::BeginChild((idHint + "Phase").c_str());
 
-    const auto& liveState = stateManager.getLive();
-    const auto& data = choose(smoothing, liveState.smoothedTransferFunction, liveState.transferFunction);
-
     auto size = ImGui::GetWindowContentRegionMax();
     PlotConfig plotConfig;
     plotConfig.size = ImVec2(size.x * 0.98F, size.y - 75.0F);
@@ -43,43 +40,33 @@ void PhaseView::update(StateManager& stateManager, std::string idHint)
 
     BeginPlot(plotConfig);
 
-    if (liveState.visible) {
-        PlotSourceConfig sourceConfig;
-        sourceConfig.count = liveState.fftLen / 2;
-        sourceConfig.xMin = 0.0;
-        sourceConfig.xMax = liveState.sampleRate / 2.0;
-        sourceConfig.color = liveState.uniqueCol;
-        sourceConfig.active = liveState.active;
-        sourceConfig.antiAliasingBehaviour = AntiAliasingBehaviour::AbsMax;
-        Plot(
-            sourceConfig,
-            [&data](size_t idx) {
-                if (idx >= data.size()) {
-                    return 0.0;
-                }
-
-                return phase(data[idx]);
-            });
-    }
-
-    for (auto& state : stateManager.getSaved()) {
-        if (!state.visible) {
-            continue;
+    auto plotState = [this](const DisplayState& state) {
+        if (!state.visible || state.data == nullptr) {
+            return;
         }
-        const auto& savedData = choose(smoothing, state.smoothedTransferFunction, state.transferFunction);
+        const auto& data = *state.data;
+        const auto& stateData = choose(smoothing, data.smoothedTransferFunction, data.transferFunction);
         PlotSourceConfig sourceConfig;
-        sourceConfig.count = state.fftLen / 2;
+        sourceConfig.count = data.fftLen / 2;
         sourceConfig.xMin = 0.0;
-        sourceConfig.xMax = state.sampleRate / 2.0;
+        sourceConfig.xMax = data.sampleRate / 2.0;
         sourceConfig.color = state.uniqueCol;
         sourceConfig.active = state.active;
+        sourceConfig.antiAliasingBehaviour = AntiAliasingBehaviour::AbsMax;
         Plot(
-            sourceConfig, [&savedData](size_t idx) {
-                if (idx >= savedData.size()) {
+            sourceConfig, [&stateData](size_t idx) {
+                if (idx >= stateData.size()) {
                     return 0.0;
                 }
-                return phase(savedData[idx]);
+                return phase(stateData[idx]);
             });
+    };
+
+    for (const auto& state : stateManager.getLiveChannels()) {
+        plotState(state);
+    }
+    for (const auto& state : stateManager.getSaved()) {
+        plotState(state);
     }
 
     EndPlot();
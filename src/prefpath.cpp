@@ -0,0 +1,58 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prefpath.h"
+
+#include <cstdlib>
+#include <filesystem>
+
+std::string getPrefPath() noexcept
+{
+    namespace fs = std::filesystem;
+
+    // NOLINTNEXTLINE getenv is fine, we do not set anything
+    auto env = [](const char* name) -> std::string {
+        const char* value = std::getenv(name);
+        return value != nullptr ? value : "";
+    };
+
+    fs::path base;
+#if defined(_WIN32)
+    base = env("APPDATA");
+#elif defined(__APPLE__)
+    if (!env("HOME").empty()) {
+        base = fs::path(env("HOME")) / "Library" / "Application Support";
+    }
+#else
+    base = env("XDG_DATA_HOME");
+    if (base.empty() && !env("HOME").empty()) {
+        base = fs::path(env("HOME")) / ".local" / "share";
+    }
+#endif
+    if (base.empty()) {
+        return ".";
+    }
+
+    fs::path path = base / "mkalte" / "laa";
+    std::error_code error;
+    fs::create_directories(path, error);
+    if (error) {
+        return ".";
+    }
+
+    return path.string();
+}
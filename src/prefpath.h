@@ -0,0 +1,31 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_prefpath_h
+#define laa_prefpath_h
+
+#include <string>
+
+/**
+ * \brief Directory for wisdom, logs and recordings. Created if it does not exist.
+ * \return the path, without a trailing separator. "." if there is no sensible place.
+ *
+ * Same place SDL_GetPrefPath("mkalte", "laa") picks, so the ui and the command line tool share their wisdom.
+ */
+std::string getPrefPath() noexcept;
+
+#endif //laa_prefpath_h
@@ -0,0 +1,128 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "roomview.h"
+
+#include <array>
+#include <cmath>
+#include <tuple>
+
+void RoomView::update(StateManager& stateManager, AudioHandler* audioHandler, std::string idHint) noexcept
+{
+    ImGui::BeginChild((idHint + "Room").c_str());
+    if (audioHandler != nullptr) {
+        audioHandler->requestRoomAcoustics();
+    }
+
+    // one state at a time, the active one
+    const DisplayState* chosen = nullptr;
+    for (const auto& state : stateManager.getLiveChannels()) {
+        if (chosen == nullptr && state.active && state.data != nullptr) {
+            chosen = &state;
+        }
+    }
+    for (const auto& state : stateManager.getSaved()) {
+        if (chosen == nullptr && state.active && state.data != nullptr) {
+            chosen = &state;
+        }
+    }
+    if (chosen == nullptr) {
+        ImGui::TextWrapped("Select a state to see its room acoustics");
+        ImGui::EndChild();
+        return;
+    }
+    const RoomAcoustics* acoustics = getAcoustics(*chosen);
+    ImGui::TextColored(ImColor(chosen->uniqueCol), "%s", chosen->name.c_str());
+    if (acoustics == nullptr) {
+        ImGui::TextWrapped("Waiting for the next frame...");
+        ImGui::EndChild();
+        return;
+    }
+
+    ImGui::Columns(static_cast<int>(RoomAcoustics::bandCount) + 1, "room acoustics");
+    ImGui::Text("Band");
+    for (double band : octaveBands) {
+        ImGui::NextColumn();
+        if (band >= 1000.0) {
+            ImGui::Text("%.0fk", band / 1000.0);
+        } else {
+            ImGui::Text("%.0f", band);
+        }
+    }
+    ImGui::NextColumn();
+    ImGui::Text("All");
+    ImGui::NextColumn();
+    ImGui::Separator();
+
+    // name, format, and where the value is. nan means it could not be measured.
+    using Getter = double (*)(const BandAcoustics&);
+    const std::array<std::tuple<const char*, const char*, Getter>, 6> rows = { {
+        { "EDT (s)", "%.2f", [](const BandAcoustics& band) { return band.edt; } },
+        { "T20 (s)", "%.2f", [](const BandAcoustics& band) { return band.t20; } },
+        { "T30 (s)", "%.2f", [](const BandAcoustics& band) { return band.t30; } },
+        { "C50 (dB)", "%.1f", [](const BandAcoustics& band) { return band.c50; } },
+        { "C80 (dB)", "%.1f", [](const BandAcoustics& band) { return band.c80; } },
+        { "D50 (%)", "%.0f", [](const BandAcoustics& band) { return band.d50 * 100.0; } },
+    } };
+    for (const auto& [name, format, getter] : rows) {
+        ImGui::Text("%s", name);
+        for (const auto& band : acoustics->bands) {
+            ImGui::NextColumn();
+            double value = getter(band);
+            if (std::isnan(value)) {
+                ImGui::TextDisabled("-");
+            } else {
+                ImGui::Text(format, value); // NOLINT the formats are the ones above
+            }
+        }
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    ImGui::TextDisabled("- means the decay does not go down far enough above the noise");
+    ImGui::EndChild();
+}
+
+const RoomAcoustics* RoomView::getAcoustics(const DisplayState& state) noexcept
+{
+    if (state.data->acoustics.valid) {
+        return &state.data->acoustics;
+    }
+    // live frames get them from the processing
+    if (state.id == 0 && !state.derived) {
+        return nullptr;
+    }
+
+    // the data is alive as long as the state holds it, so nothing else can be at the same address
+    cache.remove_if([](const Entry& entry) {
+        return entry.data.expired();
+    });
+    for (auto iter = cache.begin(); iter != cache.end(); ++iter) {
+        if (iter->data.lock() == state.data) {
+            cache.splice(cache.begin(), cache, iter);
+            return &cache.front().acoustics;
+        }
+    }
+
+    Entry entry;
+    entry.data = state.data;
+    entry.acoustics = analyzer.calc(*state.data);
+    cache.push_front(entry);
+    if (cache.size() > cacheSize) {
+        cache.pop_back();
+    }
+    return &cache.front().acoustics;
+}
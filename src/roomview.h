@@ -0,0 +1,66 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_roomview_h
+#define laa_roomview_h
+
+#include "audio/audiohandler.h"
+#include "state/roomacoustics.h"
+#include "state/statemanager.h"
+
+#include <list>
+#include <memory>
+
+/**
+ * \brief Shows the room acoustics parameters of the active state, per octave band
+ *
+ * Live frames get them from the processing while this is shown. Captures that do not have them, loaded ones for example, are worked out here once.
+ */
+class RoomView {
+public:
+    /**
+     * \brief Draw
+     * \param stateManager where the states come from
+     * \param audioHandler asked to work out the parameters of live frames. nullptr while the audio is set up.
+     * \param idHint to tell apart the places the view is drawn in
+     */
+    void update(StateManager& stateManager, AudioHandler* audioHandler, std::string idHint) noexcept;
+
+private:
+    /**
+     * \brief The parameters of a state
+     * \param state the state, with data
+     * \return the parameters. nullptr for live states that do not have them yet.
+     */
+    const RoomAcoustics* getAcoustics(const DisplayState& state) noexcept;
+
+    /// parameters worked out here, and what for
+    struct Entry {
+        /// the data they are for. once it is gone, so is the entry.
+        std::weak_ptr<const StateData> data = {};
+        /// the parameters
+        RoomAcoustics acoustics = {};
+    };
+    /// most recently used first
+    std::list<Entry> cache = {};
+    /// entries kept
+    static constexpr size_t cacheSize = 16;
+    /// works out the parameters of captures
+    RoomAnalyzer analyzer = {};
+};
+
+#endif //laa_roomview_h
@@ -18,7 +18,8 @@
 #ifndef laa_shared_h
 #define laa_shared_h
 
-#include <cstdio>
+// everything that is not ui lives in here, so the analysis can run without a display
+#include "core.h"
 
 #include <SDL.h>
 
@@ -32,40 +33,4 @@
 
 #include <GL/gl3w.h>
 
-#include <string>
-#include <vector>
-#include <random>
-
-#include "dsp/fft.h"
-#include "version.h"
-
-template <class T>
-T& choose(bool arg, T& trueArg, T& falseArg)
-{
-    if (arg) {
-        return trueArg;
-    }
-
-    return falseArg;
-}
-
-template <class T>
-const T& choose(bool arg, const T& trueArg, const T& falseArg)
-{
-    if (arg) {
-        return trueArg;
-    }
-
-    return falseArg;
-}
-
-#define LAA_PI 3.14159265358979323846
-
-/// hardcoded maximum for fft length
-static constexpr size_t LAA_MAX_FFT_LENGTH = 131072;
-/// hardcoded minimum for fft lenght
-static constexpr size_t LAA_MIN_FFT_LENGTH = 1024;
-/// hardcoded maximum for fft filtering
-static constexpr size_t LAA_MAX_FFT_AVG = 8;
-
 #endif //laa_shared_h
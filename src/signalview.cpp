@@ -22,8 +22,6 @@ void SignalView::update(StateManager& stateManager, std::string idHint) noexcept
     ImGui::BeginChild((idHint + "Signal").c_str());
 
     const auto& liveState = stateManager.getLive();
-    const auto& data = liveState.input;
-    (void)data;
     auto size = ImGui::GetWindowContentRegionMax();
     PlotConfig plotConfig;
     plotConfig.label = "Signal";
@@ -48,37 +46,32 @@ void SignalView::update(StateManager& stateManager, std::string idHint) noexcept
     plotConfig.xAxisConfig.gridInterval = 0.05;
 
     BeginPlot(plotConfig);
-    if (liveState.visible) {
-        PlotSourceConfig sourceConfig;
-        sourceConfig.count = liveState.fftLen;
-        sourceConfig.xMin = 0.0 - liveState.fftDuration;
-        sourceConfig.xMax = 0.0;
-        sourceConfig.color = liveState.uniqueCol;
-        sourceConfig.active = liveState.active;
-        Plot(
-            sourceConfig, [&data](size_t idx) {
-                return data[idx];
-            });
-    }
-
-    for (auto& state : stateManager.getSaved()) {
-        if (!state.visible) {
-            continue;
+    auto plotState = [](const DisplayState& state) {
+        if (!state.visible || state.data == nullptr) {
+            return;
         }
+        const auto& data = *state.data;
 
         PlotSourceConfig sourceConfig;
-        sourceConfig.count = state.fftLen;
-        sourceConfig.xMin = 0.0 - state.fftDuration;
+        sourceConfig.count = data.fftLen;
+        sourceConfig.xMin = 0.0 - data.fftDuration;
         sourceConfig.xMax = 0.0;
         sourceConfig.color = state.uniqueCol;
         sourceConfig.active = state.active;
         Plot(
-            sourceConfig, [&state](size_t idx) {
-                if (idx >= state.input.size()) {
+            sourceConfig, [&data](size_t idx) {
+                if (idx >= data.input.size()) {
                     return 0.0;
                 }
-                return state.input[idx];
+                return data.input[idx];
             });
+    };
+
+    for (const auto& state : stateManager.getLiveChannels()) {
+        plotState(state);
+    }
+    for (const auto& state : stateManager.getSaved()) {
+        plotState(state);
     }
 
     EndPlot();
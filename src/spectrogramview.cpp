@@ -0,0 +1,155 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spectrogramview.h"
+
+#include <algorithm>
+#include <cstdint>
+
+SpectrogramView::~SpectrogramView() noexcept
+{
+    if (texture != 0) {
+        glDeleteTextures(1, &texture);
+    }
+}
+
+void SpectrogramView::update(AudioHandler* audioHandler, std::string idHint) noexcept
+{
+    ImGui::BeginChild((idHint + "Spectrogram").c_str());
+    if (audioHandler == nullptr) {
+        ImGui::TextWrapped("Waiting for audio...");
+        ImGui::EndChild();
+        return;
+    }
+
+    // both panels can show this, the second one just finds no new rows
+    const auto& spectrogram = audioHandler->getSpectrogram();
+    upload(spectrogram);
+
+    auto size = ImGui::GetWindowContentRegionMax();
+    ImVec2 imageSize(size.x * 0.98F, std::max(size.y - 75.0F, 1.0F));
+    // the newest row goes on top, going down from there wraps around the texture
+    auto top = static_cast<float>(seenRows % textureRows) / static_cast<float>(textureRows);
+    auto imagePos = ImGui::GetCursorScreenPos();
+    // the texture name is the id, so NOLINTNEXTLINE
+    ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(texture)), imageSize, ImVec2(0.0F, top), ImVec2(1.0F, top - 1.0F));
+
+    double maxFrequency = spectrogram.getMaxFrequency();
+    double rowSeconds = audioHandler->getConfig().samplesToSeconds(audioHandler->getConfig().getHopSamples());
+    if (ImGui::IsItemHovered() && maxFrequency > 0.0) {
+        auto mouse = ImGui::GetMousePos();
+        auto x = std::clamp((mouse.x - imagePos.x) / imageSize.x, 0.0F, 1.0F);
+        auto y = std::clamp((mouse.y - imagePos.y) / imageSize.y, 0.0F, 1.0F);
+        double frequency = spectrogram.getColumnFrequency(static_cast<double>(x) * static_cast<double>(textureColumns), maxFrequency);
+        double age = static_cast<double>(y) * static_cast<double>(textureRows) * rowSeconds;
+        ImGui::SetTooltip("%.0f Hz, %.1f s ago", frequency, age);
+    }
+
+    ImGui::Text("%.0f Hz to %.0f Hz (log), %.1f s", Spectrogram::minFrequency, maxFrequency, static_cast<double>(textureRows) * rowSeconds);
+    ImGui::PushItemWidth(imageSize.x / 3.0F);
+    bool changed = ImGui::SliderFloat("min dB", &minDb, -200.0F, 20.0F, "%.0f");
+    ImGui::SameLine();
+    changed |= ImGui::SliderFloat("max dB", &maxDb, -200.0F, 20.0F, "%.0f");
+    maxDb = std::max(maxDb, minDb + 1.0F);
+    // the colors of the rows already uploaded are off now
+    dirty |= changed;
+
+    int channel = static_cast<int>(audioHandler->getSpectrogramChannel());
+    if (ImGui::InputInt("Channel", &channel)) {
+        int channelCount = static_cast<int>(audioHandler->getChannelCount());
+        audioHandler->setSpectrogramChannel(static_cast<size_t>(std::clamp(channel, 0, std::max(channelCount - 1, 0))));
+    }
+    ImGui::PopItemWidth();
+    ImGui::EndChild();
+}
+
+void SpectrogramView::upload(const Spectrogram& spectrogram) noexcept
+{
+    if (texture == 0) {
+        textureRows = spectrogram.getRows();
+        textureColumns = spectrogram.getColumns();
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        // drawing starts at the newest row and wraps around. the sizes are powers of two, so this works on gles 2 too.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        dirty = true;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    auto width = static_cast<GLsizei>(textureColumns);
+    size_t generation = spectrogram.getGeneration();
+    if (dirty || generation != seenGeneration) {
+        // start over black, the rows that are around get drawn over it
+        pixels.assign(textureRows * textureColumns * 4, 0);
+        for (size_t i = 3; i < pixels.size(); i += 4) {
+            pixels[i] = 255;
+        }
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, static_cast<GLsizei>(textureRows), 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        seenRows = 0;
+        seenGeneration = generation;
+        dirty = false;
+    }
+
+    size_t written = spectrogram.read(seenRows, rows);
+    size_t count = rows.size() / textureColumns;
+    seenRows = written;
+    if (count == 0) {
+        return;
+    }
+
+    pixels.resize(rows.size() * 4);
+    auto scale = 255.0F / (maxDb - minDb);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        auto level = static_cast<size_t>(std::clamp((rows[i] - minDb) * scale, 0.0F, 255.0F));
+        std::copy(colormap[level].begin(), colormap[level].end(), pixels.begin() + static_cast<std::ptrdiff_t>(i * 4));
+    }
+
+    // the rows go where the ring has them, which takes two uploads if they wrap around
+    size_t first = (written - count) % textureRows;
+    size_t beforeWrap = std::min(count, textureRows - first);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(first), width, static_cast<GLsizei>(beforeWrap), GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    if (count > beforeWrap) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, static_cast<GLsizei>(count - beforeWrap), GL_RGBA, GL_UNSIGNED_BYTE, &pixels[beforeWrap * textureColumns * 4]);
+    }
+}
+
+SpectrogramView::Colormap SpectrogramView::makeColormap() noexcept
+{
+    constexpr std::array<std::array<float, 3>, 5> stops = { {
+        { 0.0F, 0.0F, 0.0F },
+        { 40.0F, 10.0F, 110.0F },
+        { 180.0F, 30.0F, 120.0F },
+        { 250.0F, 120.0F, 30.0F },
+        { 255.0F, 250.0F, 180.0F },
+    } };
+
+    Colormap colormap = {};
+    for (size_t i = 0; i < colormap.size(); ++i) {
+        auto position = static_cast<float>(i) / static_cast<float>(colormap.size() - 1) * static_cast<float>(stops.size() - 1);
+        auto stop = std::min(static_cast<size_t>(position), stops.size() - 2);
+        auto t = position - static_cast<float>(stop);
+        for (size_t channel = 0; channel < 3; ++channel) {
+            colormap[i][channel] = static_cast<uint8_t>(stops[stop][channel] + t * (stops[stop + 1][channel] - stops[stop][channel]));
+        }
+        colormap[i][3] = 255;
+    }
+
+    return colormap;
+}
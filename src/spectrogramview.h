@@ -0,0 +1,94 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_spectrogramview_h
+#define laa_spectrogramview_h
+
+#include "audio/audiohandler.h"
+#include "shared.h"
+
+#include <array>
+#include <vector>
+
+/**
+ * \brief Shows the spectrogram of the audio handler as a waterfall, newest row on top
+ *
+ * The rows live in a texture the size of the spectrogram ring. Every frame only the new rows are uploaded,
+ * and the texture is drawn with an offset, so it scrolls without moving anything around.
+ */
+class SpectrogramView {
+public:
+    /// ctor
+    SpectrogramView() noexcept = default;
+    /// dtor. frees the texture
+    ~SpectrogramView() noexcept;
+    /// deleted
+    SpectrogramView(const SpectrogramView&) = delete;
+    /// deleted
+    SpectrogramView(SpectrogramView&&) = delete;
+    /// deleted
+    SpectrogramView& operator=(const SpectrogramView&) = delete;
+    /// deleted
+    SpectrogramView& operator=(SpectrogramView&&) = delete;
+
+    /**
+     * \brief Upload new rows and draw
+     * \param audioHandler where the spectrogram comes from. nullptr while the audio is set up.
+     * \param idHint to tell apart the places the view is drawn in
+     */
+    void update(AudioHandler* audioHandler, std::string idHint) noexcept;
+
+private:
+    /**
+     * \brief Bring the texture up to date with the spectrogram
+     * \param spectrogram the rows
+     */
+    void upload(const Spectrogram& spectrogram) noexcept;
+
+    /// color per level, from minDb to maxDb
+    using Colormap = std::array<std::array<uint8_t, 4>, 256>;
+    /**
+     * \brief Make the colormap. dark blue over red to yellow, so quiet is dark.
+     * \return the colormap
+     */
+    static Colormap makeColormap() noexcept;
+
+    /// holds the rows, rgba. 0 until the first update.
+    GLuint texture = 0;
+    /// rows of texture
+    size_t textureRows = 0;
+    /// columns of texture
+    size_t textureColumns = 0;
+    /// rows written to the spectrogram when we last read it
+    size_t seenRows = 0;
+    /// generation of the spectrogram when we last read it
+    size_t seenGeneration = 0;
+    /// true if the texture has to be redone from scratch, the colors changed for example
+    bool dirty = true;
+    /// level shown as the first color, in dB
+    float minDb = -120.0F;
+    /// level shown as the last color, in dB
+    float maxDb = 0.0F;
+    /// the rows read from the spectrogram
+    std::vector<float> rows = {};
+    /// rows as they go into the texture
+    std::vector<uint8_t> pixels = {};
+    /// level to color
+    Colormap colormap = makeColormap();
+};
+
+#endif //laa_spectrogramview_h
@@ -0,0 +1,141 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "analyzer.h"
+
+Analyzer::Analyzer(const Settings& newSettings, WorkerPool* newPool) noexcept
+    : settings(newSettings)
+    , pool(newPool)
+{
+    settings.analysisSamples = std::clamp(settings.analysisSamples, LAA_MIN_FFT_LENGTH, LAA_MAX_FFT_LENGTH);
+    settings.hopSamples = std::clamp(settings.hopSamples, static_cast<size_t>(1), settings.analysisSamples);
+    settings.inputChannels = std::max(settings.inputChannels, static_cast<size_t>(1));
+
+    // room for a full frame plus whatever the caller pushes while it is not complete yet
+    ring.configure(settings.inputChannels + 1, 2 * settings.analysisSamples);
+    for (size_t input = 0; input < settings.inputChannels; ++input) {
+        states.push_back(std::make_shared<State>(settings.analysisSamples));
+        states.back()->accessData().sampleRate = settings.sampleRate;
+        states.back()->accessData().fftDuration = static_cast<double>(settings.analysisSamples) / settings.sampleRate;
+    }
+    filterConfigs.assign(settings.inputChannels, settings.filterConfig);
+}
+
+void Analyzer::push(const double* reference, const double* const* inputs, size_t frames) noexcept
+{
+    size_t done = 0;
+    while (done < frames) {
+        // the ring is twice a frame long, so if it is full there is a frame to process
+        size_t span = std::min(frames - done, ring.getContiguousWritable());
+        if (span == 0) {
+            processReady();
+            continue;
+        }
+
+        std::copy_n(reference + done, span, ring.getWritePointer(0)); // NOLINT
+        for (size_t input = 0; input < settings.inputChannels; ++input) {
+            std::copy_n(inputs[input] + done, span, ring.getWritePointer(input + 1)); // NOLINT
+        }
+        ring.commitWrite(span);
+        done += span;
+        processReady();
+    }
+}
+
+void Analyzer::markGap() noexcept
+{
+    ring.markGap();
+}
+
+bool Analyzer::pull(std::vector<StateData>& results) noexcept
+{
+    if (pulledFrame == frameCount) {
+        return false;
+    }
+
+    pulledFrame = frameCount;
+    results.resize(states.size());
+    for (size_t input = 0; input < states.size(); ++input) {
+        results[input] = states[input]->getData();
+    }
+    return true;
+}
+
+const StateData& Analyzer::peek(size_t input) const noexcept
+{
+    static const StateData empty = {};
+    if (frameCount == 0 || input >= states.size()) {
+        return empty;
+    }
+    return states[input]->accessData();
+}
+
+void Analyzer::reset() noexcept
+{
+    ring.consume(ring.getReadable());
+    for (auto& filterConfig : filterConfigs) {
+        filterConfig.clearAvg();
+    }
+}
+
+size_t Analyzer::getFrameCount() const noexcept
+{
+    return frameCount;
+}
+
+const Analyzer::Settings& Analyzer::getSettings() const noexcept
+{
+    return settings;
+}
+
+void Analyzer::processReady() noexcept
+{
+    const size_t length = settings.analysisSamples;
+    while (ring.getReadable() >= length) {
+        // the reference only goes into the first state, the others get it during processing
+        bool discontinuous = ring.hasGap(length);
+        ring.read(0, states[0]->accessData().reference.data(), length);
+        for (size_t input = 0; input < states.size(); ++input) {
+            ring.read(input + 1, states[input]->accessData().input.data(), length);
+            states[input]->accessData().discontinuous = discontinuous;
+        }
+        ring.consume(settings.hopSamples);
+
+        calcFrame(states, filterConfigs, pool);
+        ++frameCount;
+    }
+}
+
+void Analyzer::calcFrame(const Frame& frame, std::vector<StateFilterConfig>& filterConfigs, WorkerPool* pool) noexcept
+{
+    if (frame.empty() || filterConfigs.size() < frame.size()) {
+        return;
+    }
+
+    // the first state does the reference, then the rest can go wide and reuse it
+    frame[0]->calc(filterConfigs[0]);
+    auto calcInput = [&frame, &filterConfigs](size_t index) {
+        frame[index + 1]->calc(filterConfigs[index + 1], *frame[0]);
+    };
+    if (pool != nullptr) {
+        pool->parallelFor(frame.size() - 1, calcInput);
+    } else {
+        for (size_t index = 0; index + 1 < frame.size(); ++index) {
+            calcInput(index);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_analyzer_h
+#define laa_analyzer_h
+
+#include "audio/capturering.h"
+#include "state.h"
+#include "workerpool.h"
+
+#include <memory>
+
+/**
+ * \brief The analysis engine on its own: push blocks of samples in, pull processed states out
+ *
+ * Cuts the pushed samples into frames on the hop grid and runs them through State::calc(), exactly like the live capture does.
+ * Everything happens on the thread that calls push(). The analyzer is not thread safe, push() and pull() from the same thread.
+ */
+class Analyzer {
+public:
+    /// one state per input. the first one also does the reference.
+    using Frame = std::vector<std::shared_ptr<State>>;
+
+    /**
+     * \brief What to analyze, and how
+     */
+    struct Settings {
+        /// length of a frame. clamped to LAA_MIN_FFT_LENGTH..LAA_MAX_FFT_LENGTH.
+        size_t analysisSamples = 32768;
+        /// distance between the starts of two frames
+        size_t hopSamples = 32768;
+        /// number of measurement channels
+        size_t inputChannels = 1;
+        /// sample rate of the pushed samples
+        double sampleRate = 48000.0;
+        /// window and averaging settings. every input gets its own copy.
+        StateFilterConfig filterConfig = {};
+    };
+
+    /**
+     * \brief Set up the analyzer. The ffts start out estimated, see getBestFftPlan().
+     * \param settings what to do
+     * \param pool optional. the inputs of a frame are spread over it.
+     */
+    explicit Analyzer(const Settings& settings, WorkerPool* pool = nullptr) noexcept;
+    /// dtor
+    ~Analyzer() noexcept = default;
+    /// deleted
+    Analyzer(const Analyzer&) = delete;
+    /// deleted
+    Analyzer(Analyzer&&) = delete;
+    /// deleted
+    Analyzer& operator=(const Analyzer&) = delete;
+    /// deleted
+    Analyzer& operator=(Analyzer&&) = delete;
+
+    /**
+     * \brief Push a block of samples, and process every frame it completes
+     * \param reference frames samples of the reference
+     * \param inputs one pointer per input channel, frames samples each
+     * \param frames number of samples per channel
+     */
+    void push(const double* reference, const double* const* inputs, size_t frames) noexcept;
+
+    /**
+     * \brief Tell the analyzer samples got lost before the next push(). Frames across the gap are flagged discontinuous.
+     */
+    void markGap() noexcept;
+
+    /**
+     * \brief Get the newest results, if there are new ones
+     * \param results gets one StateData per input channel
+     * \return true if there was a frame since the last pull(). results is left alone if not.
+     */
+    bool pull(std::vector<StateData>& results) noexcept;
+
+    /**
+     * \brief Access the newest result without a copy. Valid until the next push().
+     * \param input the input channel
+     * \return the state data. empty if there is no frame yet, or no such input.
+     */
+    [[nodiscard]] const StateData& peek(size_t input) const noexcept;
+
+    /**
+     * \brief Throw away pushed samples that are not processed yet, and clear the averages
+     */
+    void reset() noexcept;
+
+    /**
+     * \brief Number of frames processed so far
+     * \return frame count
+     */
+    [[nodiscard]] size_t getFrameCount() const noexcept;
+
+    /**
+     * \brief Run one frame through State::calc(). Everything that processes frames goes through here, so they all get the same results.
+     * \param frame the states, with input, reference and flags filled in. the reference only needs to be in the first one.
+     * \param filterConfigs one per state, at least frame.size()
+     * \param pool optional. the inputs after the first one are spread over it.
+     */
+    static void calcFrame(const Frame& frame, std::vector<StateFilterConfig>& filterConfigs, WorkerPool* pool) noexcept;
+
+    /**
+     * \brief The settings the analyzer runs with
+     * \return settings
+     */
+    [[nodiscard]] const Settings& getSettings() const noexcept;
+
+private:
+    /// process every complete frame in the ring
+    void processReady() noexcept;
+
+    /// the settings
+    Settings settings = {};
+    /// spreads the inputs
+    WorkerPool* pool = nullptr;
+    /// pushed samples wait in here until a frame is complete. channel 0 is the reference, the inputs follow.
+    CaptureRing ring = {};
+    /// one state per input. the first one also does the reference.
+    Frame states = {};
+    /// a filter per input, so they average on their own
+    std::vector<StateFilterConfig> filterConfigs = {};
+    /// frames processed
+    size_t frameCount = 0;
+    /// frameCount at the last pull()
+    size_t pulledFrame = 0;
+};
+
+#endif //laa_analyzer_h
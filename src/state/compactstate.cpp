@@ -0,0 +1,182 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compactstate.h"
+#include "dsp/smoothing.h"
+#include "state.h"
+
+#include <algorithm>
+#include <atomic>
+
+CompactState::CompactState(const StateData& data, StateWindowFilter window) noexcept
+    : fftLen(data.fftLen)
+    , input(data.input.begin(), data.input.end())
+    , reference(data.reference.begin(), data.reference.end())
+    , avgMag(data.avgMag.begin(), data.avgMag.end())
+    , windowFilter(window)
+    , fftDuration(data.fftDuration)
+    , sampleRate(data.sampleRate)
+    , discontinuous(data.discontinuous)
+    , reducedLoad(data.reducedLoad)
+    , acoustics(data.acoustics)
+{
+    static std::atomic<uint64_t> nextId = 1;
+    id = nextId++;
+}
+
+StateData CompactState::expand() const noexcept
+{
+    State state(fftLen);
+    auto& data = state.accessData();
+    std::copy(input.begin(), input.end(), data.input.begin());
+    std::copy(reference.begin(), reference.end(), data.reference.begin());
+    data.fftDuration = fftDuration;
+    data.sampleRate = sampleRate;
+    data.discontinuous = discontinuous;
+
+    // no averaging, avgMag was averaged over frames that are long gone. it is put back afterwards.
+    StateFilterConfig filterConfig;
+    filterConfig.windowFilter = windowFilter;
+    filterConfig.avgCount = 0;
+    state.calc(filterConfig);
+    std::copy(avgMag.begin(), avgMag.end(), data.avgMag.begin());
+    smooth(data.smoothedAvgMag, data.avgMag);
+    data.acoustics = acoustics;
+    // full quality now, but the average was still built under reduced load
+    data.reducedLoad = reducedLoad;
+
+    return std::move(data);
+}
+
+size_t CompactState::getMemoryUsage() const noexcept
+{
+    return (input.size() + reference.size() + avgMag.size()) * sizeof(float);
+}
+
+uint64_t CompactState::getId() const noexcept
+{
+    return id;
+}
+
+bool CompactState::isReducedLoad() const noexcept
+{
+    return reducedLoad;
+}
+
+StateCache::StateCache(size_t maxEntries) noexcept
+    : capacity(maxEntries)
+{
+}
+
+StateCache::~StateCache() noexcept
+{
+    std::unique_lock<std::mutex> guard(lock);
+    pending.clear();
+    guard.unlock();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<const StateData> StateCache::get(const std::shared_ptr<const CompactState>& compact) noexcept
+{
+    if (compact == nullptr) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto iter = std::find_if(entries.begin(), entries.end(), [&compact](const auto& entry) {
+        return entry.first == compact->getId();
+    });
+    if (iter != entries.end()) {
+        entries.splice(entries.begin(), entries, iter);
+        return entries.front().second;
+    }
+
+    bool waiting = expanding == compact->getId() || std::any_of(pending.begin(), pending.end(), [&compact](const auto& other) {
+        return other->getId() == compact->getId();
+    });
+    if (!waiting) {
+        pending.push_back(compact);
+    }
+    // the last worker is done, as busy is not set. start the next.
+    if (!busy) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+        busy = true;
+        worker = std::thread([this]() {
+            expandPending();
+        });
+    }
+    return nullptr;
+}
+
+bool StateCache::isPending(const CompactState& compact) const noexcept
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return expanding == compact.getId() || std::any_of(pending.begin(), pending.end(), [&compact](const auto& other) {
+        return other->getId() == compact.getId();
+    });
+}
+
+void StateCache::insert(const CompactState& compact, StateData data) noexcept
+{
+    auto shared = std::make_shared<const StateData>(std::move(data));
+    std::lock_guard<std::mutex> guard(lock);
+    insertLocked(compact.getId(), std::move(shared));
+}
+
+void StateCache::expandPending() noexcept
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (!pending.empty()) {
+        auto compact = pending.front();
+        pending.pop_front();
+        expanding = compact->getId();
+        guard.unlock();
+
+        auto data = std::make_shared<const StateData>(compact->expand());
+
+        guard.lock();
+        insertLocked(compact->getId(), std::move(data));
+        expanding = 0;
+    }
+    busy = false;
+}
+
+void StateCache::insertLocked(uint64_t id, std::shared_ptr<const StateData> data) noexcept
+{
+    // an earlier expansion of the same capture might have come in meanwhile
+    entries.remove_if([id](const auto& entry) {
+        return entry.first == id;
+    });
+    entries.emplace_front(id, std::move(data));
+    while (entries.size() > capacity) {
+        entries.pop_back();
+    }
+}
+
+size_t StateCache::getMemoryUsage() const noexcept
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t usage = 0;
+    for (const auto& entry : entries) {
+        usage += entry.second->getMemoryUsage();
+    }
+    return usage;
+}
@@ -0,0 +1,178 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_compactstate_h
+#define laa_compactstate_h
+
+#include "statedata.h"
+#include "statefilter.h"
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * \brief A capture, kept small
+ *
+ * Only keeps what can not be derived from the frame alone: input, reference and the averaged magnitude, as floats.
+ * That is about 12 bytes per sample instead of the 176 of a full StateData.
+ * Everything else comes from expand(), which runs the frame through a State again.
+ * Samples come in as floats or smaller integers, so the input and reference survive this unchanged.
+ */
+class CompactState {
+public:
+    /**
+     * \brief ctor
+     * \param data the frame to keep
+     * \param window window data was processed with
+     */
+    CompactState(const StateData& data, StateWindowFilter window) noexcept;
+
+    /**
+     * \brief Recompute all products
+     * \return the full state
+     */
+    [[nodiscard]] StateData expand() const noexcept;
+
+    /**
+     * \brief Memory used by this capture
+     * \return size in bytes
+     */
+    [[nodiscard]] size_t getMemoryUsage() const noexcept;
+
+    /**
+     * \brief Identifies this capture in a StateCache. Copies share it.
+     * \return the id
+     */
+    [[nodiscard]] uint64_t getId() const noexcept;
+
+    /**
+     * \brief If the frame was processed under reduced load. expand() does the full processing either way.
+     * \return see StateData::reducedLoad
+     */
+    [[nodiscard]] bool isReducedLoad() const noexcept;
+
+private:
+    /// unique for every capture made
+    uint64_t id = 0;
+    /// number of samples
+    size_t fftLen = 0;
+    /// raw input
+    std::vector<float> input = {};
+    /// raw reference
+    std::vector<float> reference = {};
+    /// averaged magnitude. depends on the frames before this one, so it is kept
+    std::vector<float> avgMag = {};
+    /// window the frame was processed with
+    StateWindowFilter windowFilter = StateWindowFilter::Blackman;
+    /// see StateData::fftDuration
+    double fftDuration = 0.0;
+    /// see StateData::sampleRate
+    double sampleRate = 0.0;
+    /// see StateData::discontinuous
+    bool discontinuous = false;
+    /// see StateData::reducedLoad
+    bool reducedLoad = false;
+    /// see StateData::acoustics. kept, so expanding does not have to work them out again.
+    RoomAcoustics acoustics = {};
+};
+
+/**
+ * \brief The last few expanded captures
+ *
+ * Expanding a capture means a full State::calc(), so the ones on screen are kept.
+ * The least recently used one goes when the cache is full.
+ * Expanding happens in the background, one capture after the other, so asking for a lot of them does not hold up the caller.
+ */
+class StateCache {
+public:
+    /**
+     * \brief ctor
+     * \param maxEntries number of expanded captures to keep around
+     */
+    explicit StateCache(size_t maxEntries) noexcept;
+    /// dtor. drops what is still waiting, and waits for the capture being expanded
+    ~StateCache() noexcept;
+    /// deleted
+    StateCache(const StateCache&) = delete;
+    /// deleted
+    StateCache(StateCache&&) = delete;
+    /// deleted
+    StateCache& operator=(const StateCache&) = delete;
+    /// deleted
+    StateCache& operator=(StateCache&&) = delete;
+
+    /**
+     * \brief Get the full state of a capture, and have it expanded if it is not cached
+     * \param compact the capture. kept until it is expanded.
+     * \return the full state. stays valid after it leaves the cache. nullptr while it is being expanded.
+     */
+    std::shared_ptr<const StateData> get(const std::shared_ptr<const CompactState>& compact) noexcept;
+
+    /**
+     * \brief Check if a capture is waiting to be expanded, or being expanded
+     * \param compact the capture
+     * \return true until get() has it
+     */
+    [[nodiscard]] bool isPending(const CompactState& compact) const noexcept;
+
+    /**
+     * \brief Add a capture that is already expanded, so get() does not have to do it again
+     * \param compact the capture
+     * \param data its full state
+     */
+    void insert(const CompactState& compact, StateData data) noexcept;
+
+    /**
+     * \brief Memory used by the cached states
+     * \return size in bytes
+     */
+    [[nodiscard]] size_t getMemoryUsage() const noexcept;
+
+private:
+    /**
+     * \brief Expand what is waiting, until nothing is. Runs on worker.
+     */
+    void expandPending() noexcept;
+
+    /**
+     * \brief Add an expanded capture. Expects lock to be held.
+     * \param id the capture
+     * \param data its full state
+     */
+    void insertLocked(uint64_t id, std::shared_ptr<const StateData> data) noexcept;
+
+    /// most recently used first
+    std::list<std::pair<uint64_t, std::shared_ptr<const StateData>>> entries = {};
+    /// see ctor
+    size_t capacity = 0;
+    /// captures waiting to be expanded, oldest first
+    std::deque<std::shared_ptr<const CompactState>> pending = {};
+    /// id of the capture being expanded right now. 0 if none.
+    uint64_t expanding = 0;
+    /// protects entries, pending and expanding
+    mutable std::mutex lock = {};
+    /// expands the pending captures
+    std::thread worker = {};
+    /// true while worker is busy
+    bool busy = false;
+};
+
+#endif //laa_compactstate_h
@@ -0,0 +1,201 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "decay.h"
+#include "dsp/fftplan.h"
+#include "dsp/peak.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+/// longest dft a slice gets. longer windows are cut to it.
+constexpr size_t maxFftLen = 65536;
+/// most slices made
+constexpr size_t maxSlices = 256;
+
+/**
+ * \brief Half a hann window, going up
+ * \param position how far into it, 0 to 1
+ * \return the gain
+ */
+double halfHann(double position) noexcept
+{
+    return 0.5 - 0.5 * std::cos(LAA_PI * std::clamp(position, 0.0, 1.0));
+}
+} // namespace
+
+bool DecaySettings::operator==(const DecaySettings& other) const noexcept
+{
+    // the values come from sliders, they are either the same or far apart
+    return std::abs(windowMs - other.windowMs) < 1e-9 && std::abs(stepMs - other.stepMs) < 1e-9 && sliceCount == other.sliceCount && std::abs(riseMs - other.riseMs) < 1e-9;
+}
+
+std::shared_ptr<const DecayResult> calcDecay(const RealVec& impulseResponse, double sampleRate, const DecaySettings& settings, WorkerPool* pool) noexcept
+{
+    auto toSamples = [sampleRate](double ms) {
+        return static_cast<size_t>(std::max(std::round(ms * sampleRate / 1000.0), 0.0));
+    };
+
+    // the first slice starts a bit in front of the peak, so the direct sound is all in there
+    size_t length = impulseResponse.size();
+    size_t rise = toSamples(settings.riseMs);
+    size_t peak = findAbsMax(impulseResponse);
+    size_t start = peak > rise ? peak - rise : 0;
+    size_t window = std::min(toSamples(settings.windowMs), length - std::min(start, length));
+    size_t fftLen = 16;
+    while (fftLen < window && fftLen < maxFftLen) {
+        fftLen *= 2;
+    }
+    window = std::min(window, fftLen);
+    // every slice ends where the first one ends. what comes after that is faded out, in all of them.
+    size_t end = start + window;
+    size_t fall = std::max(rise, window / 10);
+    size_t step = std::max<size_t>(toSamples(settings.stepMs), 1);
+    // the last slice has to have more than just its rise and fall left
+    size_t shortest = std::min(window, rise + fall + 8);
+    if (sampleRate <= 0.0 || window < 16 || settings.sliceCount == 0) {
+        return nullptr;
+    }
+    size_t slices = std::min({ settings.sliceCount, maxSlices, (window - shortest) / step + 1 });
+
+    auto result = std::make_shared<DecayResult>();
+    result->settings = settings;
+    result->fftLen = fftLen;
+    result->binCount = fftLen / 2 + 1;
+    result->sliceCount = slices;
+    result->sampleRate = sampleRate;
+    result->stepSeconds = static_cast<double>(step) / sampleRate;
+    result->magnitudes.resize(slices * result->binCount);
+
+    // one batch per thread, all the same size so they share a plan. the padding slices stay zero.
+    size_t batches = pool != nullptr ? std::min(slices, pool->getThreadCount() + 1) : 1;
+    size_t perBatch = (slices + batches - 1) / batches;
+    batches = (slices + perBatch - 1) / perBatch;
+    fftw_plan plan = getFftBatchPlan(fftLen, perBatch);
+    if (plan == nullptr) {
+        return nullptr;
+    }
+    RealVec input(batches * perBatch * fftLen, 0.0);
+    ComplexVec output(batches * perBatch * result->binCount);
+
+    auto runBatch = [&](size_t batch) {
+        size_t firstSlice = batch * perBatch;
+        size_t lastSlice = std::min(firstSlice + perBatch, slices);
+        for (size_t slice = firstSlice; slice < lastSlice; ++slice) {
+            size_t sliceStart = start + slice * step;
+            auto* target = &input[slice * fftLen];
+            for (size_t i = sliceStart; i < end; ++i) {
+                double gain = rise > 0 ? halfHann(static_cast<double>(i - sliceStart) / static_cast<double>(rise)) : 1.0;
+                gain *= halfHann(static_cast<double>(end - i) / static_cast<double>(fall));
+                target[i - sliceStart] = impulseResponse[i] * gain; // NOLINT
+            }
+        }
+        // the batch plan wants its buffers at the same alignment as it was planned with. every slice starts on an fft length offset, so they are.
+        // NOLINTNEXTLINE
+        fftw_execute_dft_r2c(plan, &input[firstSlice * fftLen], reinterpret_cast<fftw_complex*>(&output[firstSlice * result->binCount]));
+        for (size_t i = firstSlice * result->binCount; i < lastSlice * result->binCount; ++i) {
+            result->magnitudes[i] = static_cast<float>(mag(output[i]));
+        }
+    };
+    if (pool != nullptr && batches > 1) {
+        pool->parallelFor(batches, runBatch);
+    } else {
+        for (size_t batch = 0; batch < batches; ++batch) {
+            runBatch(batch);
+        }
+    }
+
+    // everything relative to the first slice, so the decay reads as a drop from there
+    auto first = result->magnitudes.begin() + static_cast<std::ptrdiff_t>(result->binCount);
+    float loudest = *std::max_element(result->magnitudes.begin(), first);
+    if (loudest > 0.0F) {
+        for (auto& value : result->magnitudes) {
+            value /= loudest;
+        }
+    }
+
+    return result;
+}
+
+DecayAnalyzer::~DecayAnalyzer() noexcept
+{
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<const DecayResult> DecayAnalyzer::get(uint64_t key, const StateData& data, const DecaySettings& settings) noexcept
+{
+    auto now = std::chrono::steady_clock::now();
+    std::shared_ptr<const DecayResult> fallback = nullptr;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        for (auto iter = cache.begin(); iter != cache.end(); ++iter) {
+            if (iter->key != key) {
+                continue;
+            }
+            if (!(iter->settings == settings)) {
+                // something to show while the new settings are worked out
+                if (!fallback) {
+                    fallback = iter->result;
+                }
+                continue;
+            }
+            cache.splice(cache.begin(), cache, iter);
+            fallback = cache.front().result;
+            found = key != liveKey || now - cache.front().time < std::chrono::duration<double>(liveInterval);
+            break;
+        }
+    }
+    if (found || busy || data.fftLen == 0) {
+        return fallback;
+    }
+
+    // the last one is done, as busy is not set. start the next.
+    if (worker.joinable()) {
+        worker.join();
+    }
+    busy = true;
+    RealVec impulseResponse(data.impulseResponse.begin(), data.impulseResponse.end());
+    worker = std::thread([this, key, settings, now, sampleRate = data.sampleRate, impulseResponse = std::move(impulseResponse)]() {
+        Entry entry;
+        entry.key = key;
+        entry.settings = settings;
+        entry.time = now;
+        entry.result = calcDecay(impulseResponse, sampleRate, settings, &pool);
+        {
+            std::lock_guard<std::mutex> guard(cacheLock);
+            cache.remove_if([key, &settings](const Entry& other) {
+                return other.key == key && other.settings == settings;
+            });
+            cache.push_front(std::move(entry));
+            if (cache.size() > cacheSize) {
+                cache.pop_back();
+            }
+        }
+        busy = false;
+    });
+
+    return fallback;
+}
+
+bool DecayAnalyzer::isBusy() const noexcept
+{
+    return busy;
+}
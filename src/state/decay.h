@@ -0,0 +1,153 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_decay_h
+#define laa_decay_h
+
+#include "statedata.h"
+#include "workerpool.h"
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief How to slice up an impulse response for the cumulative spectral decay
+ */
+struct DecaySettings {
+    /// length of the first slice, from the start of the rise in front of the peak, in ms. all slices end where it ends.
+    double windowMs = 50.0;
+    /// how much later each slice starts than the one before, in ms
+    double stepMs = 1.0;
+    /// number of slices. fewer are made if the window runs out first.
+    size_t sliceCount = 32;
+    /// length of the rise in front of every slice, in ms
+    double riseMs = 0.5;
+
+    /**
+     * \brief Compare
+     * \param other the other settings
+     * \return true if everything is the same
+     */
+    bool operator==(const DecaySettings& other) const noexcept;
+};
+
+/**
+ * \brief Magnitude spectra of an impulse response, windowed later and later, so what rings on stands out
+ */
+struct DecayResult {
+    /// what it was made with
+    DecaySettings settings = {};
+    /// length of the dfts. the window is zero padded to it.
+    size_t fftLen = 0;
+    /// number of bins per slice, fftLen / 2 + 1
+    size_t binCount = 0;
+    /// number of slices made
+    size_t sliceCount = 0;
+    /// sample rate of the impulse response
+    double sampleRate = 0.0;
+    /// time between slices, in seconds. rounded to samples.
+    double stepSeconds = 0.0;
+    /// the slices, binCount values each. relative to the loudest bin of the first slice.
+    std::vector<float> magnitudes = {};
+};
+
+/**
+ * \brief Work out the cumulative spectral decay of an impulse response
+ * \param impulseResponse the impulse response
+ * \param sampleRate its sample rate
+ * \param settings how to slice it up
+ * \param pool spreads the slices. nullptr runs it all on the caller.
+ * \return the result. nullptr if the impulse response is too short to slice.
+ *
+ * All slices go through one batched dft plan, which the pool splits into one batch per thread.
+ */
+std::shared_ptr<const DecayResult> calcDecay(const RealVec& impulseResponse, double sampleRate, const DecaySettings& settings, WorkerPool* pool) noexcept;
+
+/**
+ * \brief Works out decays in the background, and keeps the last few around
+ *
+ * Captures do not change, so their results are kept by id until they fall out of the cache.
+ * Data that does change is redone every liveInterval, for as long as it is asked for.
+ */
+class DecayAnalyzer {
+public:
+    /// key of data that changes all the time
+    static constexpr uint64_t liveKey = 0;
+    /// how often data under liveKey is redone, in seconds
+    static constexpr double liveInterval = 0.5;
+    /// number of results kept
+    static constexpr size_t cacheSize = 8;
+
+    /// ctor
+    DecayAnalyzer() noexcept = default;
+    /// dtor. waits for the computation in progress
+    ~DecayAnalyzer() noexcept;
+    /// deleted
+    DecayAnalyzer(const DecayAnalyzer&) = delete;
+    /// deleted
+    DecayAnalyzer(DecayAnalyzer&&) = delete;
+    /// deleted
+    DecayAnalyzer& operator=(const DecayAnalyzer&) = delete;
+    /// deleted
+    DecayAnalyzer& operator=(DecayAnalyzer&&) = delete;
+
+    /**
+     * \brief Get the decay of some data, and have it worked out if there is none yet
+     * \param key identifies the data, a capture id for example. liveKey for data that changes.
+     * \param data the data. its impulse response is copied if it has to be worked out, nothing is kept.
+     * \param settings how to slice it up
+     * \return the result for key and settings. while that is being worked out, the last one for key, or nullptr if there is none.
+     */
+    std::shared_ptr<const DecayResult> get(uint64_t key, const StateData& data, const DecaySettings& settings) noexcept;
+
+    /**
+     * \brief Check if something is being worked out
+     * \return true while busy
+     */
+    [[nodiscard]] bool isBusy() const noexcept;
+
+private:
+    /// a result, and what it was made from
+    struct Entry {
+        /// key of the data
+        uint64_t key = 0;
+        /// how it was sliced up
+        DecaySettings settings = {};
+        /// when it was started
+        std::chrono::steady_clock::time_point time = {};
+        /// the result. nullptr if there was nothing to slice.
+        std::shared_ptr<const DecayResult> result = nullptr;
+    };
+
+    /// the results, most recently used first
+    std::list<Entry> cache = {};
+    /// protects cache
+    std::mutex cacheLock = {};
+    /// works out one result at a time
+    std::thread worker = {};
+    /// true while worker is busy
+    std::atomic<bool> busy = false;
+    /// spreads the slices of the computation
+    WorkerPool pool = {};
+};
+
+#endif //laa_decay_h
@@ -0,0 +1,203 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "roomacoustics.h"
+#include "dsp/fftplan.h"
+#include "dsp/peak.h"
+#include "dsp/reduce.h"
+#include "statedata.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+/// order of the band filters. 3 is what iec 61260 class 1 filters usually are.
+constexpr double filterOrder = 3.0;
+/// weights below this are left out, -80dB
+constexpr double weightFloor = 1e-4;
+/// the direct sound starts where the response first comes within 20dB of its peak, as ISO 3382 has it
+constexpr double onsetRatio = 0.01;
+/// the energy is averaged over this long to find where it goes into the noise, in seconds
+constexpr double noiseWindow = 0.01;
+/// most points per regression. the decay is smooth, more only costs time.
+constexpr size_t maxRegressionPoints = 2048;
+/// not measured
+constexpr double notMeasured = std::numeric_limits<double>::quiet_NaN();
+} // namespace
+
+RoomAcoustics RoomAnalyzer::calc(const StateData& data) noexcept
+{
+    RoomAcoustics result = {};
+    if (data.fftLen < 64 || data.sampleRate <= 0.0) {
+        return result;
+    }
+    fftw_plan inversePlan = getBestFftPlan(data.fftLen, FftKind::ComplexToReal).load();
+    if (inversePlan == nullptr) {
+        return result;
+    }
+    prepare(data.fftLen, data.sampleRate);
+
+    // all bands are measured from where the direct sound arrives in the full response
+    const auto& impulseResponse = data.impulseResponse;
+    size_t peak = findAbsMax(impulseResponse);
+    double threshold = impulseResponse[peak] * impulseResponse[peak] * onsetRatio;
+    size_t onset = 0;
+    while (onset < peak && impulseResponse[onset] * impulseResponse[onset] < threshold) {
+        ++onset;
+    }
+
+    for (size_t band = 0; band < octaveBands.size(); ++band) {
+        std::fill(bandSpectrum.begin(), bandSpectrum.end(), Complex(0.0, 0.0));
+        const auto& bandWeights = weights[band];
+        for (size_t i = 0; i < bandWeights.size(); ++i) {
+            bandSpectrum[firstBin[band] + i] = data.transferFunction[firstBin[band] + i] * bandWeights[i];
+        }
+        // not normalized like the impulse response is. everything that comes out of it is a ratio, so that does not matter.
+        // NOLINTNEXTLINE
+        fftw_execute_dft_c2r(inversePlan, reinterpret_cast<fftw_complex*>(bandSpectrum.data()), bandResponse.data());
+        result.bands[band] = analyzeBand(bandResponse.data(), onset);
+    }
+    result.bands[octaveBands.size()] = analyzeBand(impulseResponse.data(), onset);
+    result.valid = true;
+
+    return result;
+}
+
+void RoomAnalyzer::prepare(size_t fftLen, double sampleRate) noexcept
+{
+    if (fftLen == preparedLength && std::abs(sampleRate - preparedRate) < 0.5) {
+        return;
+    }
+    preparedLength = fftLen;
+    preparedRate = sampleRate;
+    bandSpectrum.resize(fftLen / 2 + 1);
+    bandResponse.resize(fftLen);
+    energy.resize(fftLen + 1);
+
+    // zero phase octave band filters, magnitude like a butterworth band pass. -3dB at the band edges.
+    // only the bins that are not all but zero are kept, so applying a band is as cheap as it is narrow.
+    const double quality = 1.0 / (std::sqrt(2.0) - 1.0 / std::sqrt(2.0));
+    auto binWidth = sampleRate / static_cast<double>(fftLen);
+    for (size_t band = 0; band < octaveBands.size(); ++band) {
+        double center = octaveBands[band];
+        weights[band].clear();
+        firstBin[band] = 0;
+        for (size_t bin = 1; bin <= fftLen / 2; ++bin) {
+            double frequency = static_cast<double>(bin) * binWidth;
+            double detune = quality * (frequency / center - center / frequency);
+            double weight = 1.0 / std::sqrt(1.0 + std::pow(detune * detune, filterOrder));
+            if (weight < weightFloor) {
+                if (!weights[band].empty()) {
+                    break;
+                }
+                continue;
+            }
+            if (weights[band].empty()) {
+                firstBin[band] = bin;
+            }
+            weights[band].push_back(weight);
+        }
+    }
+}
+
+BandAcoustics RoomAnalyzer::analyzeBand(const double* impulseResponse, size_t onset) noexcept
+{
+    BandAcoustics result = { notMeasured, notMeasured, notMeasured, notMeasured, notMeasured, notMeasured };
+
+    // energy[i] is everything before sample i after the onset, so the energy of a range is a difference
+    size_t count = preparedLength - onset;
+    energy[0] = 0.0;
+    prefixSumSquares(energy.data() + 1, impulseResponse + onset, count); // NOLINT
+    auto rangeEnergy = [this](size_t first, size_t last) {
+        return energy[last] - energy[first];
+    };
+
+    // the noise is taken from the end. the very end is left out, the band filters ring in front of the onset, which wraps around to there.
+    // the decay is cut off where it goes into the noise, and the noise is taken out of the rest.
+    size_t tail = std::max<size_t>(count / 10, 1);
+    size_t tailEnd = count - count / 20;
+    size_t tailStart = tailEnd - std::min(tail, tailEnd);
+    double noise = rangeEnergy(tailStart, tailEnd) / static_cast<double>(std::max<size_t>(tailEnd - tailStart, 1));
+    size_t window = std::clamp<size_t>(static_cast<size_t>(noiseWindow * preparedRate), 2, std::max<size_t>(tailStart / 4, 2));
+    size_t limit = tailStart;
+    for (size_t i = 0; i + window <= tailStart; i += window / 2) {
+        if (rangeEnergy(i, i + window) < 2.0 * noise * static_cast<double>(window)) {
+            limit = i + window / 2;
+            break;
+        }
+    }
+    // schroeder backward integration, what is left from n on
+    auto remaining = [&rangeEnergy, limit, noise](size_t n) {
+        return rangeEnergy(n, limit) - noise * static_cast<double>(limit - n);
+    };
+    double total = remaining(0);
+    if (limit < 2 || total <= 0.0) {
+        return result;
+    }
+
+    // fits a line to the decay between two levels, and extends it to -60dB
+    auto decayTime = [&remaining, total, limit, this](double topDb, double bottomDb) {
+        double top = total * std::pow(10.0, topDb / 10.0);
+        double bottom = total * std::pow(10.0, bottomDb / 10.0);
+        size_t first = 0;
+        while (first < limit && remaining(first) > top) {
+            ++first;
+        }
+        size_t last = first;
+        while (last < limit && remaining(last) > bottom) {
+            ++last;
+        }
+        // did not get down far enough before the noise
+        if (last >= limit || last - first < 2) {
+            return notMeasured;
+        }
+
+        size_t stride = std::max<size_t>((last - first) / maxRegressionPoints, 1);
+        double sumX = 0.0;
+        double sumY = 0.0;
+        double sumXX = 0.0;
+        double sumXY = 0.0;
+        double points = 0.0;
+        for (size_t n = first; n <= last; n += stride) {
+            auto x = static_cast<double>(n - first);
+            double y = 10.0 * std::log10(std::max(remaining(n), 1e-300) / total);
+            sumX += x;
+            sumY += y;
+            sumXX += x * x;
+            sumXY += x * y;
+            points += 1.0;
+        }
+        double slope = (points * sumXY - sumX * sumY) / (points * sumXX - sumX * sumX);
+        return slope < 0.0 ? -60.0 / (slope * preparedRate) : notMeasured;
+    };
+    result.edt = decayTime(0.0, -10.0);
+    result.t20 = decayTime(-5.0, -25.0);
+    result.t30 = decayTime(-5.0, -35.0);
+
+    auto early50 = std::min(static_cast<size_t>(0.05 * preparedRate), limit);
+    auto early80 = std::min(static_cast<size_t>(0.08 * preparedRate), limit);
+    if (rangeEnergy(early50, limit) > 0.0) {
+        result.c50 = 10.0 * std::log10(rangeEnergy(0, early50) / rangeEnergy(early50, limit));
+    }
+    if (rangeEnergy(early80, limit) > 0.0) {
+        result.c80 = 10.0 * std::log10(rangeEnergy(0, early80) / rangeEnergy(early80, limit));
+    }
+    result.d50 = rangeEnergy(0, early50) / rangeEnergy(0, limit);
+
+    return result;
+}
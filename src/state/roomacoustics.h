@@ -0,0 +1,111 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_roomacoustics_h
+#define laa_roomacoustics_h
+
+#include "dsp/fft.h"
+
+#include <array>
+
+/// center frequencies of the octave bands, in Hz
+constexpr std::array<double, 8> octaveBands = { 63.0, 125.0, 250.0, 500.0, 1000.0, 2000.0, 4000.0, 8000.0 };
+
+/**
+ * \brief Room acoustics parameters of one band, after ISO 3382
+ *
+ * Values that could not be measured, because the decay does not go down far enough above the noise for example, are NaN.
+ */
+struct BandAcoustics {
+    /// early decay time, from 0 to -10dB, in seconds
+    double edt = 0.0;
+    /// reverberation time, from -5 to -25dB, in seconds
+    double t20 = 0.0;
+    /// reverberation time, from -5 to -35dB, in seconds
+    double t30 = 0.0;
+    /// clarity, the first 50ms against the rest, in dB
+    double c50 = 0.0;
+    /// clarity, the first 80ms against the rest, in dB
+    double c80 = 0.0;
+    /// definition, the share of the energy in the first 50ms, 0 to 1
+    double d50 = 0.0;
+};
+
+/**
+ * \brief Room acoustics parameters of an impulse response
+ */
+struct RoomAcoustics {
+    /// the octave bands, then the whole impulse response
+    static constexpr size_t bandCount = octaveBands.size() + 1;
+    /// per band, see octaveBands. the last one is not filtered.
+    std::array<BandAcoustics, bandCount> bands = {};
+    /// false until calculated
+    bool valid = false;
+};
+
+struct StateData;
+
+/**
+ * \brief Works out RoomAcoustics
+ *
+ * The bands are filtered in the frequency domain: the transfer function is weighted with the magnitude of an octave band filter
+ * and transformed back, so each band costs one inverse dft and no filter has to run over the impulse response.
+ * The decay curves come from running sums of the energy, which also give the energy ratios for free.
+ * Keeps scratch space and the filter weights for the last length, so use one per thread.
+ */
+class RoomAnalyzer {
+public:
+    /**
+     * \brief Work out the parameters of a state
+     * \param data the state. needs its transfer function and impulse response.
+     * \return the parameters. not valid if the state has no data.
+     */
+    RoomAcoustics calc(const StateData& data) noexcept;
+
+private:
+    /**
+     * \brief Work out the filter weights for a length
+     * \param fftLen number of samples
+     * \param sampleRate sample rate
+     */
+    void prepare(size_t fftLen, double sampleRate) noexcept;
+
+    /**
+     * \brief Parameters of one band impulse response
+     * \param impulseResponse the band, fftLen samples
+     * \param onset where the direct sound arrives
+     * \return the parameters
+     */
+    BandAcoustics analyzeBand(const double* impulseResponse, size_t onset) noexcept;
+
+    /// length the weights are for
+    size_t preparedLength = 0;
+    /// sample rate the weights are for
+    double preparedRate = 0.0;
+    /// first bin each band has weights for
+    std::array<size_t, octaveBands.size()> firstBin = {};
+    /// weights of each band, starting at firstBin
+    std::array<RealVec, octaveBands.size()> weights = {};
+    /// the weighted transfer function
+    ComplexVec bandSpectrum = {};
+    /// impulse response of a band
+    RealVec bandResponse = {};
+    /// running sum of the energy of a band, from the onset on
+    RealVec energy = {};
+};
+
+#endif //laa_roomacoustics_h
@@ -0,0 +1,322 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshotfile.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+/// first bytes of every snapshot file
+constexpr std::array<char, 8> magic = { 'L', 'A', 'A', 'S', 'N', 'A', 'P', 'S' };
+/// size of the header: magic, version, doubles per sample, count
+constexpr size_t headerSize = 64;
+/// size of one index entry: fftLen, block offset, name offset, name length, fftDuration, sampleRate, color, flags
+constexpr size_t entrySize = 64;
+/// blocks start on this. a page, so the mapped blocks are as aligned as fftw_malloc would make them
+constexpr size_t blockAlignment = 4096;
+/// flag for StateData::discontinuous
+constexpr uint32_t discontinuousFlag = 1;
+/// flag for StateData::reducedLoad
+constexpr uint32_t reducedLoadFlag = 2;
+
+// little endian, like everything we run on
+template <class T>
+void putLe(unsigned char* out, T value) noexcept
+{
+    std::memcpy(out, &value, sizeof(T));
+}
+
+template <class T>
+T readLe(const unsigned char* data) noexcept
+{
+    T value = {};
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+size_t alignUp(size_t offset) noexcept
+{
+    return (offset + blockAlignment - 1) / blockAlignment * blockAlignment;
+}
+
+/**
+ * \brief A file mapped copy on write. Shared by all the states pointing into it.
+ */
+class Mapping {
+public:
+    /// ctor
+    Mapping() noexcept = default;
+    /// dtor. unmaps the file
+    ~Mapping() noexcept
+    {
+        if (data == nullptr) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(data, size);
+#endif
+    }
+    /// deleted
+    Mapping(const Mapping&) = delete;
+    /// deleted
+    Mapping(Mapping&&) = delete;
+    /// deleted
+    Mapping& operator=(const Mapping&) = delete;
+    /// deleted
+    Mapping& operator=(Mapping&&) = delete;
+
+    /**
+     * \brief Map a file
+     * \param path path to the file
+     * \param error set on failure
+     * \return true on success
+     */
+    bool map(const std::string& path, std::string& error) noexcept
+    {
+        // copy on write: StateData hands out writable pointers, nothing writes through them, but if it did it must not end up in the file
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            error = "Could not open " + path;
+            return false;
+        }
+        LARGE_INTEGER fileSize = {};
+        GetFileSizeEx(file, &fileSize);
+        size = static_cast<size_t>(fileSize.QuadPart);
+        HANDLE mapObject = size > 0 ? CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr) : nullptr;
+        if (mapObject != nullptr) {
+            data = static_cast<unsigned char*>(MapViewOfFile(mapObject, FILE_MAP_COPY, 0, 0, 0));
+            // the view keeps the file alive
+            CloseHandle(mapObject);
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY); // NOLINT
+        if (fd < 0) {
+            error = "Could not open " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat info = {};
+        fstat(fd, &info);
+        size = static_cast<size_t>(info.st_size);
+        if (size > 0) {
+            void* result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (result != MAP_FAILED) { // NOLINT
+                data = static_cast<unsigned char*>(result);
+                // captures are looked at one by one, reading ahead would pull in ones nobody shows
+                madvise(result, size, MADV_RANDOM);
+            }
+        }
+        // the mapping keeps the file alive
+        ::close(fd);
+#endif
+
+        if (data == nullptr) {
+            size = 0;
+            error = "Could not map " + path;
+            return false;
+        }
+        return true;
+    }
+
+    /// the whole file
+    unsigned char* data = nullptr;
+    /// size of the file in bytes
+    size_t size = 0;
+};
+
+/**
+ * \brief A state pointing into a mapping, keeping it alive
+ */
+struct MappedState {
+    /// declared first, so it goes last
+    std::shared_ptr<Mapping> mapping = nullptr;
+    /// points into mapping
+    StateData data = {};
+};
+} // namespace
+
+bool SnapshotFile::save(const std::string& path, const std::vector<Snapshot>& toSave) noexcept
+{
+    std::vector<const Snapshot*> valid = {};
+    for (const auto& snapshot : toSave) {
+        if (snapshot.data != nullptr && snapshot.data->getBlock() != nullptr) {
+            valid.push_back(&snapshot);
+        }
+    }
+
+    // header, index and names go in one piece, the blocks follow page aligned
+    size_t namesOffset = headerSize + valid.size() * entrySize;
+    size_t blockOffset = namesOffset;
+    for (const auto* snapshot : valid) {
+        blockOffset += snapshot->name.size();
+    }
+    blockOffset = alignUp(blockOffset);
+
+    std::vector<unsigned char> head(blockOffset, 0);
+    std::memcpy(head.data(), magic.data(), magic.size());
+    putLe<uint32_t>(&head[8], version);
+    putLe<uint32_t>(&head[12], static_cast<uint32_t>(StateData::getBlockSize(1)));
+    putLe<uint64_t>(&head[16], valid.size());
+
+    size_t nameOffset = namesOffset;
+    for (size_t i = 0; i < valid.size(); ++i) {
+        const auto& snapshot = *valid[i];
+        const auto& data = *snapshot.data;
+        unsigned char* entry = &head[headerSize + i * entrySize];
+        putLe<uint64_t>(entry, data.fftLen);
+        putLe<uint64_t>(entry + 8, blockOffset); // NOLINT
+        putLe<uint64_t>(entry + 16, nameOffset); // NOLINT
+        putLe<uint64_t>(entry + 24, snapshot.name.size()); // NOLINT
+        putLe<double>(entry + 32, data.fftDuration); // NOLINT
+        putLe<double>(entry + 40, data.sampleRate); // NOLINT
+        putLe<uint32_t>(entry + 48, snapshot.color); // NOLINT
+        putLe<uint32_t>(entry + 52, (data.discontinuous ? discontinuousFlag : 0U) | (data.reducedLoad ? reducedLoadFlag : 0U)); // NOLINT
+        std::memcpy(&head[nameOffset], snapshot.name.data(), snapshot.name.size());
+        nameOffset += snapshot.name.size();
+        blockOffset = alignUp(blockOffset + StateData::getBlockSize(data.fftLen) * sizeof(double));
+    }
+
+    // into a temporary first, a crash while writing should not cost the old file
+    std::string tmpPath = path + ".tmp";
+    std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (file == nullptr) {
+        error = "Could not open " + tmpPath;
+        return false;
+    }
+
+    bool ok = std::fwrite(head.data(), 1, head.size(), file) == head.size();
+    std::array<unsigned char, blockAlignment> padding = {};
+    for (const auto* snapshot : valid) {
+        if (!ok) {
+            break;
+        }
+        size_t bytes = StateData::getBlockSize(snapshot->data->fftLen) * sizeof(double);
+        ok = std::fwrite(snapshot->data->getBlock(), 1, bytes, file) == bytes;
+        size_t pad = alignUp(bytes) - bytes;
+        ok = ok && std::fwrite(padding.data(), 1, pad, file) == pad;
+    }
+    ok = std::fclose(file) == 0 && ok;
+
+    if (!ok) {
+        std::remove(tmpPath.c_str());
+        error = "Could not write " + tmpPath;
+        return false;
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        error = "Could not replace " + path;
+        return false;
+    }
+
+    error.clear();
+    return true;
+}
+
+bool SnapshotFile::load(const std::string& path) noexcept
+{
+    snapshots.clear();
+
+    auto mapping = std::make_shared<Mapping>();
+    if (!mapping->map(path, error)) {
+        return false;
+    }
+
+    const unsigned char* data = mapping->data;
+    size_t size = mapping->size;
+    if (size < headerSize || std::memcmp(data, magic.data(), magic.size()) != 0) {
+        error = path + " is not a snapshot file";
+        return false;
+    }
+    if (readLe<uint32_t>(data + 8) != version || readLe<uint32_t>(data + 12) != StateData::getBlockSize(1)) { // NOLINT
+        error = path + " was written by a different version of laa";
+        return false;
+    }
+    auto count = readLe<uint64_t>(data + 16); // NOLINT
+    if (count > (size - headerSize) / entrySize) {
+        error = path + " is truncated";
+        return false;
+    }
+
+    // only the index is read here. the blocks are not touched until something draws them.
+    std::vector<Snapshot> loaded = {};
+    loaded.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* entry = data + headerSize + i * entrySize; // NOLINT
+        auto fftLen = readLe<uint64_t>(entry);
+        auto blockOffset = readLe<uint64_t>(entry + 8); // NOLINT
+        auto nameOffset = readLe<uint64_t>(entry + 16); // NOLINT
+        auto nameLength = readLe<uint64_t>(entry + 24); // NOLINT
+        // the length goes first, a huge one would wrap the block size around
+        if (fftLen < LAA_MIN_FFT_LENGTH || fftLen > LAA_MAX_FFT_LENGTH || (fftLen & (fftLen - 1)) != 0) {
+            error = path + " is damaged";
+            return false;
+        }
+        size_t blockBytes = StateData::getBlockSize(fftLen) * sizeof(double);
+        if (blockOffset % blockAlignment != 0 || blockOffset > size || blockBytes > size - blockOffset || nameOffset > size || nameLength > size - nameOffset) {
+            error = path + " is damaged";
+            return false;
+        }
+
+        auto state = std::make_shared<MappedState>();
+        state->mapping = mapping;
+        // the mapping is page aligned and so is the offset. NOLINTNEXTLINE
+        state->data = StateData(fftLen, reinterpret_cast<double*>(mapping->data + blockOffset));
+        state->data.fftDuration = readLe<double>(entry + 32); // NOLINT
+        state->data.sampleRate = readLe<double>(entry + 40); // NOLINT
+        state->data.discontinuous = (readLe<uint32_t>(entry + 52) & discontinuousFlag) != 0; // NOLINT
+        state->data.reducedLoad = (readLe<uint32_t>(entry + 52) & reducedLoadFlag) != 0; // NOLINT
+
+        Snapshot snapshot;
+        snapshot.data = std::shared_ptr<const StateData>(state, &state->data);
+        // NOLINTNEXTLINE
+        snapshot.name.assign(reinterpret_cast<const char*>(data + nameOffset), nameLength);
+        snapshot.color = readLe<uint32_t>(entry + 48); // NOLINT
+        loaded.push_back(std::move(snapshot));
+    }
+
+    snapshots = std::move(loaded);
+    error.clear();
+    return true;
+}
+
+const std::vector<Snapshot>& SnapshotFile::getSnapshots() const noexcept
+{
+    return snapshots;
+}
+
+const std::string& SnapshotFile::getError() const noexcept
+{
+    return error;
+}
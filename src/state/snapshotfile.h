@@ -0,0 +1,88 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_snapshotfile_h
+#define laa_snapshotfile_h
+
+#include "statedata.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * \brief A capture, as it goes into and comes out of a snapshot file
+ */
+struct Snapshot {
+    /// the data
+    std::shared_ptr<const StateData> data = nullptr;
+    /// name of the capture
+    std::string name = "";
+    /// color to draw it in, packed like IM_COL32
+    uint32_t color = 0xFFFFFFFF; // NOLINT white
+};
+
+/**
+ * \brief Saves captures to disk and maps them back in
+ *
+ * The file is a small header, an index with one entry per capture, the names and then the StateData blocks as they are in memory.
+ * Every block starts on a page boundary, so loading does not parse or copy anything: the file is mapped and the states point into the mapping.
+ * Only the header and the index are read on load, the kernel pages a capture in the first time it is drawn.
+ * Mapped captures keep the mapping alive, so they stay valid after the SnapshotFile is gone.
+ *
+ * Everything is stored little endian and as doubles, like in memory on everything we run on.
+ */
+class SnapshotFile {
+public:
+    /// bumped whenever the header, the index or the StateData layout changes
+    static constexpr uint32_t version = 1;
+
+    /**
+     * \brief Write captures to a file. Replaces the file only once everything is written.
+     * \param path where to
+     * \param snapshots what to write. entries without data are skipped.
+     * \return true on success. On failure, see getError().
+     */
+    bool save(const std::string& path, const std::vector<Snapshot>& snapshots) noexcept;
+
+    /**
+     * \brief Map a file written by save()
+     * \param path where from
+     * \return true on success. On failure, see getError().
+     */
+    bool load(const std::string& path) noexcept;
+
+    /**
+     * \brief What load() found
+     * \return the captures. Their data points into the file.
+     */
+    [[nodiscard]] const std::vector<Snapshot>& getSnapshots() const noexcept;
+
+    /**
+     * \brief What went wrong on the last save or load
+     * \return error message
+     */
+    [[nodiscard]] const std::string& getError() const noexcept;
+
+private:
+    /// the last load
+    std::vector<Snapshot> snapshots = {};
+    /// last error
+    std::string error = {};
+};
+
+#endif //laa_snapshotfile_h
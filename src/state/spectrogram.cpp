@@ -0,0 +1,132 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spectrogram.h"
+#include "dsp/fft.h"
+
+#include <algorithm>
+#include <cmath>
+
+Spectrogram::Spectrogram(size_t rowCount, size_t columnCount) noexcept
+    : rows(std::max<size_t>(rowCount, 1))
+    , columns(std::max<size_t>(columnCount, 1))
+    , ring(rows * columns, floorDb)
+    , firstBin(columns, 0)
+    , lastBin(columns, 0)
+{
+}
+
+void Spectrogram::add(const StateData& data) noexcept
+{
+    if (data.fftLen == 0 || data.sampleRate <= 0.0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    // fftLen is exact, the sample rate is set from an int
+    if (data.fftLen != mappedLength || std::abs(data.sampleRate - mappedRate) > 0.5) {
+        std::fill(ring.begin(), ring.end(), floorDb);
+        written = 0;
+        ++generation;
+        map(data.fftLen, data.sampleRate);
+    }
+
+    // the loudest bin of a column stands for it, so narrow peaks do not disappear in the wide columns up top
+    auto row = ring.begin() + static_cast<std::ptrdiff_t>((written % rows) * columns);
+    for (size_t column = 0; column < columns; ++column) {
+        double peak = 0.0;
+        for (size_t bin = firstBin[column]; bin < lastBin[column]; ++bin) {
+            peak = std::max(peak, magSquared(data.fftInput[bin]));
+        }
+        // both halves of the spectrum, like the level trigger
+        row[static_cast<std::ptrdiff_t>(column)] = static_cast<float>(std::max(10.0 * std::log10(std::max(2.0 * peak, 1e-20)), static_cast<double>(floorDb)));
+    }
+    ++written;
+}
+
+void Spectrogram::clear() noexcept
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::fill(ring.begin(), ring.end(), floorDb);
+    written = 0;
+    ++generation;
+}
+
+size_t Spectrogram::read(size_t since, std::vector<float>& out) const noexcept
+{
+    out.clear();
+    std::lock_guard<std::mutex> guard(lock);
+    // since is from before a clear, start over
+    if (since > written) {
+        since = 0;
+    }
+    size_t first = std::max(since, written > rows ? written - rows : 0);
+    out.resize((written - first) * columns);
+    auto target = out.begin();
+    for (size_t row = first; row < written; ++row) {
+        auto source = ring.begin() + static_cast<std::ptrdiff_t>((row % rows) * columns);
+        target = std::copy(source, source + static_cast<std::ptrdiff_t>(columns), target);
+    }
+
+    return written;
+}
+
+size_t Spectrogram::getGeneration() const noexcept
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return generation;
+}
+
+double Spectrogram::getMaxFrequency() const noexcept
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return mappedRate / 2.0;
+}
+
+size_t Spectrogram::getRows() const noexcept
+{
+    return rows;
+}
+
+size_t Spectrogram::getColumns() const noexcept
+{
+    return columns;
+}
+
+double Spectrogram::getColumnFrequency(double column, double maxFrequency) const noexcept
+{
+    if (maxFrequency <= minFrequency) {
+        return minFrequency;
+    }
+    return minFrequency * std::pow(maxFrequency / minFrequency, column / static_cast<double>(columns));
+}
+
+void Spectrogram::map(size_t fftLen, double sampleRate) noexcept
+{
+    mappedLength = fftLen;
+    mappedRate = sampleRate;
+
+    // the columns are log spaced, so down low one bin covers many columns. they all show that bin.
+    auto binWidth = sampleRate / static_cast<double>(fftLen);
+    size_t nyquist = fftLen / 2;
+    for (size_t column = 0; column < columns; ++column) {
+        auto low = getColumnFrequency(static_cast<double>(column), sampleRate / 2.0);
+        auto high = getColumnFrequency(static_cast<double>(column + 1), sampleRate / 2.0);
+        firstBin[column] = std::min(static_cast<size_t>(std::round(low / binWidth)), nyquist);
+        lastBin[column] = std::clamp(static_cast<size_t>(std::round(high / binWidth)), firstBin[column] + 1, nyquist + 1);
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_spectrogram_h
+#define laa_spectrogram_h
+
+#include "statedata.h"
+
+#include <mutex>
+#include <vector>
+
+/**
+ * \brief History of spectra, for looking at how they change over time
+ *
+ * A fixed number of rows, one per frame, in a ring. Every row is the magnitude of the input in dB,
+ * squashed down to a fixed number of log spaced columns, so the memory and the cost of adding a row
+ * do not depend on the analysis length.
+ * The processing adds rows, readers copy out what they did not see yet. Both may run on different threads.
+ */
+class Spectrogram {
+public:
+    /// rows kept by default. a power of two, so it can go into a texture as it is.
+    static constexpr size_t defaultRows = 2048;
+    /// columns by default. a power of two for the same reason.
+    static constexpr size_t defaultColumns = 512;
+    /// the first column starts here, in Hz. the last one ends at the nyquist frequency.
+    static constexpr double minFrequency = 20.0;
+    /// rows start out at this, in dB
+    static constexpr float floorDb = -200.0F;
+
+    /**
+     * \brief ctor. allocates all rows.
+     * \param rowCount number of rows in the ring
+     * \param columnCount number of columns per row
+     */
+    explicit Spectrogram(size_t rowCount = defaultRows, size_t columnCount = defaultColumns) noexcept;
+
+    /**
+     * \brief Add the spectrum of a frame as the newest row
+     * \param data a processed state
+     *
+     * If the length or the sample rate differ from the last row, the old rows do not line up anymore and are dropped.
+     */
+    void add(const StateData& data) noexcept;
+
+    /**
+     * \brief Drop all rows
+     */
+    void clear() noexcept;
+
+    /**
+     * \brief Copy out the rows added since a reader last looked
+     * \param since rows written when the reader last looked. 0 for everything that is around.
+     * \param out gets the rows, oldest first, getColumns() values each. cleared first.
+     * \return rows written so far. pass it as since next time.
+     *
+     * If the reader fell more than getRows() behind, only the last getRows() rows are copied.
+     * The row numbered n sits at n % getRows() in the ring, so the first row copied is the return value minus out.size() / getColumns().
+     */
+    size_t read(size_t since, std::vector<float>& out) const noexcept;
+
+    /**
+     * \brief Counts up every time the rows are dropped
+     * \return generation. if it changed, readers have to start over with since = 0.
+     */
+    [[nodiscard]] size_t getGeneration() const noexcept;
+
+    /**
+     * \brief Upper edge of the last column
+     * \return frequency in Hz. 0 if there are no rows yet.
+     */
+    [[nodiscard]] double getMaxFrequency() const noexcept;
+
+    /**
+     * \brief Number of rows in the ring
+     * \return row count
+     */
+    [[nodiscard]] size_t getRows() const noexcept;
+
+    /**
+     * \brief Number of columns in a row
+     * \return column count
+     */
+    [[nodiscard]] size_t getColumns() const noexcept;
+
+    /**
+     * \brief Lower edge of a column
+     * \param column column, getColumns() for the upper edge of the last one
+     * \param maxFrequency upper edge of the last column
+     * \return frequency in Hz
+     */
+    [[nodiscard]] double getColumnFrequency(double column, double maxFrequency) const noexcept;
+
+private:
+    /**
+     * \brief Work out which bins go into which column
+     * \note Call with lock held
+     */
+    void map(size_t fftLen, double sampleRate) noexcept;
+
+    /// number of rows
+    size_t rows;
+    /// number of columns
+    size_t columns;
+    /// the rows, one after the other
+    std::vector<float> ring;
+    /// first bin of every column
+    std::vector<size_t> firstBin;
+    /// one past the last bin of every column
+    std::vector<size_t> lastBin;
+    /// length the bins are mapped for
+    size_t mappedLength = 0;
+    /// sample rate the bins are mapped for
+    double mappedRate = 0.0;
+    /// rows added since the last clear
+    size_t written = 0;
+    /// counts clears
+    size_t generation = 0;
+    /// protects everything
+    mutable std::mutex lock = {};
+};
+
+#endif //laa_spectrogram_h
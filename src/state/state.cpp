@@ -16,72 +16,94 @@
  */
 
 #include "state.h"
+#include "dsp/fftplan.h"
 #include "dsp/smoothing.h"
 #include "dsp/windows.h"
 
 State::State(size_t fftLen) noexcept
 {
-    data.uniqueCol = ImGui::GetColorU32(ImGuiCol_Text);
-    data.fftLen = std::min(LAA_MAX_FFT_LENGTH, std::max(LAA_MIN_FFT_LENGTH, fftLen));
-    data.input.resize(data.fftLen);
-    data.reference.resize(data.fftLen);
-    data.windowedInput.resize(data.fftLen);
-    data.windowedReference.resize(data.fftLen);
-    data.fftInput.resize(data.fftLen);
-    data.fftReference.resize(data.fftLen);
-    data.avgMag.resize(data.fftLen);
-    data.smoothedAvgMag.resize(data.fftLen);
-    data.transferFunction.resize(data.fftLen);
-    data.smoothedTransferFunction.resize(data.fftLen);
-    data.impulseResponse.resize(data.fftLen);
-    data.smoothedImpulseResponse.resize(data.fftLen);
-    data.psdEstimateInput.resize(data.fftLen);
-    data.psdEstimateReference.resize(data.fftLen);
-    data.csdEstimate.resize(data.fftLen);
-    data.coherence.resize(data.fftLen);
-    data.smoothedCoherence.resize(data.fftLen);
-
-    fftInputPlan = fftw_plan_dft_r2c_1d(static_cast<int>(data.fftLen), reinterpret_cast<double*>(data.windowedInput.data()), reinterpret_cast<fftw_complex*>(data.fftInput.data()), FFTW_MEASURE);
-    fftReferencePlan = fftw_plan_dft_r2c_1d(static_cast<int>(data.fftLen), reinterpret_cast<double*>(data.windowedReference.data()), reinterpret_cast<fftw_complex*>(data.fftReference.data()), FFTW_MEASURE);
-    impulseResponsePlan = fftw_plan_dft_c2r_1d(static_cast<int>(data.fftLen), reinterpret_cast<fftw_complex*>(data.transferFunction.data()), reinterpret_cast<double*>(data.impulseResponse.data()), FFTW_MEASURE | FFTW_PRESERVE_INPUT);
+    // one block for everything
+    data = StateData(std::min(LAA_MAX_FFT_LENGTH, std::max(LAA_MIN_FFT_LENGTH, fftLen)));
+
+    // the plans are shared with every other state of this length, we execute them on our own buffers.
+    // they start out estimated and get better in the background, see calc().
+    forwardSlot = &getBestFftPlan(data.fftLen, FftKind::RealToComplex);
+    inverseSlot = &getBestFftPlan(data.fftLen, FftKind::ComplexToReal);
 }
 
-State::~State() noexcept
+State::~State() noexcept = default;
+
+void State::plan(size_t fftLen) noexcept
 {
-    fftw_destroy_plan(impulseResponsePlan);
-    fftw_destroy_plan(fftReferencePlan);
-    fftw_destroy_plan(fftInputPlan);
+    fftLen = std::min(LAA_MAX_FFT_LENGTH, std::max(LAA_MIN_FFT_LENGTH, fftLen));
+    queueFftPlan(fftLen, FftKind::RealToComplex);
+    queueFftPlan(fftLen, FftKind::ComplexToReal);
 }
 
-void State::calc(StateFilterConfig& filterConfig) noexcept
+// applies the window selected in filterConfig
+static void applyWindow(RealSpan& out, const RealSpan& in, StateWindowFilter filter) noexcept
 {
-    // copy input into windows
-    switch (filterConfig.windowFilter) {
-
+    switch (filter) {
     case StateWindowFilter::None:
-        noWindow(data.windowedInput, data.input);
-        noWindow(data.windowedReference, data.reference);
+        noWindow(out, in);
         break;
     case StateWindowFilter::Hamming:
-        hamming(data.windowedInput, data.input);
-        hamming(data.windowedReference, data.reference);
+        hamming(out, in);
         break;
     case StateWindowFilter::Blackman:
-        blackman(data.windowedInput, data.input);
-        blackman(data.windowedReference, data.reference);
+        blackman(out, in);
         break;
     }
+}
+
+void State::calc(StateFilterConfig& filterConfig) noexcept
+{
+    // pick up better plans, if the planner got to them. only here, so a frame is done with one set of plans.
+    forwardPlan = forwardSlot->load();
+    inversePlan = inverseSlot->load();
+
+    // copy input into windows
+    applyWindow(data.windowedInput, data.input, filterConfig.windowFilter);
+    applyWindow(data.windowedReference, data.reference, filterConfig.windowFilter);
 
     // run fft for input and reference
-    fftw_execute(fftInputPlan);
-    fftw_execute(fftReferencePlan);
+    executeForward(data.windowedInput, data.fftInput);
+    executeForward(data.windowedReference, data.fftReference);
+
+    // normalize the reference here, the input is done in calcFromDft
+    auto dFftLen = static_cast<double>(data.fftLen);
+    for (auto& value : data.fftReference) {
+        value /= dFftLen;
+    }
 
+    calcFromDft(filterConfig);
+}
+
+void State::calc(StateFilterConfig& filterConfig, const State& referenceState) noexcept
+{
+    forwardPlan = forwardSlot->load();
+    inversePlan = inverseSlot->load();
+
+    // only the input needs a dft, the reference is already done
+    applyWindow(data.windowedInput, data.input, filterConfig.windowFilter);
+    executeForward(data.windowedInput, data.fftInput);
+
+    // copy it over, so this state is complete on its own
+    const auto& referenceData = referenceState.data;
+    std::copy(referenceData.reference.begin(), referenceData.reference.end(), data.reference.begin());
+    std::copy(referenceData.windowedReference.begin(), referenceData.windowedReference.end(), data.windowedReference.begin());
+    std::copy(referenceData.fftReference.begin(), referenceData.fftReference.end(), data.fftReference.begin());
+
+    calcFromDft(filterConfig);
+}
+
+void State::calcFromDft(StateFilterConfig& filterConfig) noexcept
+{
     // make things we can derive from the fft
     auto dFftLen = static_cast<double>(data.fftLen);
     for (size_t i = 0; i < data.fftLen; i++) {
         // normalize first
         data.fftInput[i] /= dFftLen;
-        data.fftReference[i] /= dFftLen;
         // magnitude into avgMag
         data.avgMag[i] = mag(data.fftInput[i]);
         // transfer function:  XxH = Y => H = Y/X
@@ -91,23 +113,47 @@ void State::calc(StateFilterConfig& filterConfig) noexcept
     // divide our range into segments
     // estimate psd and csd over these segments
     // then estimate the squared coherence at a point.
+    // this is by far the most expensive part. when we are short on time the segment is slid along instead of summed up for every bin,
+    // and only summed up from scratch every psdDepth bins, so the rounding errors do not pile up.
+    data.reducedLoad = filterConfig.skipOptionalStages;
     size_t psdDepth = std::clamp(data.fftLen / 1024ull, 64ull, 512ull);
+    double psdReference = 0.0;
+    double psdInput = 0.0;
+    Complex csd = 0.0;
     for (size_t i = 0; i < data.fftLen; i++) {
         size_t start = i < psdDepth ? 0 : i - psdDepth;
         size_t end = std::min(data.fftLen, i + psdDepth);
-        data.psdEstimateInput[i] = 0.0;
-        data.psdEstimateReference[i] = 0.0;
-        data.csdEstimate[i] = 0.0;
-        for (size_t j = start; j < end; j++) {
-            data.psdEstimateReference[i] += magSquared(data.fftReference[j]);
-            data.psdEstimateInput[i] += magSquared(data.fftInput[j]);
-            data.csdEstimate[i] += conj(data.fftReference[j]) * data.fftInput[j];
+        if (!data.reducedLoad || i % psdDepth == 0) {
+            psdReference = 0.0;
+            psdInput = 0.0;
+            csd = 0.0;
+            for (size_t j = start; j < end; j++) {
+                psdReference += magSquared(data.fftReference[j]);
+                psdInput += magSquared(data.fftInput[j]);
+                csd += conj(data.fftReference[j]) * data.fftInput[j];
+            }
+        } else {
+            // one bin came into the segment at the end, and one left it at the start
+            if (i + psdDepth <= data.fftLen) {
+                psdReference += magSquared(data.fftReference[end - 1]);
+                psdInput += magSquared(data.fftInput[end - 1]);
+                csd += conj(data.fftReference[end - 1]) * data.fftInput[end - 1];
+            }
+            if (start > 0) {
+                psdReference -= magSquared(data.fftReference[start - 1]);
+                psdInput -= magSquared(data.fftInput[start - 1]);
+                csd -= conj(data.fftReference[start - 1]) * data.fftInput[start - 1];
+            }
         }
-        data.coherence[i] = magSquared(data.csdEstimate[i]) / (data.psdEstimateReference[i] * data.psdEstimateInput[i]);
+        data.psdEstimateReference[i] = psdReference;
+        data.psdEstimateInput[i] = psdInput;
+        data.csdEstimate[i] = csd;
+        data.coherence[i] = magSquared(csd) / (psdReference * psdInput);
     }
 
     // compute impulse response
-    fftw_execute(impulseResponsePlan);
+    // fftw only reads the transfer function, the plan is FFTW_PRESERVE_INPUT. NOLINTNEXTLINE
+    fftw_execute_dft_c2r(inversePlan, reinterpret_cast<fftw_complex*>(data.transferFunction.data()), data.impulseResponse.data());
     // normalize and mean of ir
     double meanIr = 0.0;
     double varIr = 0.0;
@@ -135,15 +181,27 @@ void State::calc(StateFilterConfig& filterConfig) noexcept
     }
 
     // filters
-    filterConfig.filter(data.avgMag, data.fftLen);
+    filterConfig.filter(data.avgMag, data.fftLen, data.discontinuous);
 
-    // smooth out things
+    // smooth out things. the states come back from a pool, so when there is no time for it the unsmoothed ones stand in.
+    if (data.reducedLoad) {
+        std::copy(data.avgMag.begin(), data.avgMag.end(), data.smoothedAvgMag.begin());
+        std::copy(data.transferFunction.begin(), data.transferFunction.end(), data.smoothedTransferFunction.begin());
+        std::copy(data.coherence.begin(), data.coherence.end(), data.smoothedCoherence.begin());
+        return;
+    }
     smooth(data.smoothedAvgMag, data.avgMag);
     smooth(data.smoothedTransferFunction, data.transferFunction);
     //smooth(data.smoothedImpulseResponse, data.impulseResponse);
     smooth(data.smoothedCoherence, data.coherence);
 }
 
+void State::executeForward(RealSpan& in, ComplexSpan& out) noexcept
+{
+    // std::complex<double> and fftw_complex are laid out the same. NOLINTNEXTLINE
+    fftw_execute_dft_r2c(forwardPlan, in.data(), reinterpret_cast<fftw_complex*>(out.data()));
+}
+
 const StateData& State::getData() noexcept
 {
     return data;
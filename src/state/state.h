@@ -18,7 +18,8 @@
 #ifndef laa_state_h
 #define laa_state_h
 
-#include "shared.h"
+#include "core.h"
+#include "dsp/fftplan.h"
 #include "statedata.h"
 #include "statefilter.h"
 
@@ -43,6 +44,14 @@ public:
     /// assignment deleted
     State& operator=(State&&) noexcept = delete;
 
+    /**
+     * \brief Plan the ffts for a length without keeping a state around
+     * \param fftLen length to plan for
+     *
+     * Only queues them with the background planner, see queueFftPlan(). Returns right away.
+     */
+    static void plan(size_t fftLen) noexcept;
+
     /**
      * \brief Calculate all the things for a state
      * \param filterConfig
@@ -52,6 +61,16 @@ public:
      */
     void calc(StateFilterConfig& filterConfig) noexcept;
 
+    /**
+     * \brief Calculate all the things for a state, but take the reference from another state
+     * \param filterConfig
+     * \param referenceState a state that already went through calc() for the same frame
+     *
+     * Used when many inputs are measured against the same reference:
+     * the reference dft is only done once, and copied over from referenceState.
+     */
+    void calc(StateFilterConfig& filterConfig, const State& referenceState) noexcept;
+
     /**
      * \brief Return rad-only data (for later copying)
      * \return const ref to data
@@ -65,14 +84,29 @@ public:
     StateData& accessData() noexcept;
 
 private:
+    /**
+     * \brief Everything after the input and reference dft are done
+     * \param filterConfig
+     */
+    void calcFromDft(StateFilterConfig& filterConfig) noexcept;
+
+    /**
+     * \brief Run the forward dft on our own buffers
+     * \param in real input, fftLen values
+     * \param out complex output, at least fftLen/2+1 bins
+     */
+    void executeForward(RealSpan& in, ComplexSpan& out) noexcept;
+
     /// Data of this state
     StateData data = {};
-    /// the fftw plan to calc the dft of the input
-    fftw_plan fftInputPlan = {};
-    /// the fftw plan to calc the dft of the reference
-    fftw_plan fftReferencePlan = {};
-    /// the fftw plan to calc the idft of the transfer function
-    fftw_plan impulseResponsePlan = {};
+    /// the best plan for the dfts of input and reference so far. shared, see getBestFftPlan()
+    const std::atomic<fftw_plan>* forwardSlot = nullptr;
+    /// the best plan for the idft of the transfer function so far. shared, see getBestFftPlan()
+    const std::atomic<fftw_plan>* inverseSlot = nullptr;
+    /// forward plan for the current frame
+    fftw_plan forwardPlan = {};
+    /// inverse plan for the current frame
+    fftw_plan inversePlan = {};
 };
 
 #endif //laa_state_h
@@ -0,0 +1,247 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "statedata.h"
+
+#include <algorithm>
+
+namespace {
+/// real products per state
+constexpr size_t realProducts = 12;
+/// complex products per state
+constexpr size_t complexProducts = 5;
+} // namespace
+
+StateData::StateData(size_t length) noexcept
+    : fftLen(length)
+{
+    allocate();
+}
+
+StateData::StateData(size_t length, double* block) noexcept
+    : fftLen(length)
+    , arena(block)
+    , arenaSize(getBlockSize(length))
+    , ownsArena(false)
+{
+    if (arena == nullptr) {
+        release();
+        return;
+    }
+    layout();
+}
+
+StateData::StateData(const StateData& other) noexcept
+    : fftLen(other.fftLen)
+{
+    allocate();
+    std::copy_n(other.arena, std::min(arenaSize, other.arenaSize), arena);
+    copyScalars(other);
+}
+
+StateData::StateData(StateData&& other) noexcept
+    : fftLen(other.fftLen)
+    , input(other.input)
+    , reference(other.reference)
+    , windowedInput(other.windowedInput)
+    , windowedReference(other.windowedReference)
+    , fftInput(other.fftInput)
+    , fftReference(other.fftReference)
+    , avgMag(other.avgMag)
+    , smoothedAvgMag(other.smoothedAvgMag)
+    , transferFunction(other.transferFunction)
+    , smoothedTransferFunction(other.smoothedTransferFunction)
+    , impulseResponse(other.impulseResponse)
+    , smoothedImpulseResponse(other.smoothedImpulseResponse)
+    , psdEstimateInput(other.psdEstimateInput)
+    , psdEstimateReference(other.psdEstimateReference)
+    , csdEstimate(other.csdEstimate)
+    , coherence(other.coherence)
+    , smoothedCoherence(other.smoothedCoherence)
+    , fftDuration(other.fftDuration)
+    , sampleRate(other.sampleRate)
+    , discontinuous(other.discontinuous)
+    , reducedLoad(other.reducedLoad)
+    , acoustics(other.acoustics)
+    , arena(other.arena)
+    , arenaSize(other.arenaSize)
+    , ownsArena(other.ownsArena)
+{
+    other.arena = nullptr;
+    other.release();
+}
+
+StateData& StateData::operator=(const StateData& other) noexcept
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    if (arena == nullptr || fftLen != other.fftLen) {
+        release();
+        fftLen = other.fftLen;
+        allocate();
+    }
+    std::copy_n(other.arena, std::min(arenaSize, other.arenaSize), arena);
+    copyScalars(other);
+    return *this;
+}
+
+StateData& StateData::operator=(StateData&& other) noexcept
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    // keep our block if we can, somebody might have planned on it
+    if (arena != nullptr && fftLen == other.fftLen) {
+        return *this = static_cast<const StateData&>(other);
+    }
+
+    release();
+    fftLen = other.fftLen;
+    arena = other.arena;
+    arenaSize = other.arenaSize;
+    ownsArena = other.ownsArena;
+    input = other.input;
+    reference = other.reference;
+    windowedInput = other.windowedInput;
+    windowedReference = other.windowedReference;
+    fftInput = other.fftInput;
+    fftReference = other.fftReference;
+    avgMag = other.avgMag;
+    smoothedAvgMag = other.smoothedAvgMag;
+    transferFunction = other.transferFunction;
+    smoothedTransferFunction = other.smoothedTransferFunction;
+    impulseResponse = other.impulseResponse;
+    smoothedImpulseResponse = other.smoothedImpulseResponse;
+    psdEstimateInput = other.psdEstimateInput;
+    psdEstimateReference = other.psdEstimateReference;
+    csdEstimate = other.csdEstimate;
+    coherence = other.coherence;
+    smoothedCoherence = other.smoothedCoherence;
+    copyScalars(other);
+
+    other.arena = nullptr;
+    other.release();
+    return *this;
+}
+
+StateData::~StateData() noexcept
+{
+    release();
+}
+
+void StateData::reset() noexcept
+{
+    std::fill_n(arena, arenaSize, 0.0);
+    discontinuous = false;
+    reducedLoad = false;
+    acoustics = {};
+}
+
+size_t StateData::getMemoryUsage() const noexcept
+{
+    return arenaSize * sizeof(double);
+}
+
+const double* StateData::getBlock() const noexcept
+{
+    return arena;
+}
+
+size_t StateData::getBlockSize(size_t length) noexcept
+{
+    return length * (realProducts + 2 * complexProducts);
+}
+
+void StateData::allocate() noexcept
+{
+    arenaSize = getBlockSize(fftLen);
+    arena = arenaSize > 0 ? fftw_alloc_real(arenaSize) : nullptr;
+    ownsArena = true;
+    if (arena == nullptr) {
+        release();
+        return;
+    }
+    std::fill_n(arena, arenaSize, 0.0);
+    layout();
+}
+
+void StateData::layout() noexcept
+{
+    // hand out the block in processing order. fft lengths are powers of two, so every product stays aligned.
+    double* next = arena;
+    auto takeReal = [this, &next]() {
+        RealSpan span(next, fftLen);
+        next += fftLen; // NOLINT
+        return span;
+    };
+    auto takeComplex = [this, &next]() {
+        // std::complex<double> is laid out as two doubles, fftw relies on that as well. NOLINTNEXTLINE
+        ComplexSpan span(reinterpret_cast<Complex*>(next), fftLen);
+        next += 2 * fftLen; // NOLINT
+        return span;
+    };
+
+    // windowing
+    input = takeReal();
+    windowedInput = takeReal();
+    reference = takeReal();
+    windowedReference = takeReal();
+    // the dfts, and what is derived from them bin by bin
+    fftInput = takeComplex();
+    fftReference = takeComplex();
+    avgMag = takeReal();
+    transferFunction = takeComplex();
+    // psd and coherence
+    psdEstimateInput = takeReal();
+    psdEstimateReference = takeReal();
+    csdEstimate = takeComplex();
+    coherence = takeReal();
+    // impulse response
+    impulseResponse = takeReal();
+    smoothedImpulseResponse = takeReal();
+    // smoothing
+    smoothedAvgMag = takeReal();
+    smoothedTransferFunction = takeComplex();
+    smoothedCoherence = takeReal();
+}
+
+void StateData::release() noexcept
+{
+    if (arena != nullptr && ownsArena) {
+        fftw_free(arena);
+    }
+    arena = nullptr;
+    arenaSize = 0;
+    ownsArena = true;
+    fftLen = 0;
+    input = reference = windowedInput = windowedReference = {};
+    fftInput = fftReference = transferFunction = smoothedTransferFunction = csdEstimate = {};
+    avgMag = smoothedAvgMag = impulseResponse = smoothedImpulseResponse = {};
+    psdEstimateInput = psdEstimateReference = coherence = smoothedCoherence = {};
+}
+
+void StateData::copyScalars(const StateData& other) noexcept
+{
+    fftDuration = other.fftDuration;
+    sampleRate = other.sampleRate;
+    discontinuous = other.discontinuous;
+    reducedLoad = other.reducedLoad;
+    acoustics = other.acoustics;
+}
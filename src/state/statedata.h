@@ -18,67 +18,147 @@
 #ifndef laa_statedata_h
 #define laa_statedata_h
 
-#include "shared.h"
+#include "core.h"
+#include "dsp/span.h"
+#include "roomacoustics.h"
 
 /**
  * \brief Data of a state
+ *
+ * All products live in one aligned block of memory, the members are views into it.
+ * The block is laid out in the order the processing goes through it, so what one step reads and writes sits next to each other:
+ * time domain, dfts and what comes straight out of them, the psd estimates, the impulse response and finally the smoothed results.
+ * Copying a StateData copies that block in one go.
+ * Snapshot files store the block as it is, so changing the layout means bumping SnapshotFile::version.
  */
 struct StateData {
+    /// ctor. no products, fftLen is 0
+    StateData() noexcept = default;
+    /**
+     * \brief ctor. allocates all products, zeroed
+     * \param length number of samples
+     */
+    explicit StateData(size_t length) noexcept;
+    /**
+     * \brief ctor. uses a block somebody else owns, laid out like getBlock()
+     * \param length number of samples
+     * \param block getBlockSize(length) doubles, aligned for simd. has to outlive this.
+     */
+    StateData(size_t length, double* block) noexcept;
+    /// copies the whole block
+    StateData(const StateData& other) noexcept;
+    /// takes over the block
+    StateData(StateData&& other) noexcept;
+    /// copies the whole block. if the length matches, the block stays where it is, so fft plans pointing into it stay valid.
+    StateData& operator=(const StateData& other) noexcept;
+    /// like copying if the length matches, for the same reason. otherwise takes over the block.
+    StateData& operator=(StateData&& other) noexcept;
+    /// dtor
+    ~StateData() noexcept;
+
+    /**
+     * \brief Zero all products
+     */
+    void reset() noexcept;
+
+    /**
+     * \brief Memory used by the products
+     * \return size in bytes
+     */
+    [[nodiscard]] size_t getMemoryUsage() const noexcept;
+
+    /**
+     * \brief The block all products live in, for writing it out in one go
+     * \return the block, getBlockSize(fftLen) doubles. nullptr if there are no products.
+     */
+    [[nodiscard]] const double* getBlock() const noexcept;
+
+    /**
+     * \brief Size of the block for a length
+     * \param length number of samples
+     * \return size in doubles
+     */
+    [[nodiscard]] static size_t getBlockSize(size_t length) noexcept;
+
     /// Number of samples in this state
     size_t fftLen = 0;
     // raw input
     /// Unprocessed input
-    RealVec input = {};
+    RealSpan input = {};
     /// Unprocessed reference
-    RealVec reference = {};
+    RealSpan reference = {};
     // windowed input
     /// input, after the window filter was applied
-    RealVec windowedInput = {};
+    RealSpan windowedInput = {};
     /// reference, after the window filter was applied
-    RealVec windowedReference = {};
+    RealSpan windowedReference = {};
     // fft
     /// dft of the input
-    ComplexVec fftInput = {};
+    ComplexSpan fftInput = {};
     /// dft of the reference
-    ComplexVec fftReference = {};
+    ComplexSpan fftReference = {};
     /// averaged magnitude of fftInput
-    RealVec avgMag = {};
+    RealSpan avgMag = {};
     /// smoothed average magnitude of fftInput
-    RealVec smoothedAvgMag = {};
+    RealSpan smoothedAvgMag = {};
     // H and h
     /// transfer function
-    ComplexVec transferFunction = {};
+    ComplexSpan transferFunction = {};
     /// smoothed transfer function
-    ComplexVec smoothedTransferFunction = {};
+    ComplexSpan smoothedTransferFunction = {};
     /// idft of the tranfer function
-    RealVec impulseResponse = {};
+    RealSpan impulseResponse = {};
     /// smoothed impulseResponse
-    RealVec smoothedImpulseResponse = {};
+    RealSpan smoothedImpulseResponse = {};
     // coherence and PSD
     /// PSD estimate of the input
-    RealVec psdEstimateInput = {};
+    RealSpan psdEstimateInput = {};
     /// PSD estimate of the reference
-    RealVec psdEstimateReference = {};
+    RealSpan psdEstimateReference = {};
     /// Estimate of the csd
-    ComplexVec csdEstimate = {};
+    ComplexSpan csdEstimate = {};
     /// coherence
-    RealVec coherence = {};
+    RealSpan coherence = {};
     /// smoothed coherence
-    RealVec smoothedCoherence = {};
+    RealSpan smoothedCoherence = {};
 
     // this is here for convenience, to be filled in in various places
-    /// color to draw this state in. defaults to white
-    ImColor uniqueCol = 0xFFFFFFFF; // NOLINT white
-    /// name of this state
-    std::string name = "";
-    /// if this state is active
-    bool active = true;
-    /// if this state is visible
-    bool visible = true;
     /// the amount of time (in seconds) this states fft spans
     double fftDuration = 0.0;
     /// sample rate (in hz) of this state
     double sampleRate = 0.0;
+    /// true if the input of this state is not continuous (samples got lost while capturing it)
+    bool discontinuous = false;
+    /// true if this state was processed under reduced load: the coherence estimate is slid along instead of summed up per bin, and the smoothed products are the unsmoothed ones.
+    bool reducedLoad = false;
+    /// room acoustics of the impulse response. only worked out on request, see RoomAnalyzer. not kept in snapshot files.
+    RoomAcoustics acoustics = {};
+
+private:
+    /**
+     * \brief Allocate the block for fftLen and point the products into it
+     */
+    void allocate() noexcept;
+    /**
+     * \brief Point the products into the block
+     */
+    void layout() noexcept;
+    /**
+     * \brief Free the block and clear the products
+     */
+    void release() noexcept;
+    /**
+     * \brief Copy everything but the block itself
+     * \param other where from
+     */
+    void copyScalars(const StateData& other) noexcept;
+
+    /// the block. fftw_malloc, so it is aligned for simd
+    double* arena = nullptr;
+    /// size of the block in doubles
+    size_t arenaSize = 0;
+    /// false if the block belongs to somebody else, a mapped file for example
+    bool ownsArena = true;
 };
 
 #endif //laa_statedata_h
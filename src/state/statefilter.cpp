@@ -19,35 +19,52 @@
 
 #include "dsp/avg.h"
 
+std::string getStr(const StateWindowFilter& filter) noexcept
+{
+    switch (filter) {
+    case StateWindowFilter::None:
+        return "None";
+    case StateWindowFilter::Hamming:
+        return "Hamming";
+    case StateWindowFilter::Blackman:
+        return "Blackman";
+    }
+
+    return "";
+}
+
 StateFilterConfig::StateFilterConfig() noexcept
 {
+    // the history itself is sized on first use, so configs that never average (or only short lengths) stay small
     avgMagnitudes.resize(LAA_MAX_FFT_AVG, RealVec());
-    for (size_t i = 0; i < LAA_MAX_FFT_AVG; i++) {
-        avgMagnitudes[i].resize(LAA_MAX_FFT_LENGTH);
-    }
 }
 void StateFilterConfig::clearAvg() noexcept
 {
-    for (size_t i = 0; i < LAA_MAX_FFT_AVG; i++) {
-        for (size_t j = 0; j < LAA_MAX_FFT_LENGTH; j++) {
-            avgMagnitudes[i][j] = 0.0;
-        }
+    for (auto& magnitudes : avgMagnitudes) {
+        std::fill(magnitudes.begin(), magnitudes.end(), 0.0);
     }
 }
 
-void StateFilterConfig::filter(RealVec& inOut, size_t fftLen) noexcept
+void StateFilterConfig::filter(RealSpan& inOut, size_t fftLen, bool discontinuous) noexcept
 {
     if (avgCount == 0) {
         return;
     }
 
     if (fftLen != lastFftLen) {
+        for (auto& magnitudes : avgMagnitudes) {
+            magnitudes.resize(fftLen);
+        }
         clearAvg();
         lastFftLen = fftLen;
     }
 
+    // a rejected state does not take a slot in the history, it just gets the average of the others
+    bool reject = discontinuous && rejectDiscontinuous;
     for (size_t i = 0; i < fftLen; i++) {
-        avgMagnitudes[currAvg][i] = inOut[i];
+        if (!reject) {
+            avgMagnitudes[currAvg][i] = inOut[i];
+        }
         inOut[i] = 0.0;
         for (size_t avgI = 0; avgI < avgCount; avgI++) {
             inOut[i] += avgMagnitudes[avgI][i];
@@ -55,8 +72,12 @@ void StateFilterConfig::filter(RealVec& inOut, size_t fftLen) noexcept
         inOut[i] /= static_cast<double>(avgCount);
     }
 
+    if (reject) {
+        return;
+    }
+
     ++currAvg;
     if (currAvg >= avgCount) {
         currAvg = 0;
     }
-}
\ No newline at end of file
+}
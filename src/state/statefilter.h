@@ -18,7 +18,8 @@
 #ifndef laa_statefilter_h
 #define laa_statefilter_h
 
-#include "shared.h"
+#include "core.h"
+#include "dsp/span.h"
 
 /**
  * \brief Select a window filter that is run over the input
@@ -29,6 +30,13 @@ enum class StateWindowFilter {
     Blackman
 };
 
+/**
+ * \brief Convert the StateWindowFilter enum to a string
+ * \param filter StateWindowFilter to stringify
+ * \return filter as a string
+ */
+std::string getStr(const StateWindowFilter& filter) noexcept;
+
 /**
  * \brief Filter configuration for State
  *
@@ -60,13 +68,20 @@ struct StateFilterConfig {
     size_t currAvg = 0;
     /// used to make sure we scale vectors up/down properly and reset
     size_t lastFftLen = 0;
+    /// if true, discontinuous states do not go into the average
+    bool rejectDiscontinuous = true;
+    /// if true, State::calc() takes the cheap way to the coherence estimate and skips smoothing. see StateData::reducedLoad.
+    bool skipOptionalStages = false;
 
     /**
      * \brief Calculate the average of the avgCount past magnitudes
      * \param inOut the vector to operate on
      * \param fftLen the number of samples
+     * \param discontinuous true if inOut comes from a discontinuous state. See rejectDiscontinuous.
+     *
+     * If inOut is rejected, it is replaced by the average of what is already there.
      */
-    void filter(RealVec& inOut, size_t fftLen) noexcept;
+    void filter(RealSpan& inOut, size_t fftLen, bool discontinuous = false) noexcept;
 
     /**
      * \brief Clears all past data (on fftLen changes etc.)
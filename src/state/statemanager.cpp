@@ -16,6 +16,10 @@
  */
 
 #include "statemanager.h"
+#include "prefpath.h"
+#include "snapshotfile.h"
+#include <array>
+#include <ctime>
 #include <random>
 
 ImColor randColor()
@@ -35,39 +39,101 @@ ImColor randColor()
     return col;
 }
 
+// captures are compact, only the expanded ones take as much memory as a frame. see StateCache
+#ifdef LAA_GL_ES_2
+constexpr size_t maxCaptures = 32;
+constexpr size_t expandedCaptures = 2;
+#else
+constexpr size_t maxCaptures = 160;
+constexpr size_t expandedCaptures = 6;
+#endif
+
 void StateManager::update(AudioHandler& audioHandler)
 {
-    if (audioHandler.getFrameCount() > lastFrame) {
-        liveState = audioHandler.getStateData();
-    }
+    resizeLive(std::max(audioHandler.getChannelCount(), static_cast<size_t>(1)));
 
     ImGui::Begin("Snapshot Control", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoDecoration);
     ImGui::PushItemWidth(-1.0F);
 
-#ifdef LAA_GL_ES_2
-    size_t maxCaptures = 4;
-#else
-    size_t maxCaptures = 10;
-#endif
+    // scrubbing back through the history. the live channels show that frame, so it can be captured like any other.
+    bool refresh = false;
+    size_t historySize = audioHandler.getHistorySize();
+    if (historySize > 1) {
+        const auto& config = audioHandler.getConfig();
+        auto frameSeconds = config.samplesToSeconds(config.getHopSamples());
+        ImGui::TextWrapped("History: -%.1fs", static_cast<double>(historyAge) * frameSeconds);
+        // oldest on the left, live on the right
+        auto position = static_cast<int>(historySize - 1 - std::min(historyAge, historySize - 1));
+        refresh = ImGui::SliderInt("##historyAge", &position, 0, static_cast<int>(historySize) - 1, "");
+        historyAge = historySize - 1 - static_cast<size_t>(std::clamp(position, 0, static_cast<int>(historySize) - 1));
+    }
+
+    if (audioHandler.getFrameCount() > lastFrame) {
+        // while scrubbed back, stay on the same frame as new ones come in
+        if (historyAge > 0) {
+            historyAge += audioHandler.getFrameCount() - lastFrame;
+        }
+        lastFrame = audioHandler.getFrameCount();
+        refresh = true;
+    }
+    historyAge = std::min(historyAge, historySize > 0 ? historySize - 1 : 0);
+    if (refresh) {
+        // no copies, the channels all share the one frame the audio handler published
+        for (size_t channel = 0; channel < liveChannels.size(); ++channel) {
+            liveChannels[channel].data = historyAge == 0 ? audioHandler.getSnapshot(channel) : audioHandler.getHistorySnapshot(historyAge, channel);
+        }
+    }
+
+    // captures are compact, only the ones on screen are expanded. hidden ones give their full state back to the cache.
+    // expanding happens in the background, until it is done the capture just is not drawn.
+    for (auto& state : saved) {
+        if (state.compact == nullptr) {
+            continue;
+        }
+        if (!state.visible && !state.active) {
+            state.data = nullptr;
+        } else if (state.data == nullptr) {
+            state.data = expanded.get(state.compact);
+        }
+    }
+
+    takeTriggeredCaptures(audioHandler);
+
     if (saved.size() < maxCaptures && ImGui::Button("Capture")) {
-        auto copy = liveState;
-        copy.uniqueCol = randColor();
-        copy.active = false;
-        copy.visible = liveVisible;
-        saved.push_back(copy);
+        // every visible channel, so positions can be compared later on
+        for (const auto& live : liveChannels) {
+            if (!live.visible || live.data == nullptr || saved.size() >= maxCaptures) {
+                continue;
+            }
+            auto copy = live;
+            auto compact = std::make_shared<const CompactState>(*live.data, audioHandler.getWindowFilter());
+            copy.name += compact->isReducedLoad() ? " (reduced load)" : "";
+            // it is on screen right away, no need to expand what we already have
+            expanded.insert(*compact, *live.data);
+            copy.data = expanded.get(compact);
+            copy.compact = compact;
+            copy.uniqueCol = randColor();
+            copy.active = false;
+            addCapture(copy);
+        }
     }
 
-    if (ImGui::RadioButton("##liveRadio", liveActive)) {
-        deactivateAll();
-        liveActive = true;
+    int c = 0;
+    for (auto& live : liveChannels) {
+        c++;
+        ImGui::PushID(c);
+        if (ImGui::RadioButton("##liveRadio", live.active)) {
+            deactivateAll();
+            live.active = true;
+        }
+        ImGui::SameLine();
+        ImGui::ColorButton(live.name.c_str(), ImColor(live.uniqueCol));
+        ImGui::SameLine();
+        ImGui::Checkbox((live.name + "##liveData").c_str(), &live.visible);
+        ImGui::PopID();
     }
-    ImGui::SameLine();
-    ImGui::ColorButton("Live Data", liveState.uniqueCol);
-    ImGui::SameLine();
-    ImGui::Checkbox("Live Data##liveData", &liveVisible);
 
     auto iter = saved.begin();
-    int c = 0;
     while (iter != saved.end()) {
         c++;
         ImGui::PushID(c);
@@ -76,11 +142,24 @@ void StateManager::update(AudioHandler& audioHandler)
             iter->active = true;
         }
         ImGui::SameLine();
-        ImGui::ColorButton(iter->name.c_str(), iter->uniqueCol);
+        ImGui::ColorButton(iter->name.c_str(), ImColor(iter->uniqueCol));
         ImGui::SameLine();
         ImGui::Checkbox("##ShowliveData", &iter->visible);
         ImGui::SameLine();
+        if (!iter->derived && traceEnabled) {
+            ImGui::Checkbox("##traceMember", &iter->inTraceMath);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Use in Trace Math");
+            }
+            ImGui::SameLine();
+        }
         if (ImGui::Button("x")) {
+            // the average builds its sums again without it
+            if (iter->derived) {
+                traceEnabled = false;
+            } else {
+                traceAverage.remove(iter->id, &mathPool);
+            }
             iter = saved.erase(iter);
             if (iter == saved.end()) {
                 ImGui::PopID();
@@ -88,38 +167,300 @@ void StateManager::update(AudioHandler& audioHandler)
             }
         }
         ImGui::SameLine();
+        if (iter->compact != nullptr && iter->data == nullptr && (iter->visible || iter->active)) {
+            ImGui::TextDisabled("...");
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Expanding");
+            }
+            ImGui::SameLine();
+        }
         ImGui::InputText("##nameInput", &iter->name);
         ImGui::PopID();
         iter++;
     }
 
+    drawTraceMath();
+    updateTraceMath();
+
+    size_t captureMemory = expanded.getMemoryUsage();
+    for (const auto& state : saved) {
+        captureMemory += state.compact != nullptr ? state.compact->getMemoryUsage() : 0;
+    }
+    if (skippedTriggers > 0) {
+        ImGui::TextWrapped("%d triggered captures skipped, too many captures", static_cast<int>(skippedTriggers));
+    }
+    ImGui::TextWrapped("Capture Memory: %.1f MB", static_cast<double>(captureMemory) / (1024.0 * 1024.0));
+
+    ImGui::Separator();
+    ImGui::InputText("##snapshotPath", &snapshotPath);
+    if (saveThread.joinable() && !saving) {
+        saveThread.join();
+        snapshotError = saveError;
+    }
+    if (saving) {
+        ImGui::TextWrapped("Saving...");
+    } else if (ImGui::Button("Save")) {
+        saveCaptures();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load")) {
+        loadCaptures();
+    }
+    if (!snapshotError.empty()) {
+        ImGui::TextWrapped("%s", snapshotError.c_str());
+    }
+
     ImGui::PopItemWidth();
     ImGui::End();
-
-    liveState.active = liveActive;
-    liveState.visible = liveVisible;
 }
 
 const StateData& StateManager::getLive() const noexcept
 {
-    return liveState;
+    static const StateData empty = {};
+    const auto& live = liveChannels.front();
+    return live.data != nullptr ? *live.data : empty;
 }
 
-const std::list<StateData>& StateManager::getSaved() const noexcept
+const std::vector<DisplayState>& StateManager::getLiveChannels() const noexcept
+{
+    return liveChannels;
+}
+
+const std::list<DisplayState>& StateManager::getSaved() const noexcept
 {
     return saved;
 }
 
 StateManager::StateManager() noexcept
+    : expanded(expandedCaptures)
+    , snapshotPath(getPrefPath() + "/captures.laas")
+{
+    resizeLive(1);
+}
+
+StateManager::~StateManager() noexcept
 {
-    liveState.name = "Live";
-    liveState.active = true;
+    if (saveThread.joinable()) {
+        saveThread.join();
+    }
 }
 
 void StateManager::deactivateAll()
 {
-    liveActive = false;
+    for (auto& live : liveChannels) {
+        live.active = false;
+    }
+    for (auto& state : saved) {
+        state.active = false;
+    }
+}
+
+void StateManager::resizeLive(size_t channelCount)
+{
+    if (liveChannels.size() == channelCount) {
+        return;
+    }
+
+    // the first channel is what we always had: white, visible and active.
+    // the others get spread over the color wheel and start out hidden, so 32 channels dont flood the views.
+    size_t oldCount = liveChannels.size();
+    liveChannels.resize(channelCount);
+    for (size_t channel = 0; channel < channelCount; ++channel) {
+        auto& live = liveChannels[channel];
+        live.name = channelCount == 1 ? "Live" : "Live " + std::to_string(channel + 1);
+        if (channel > 0) {
+            live.uniqueCol = ImColor::HSV(static_cast<float>(channel) / static_cast<float>(channelCount), 0.6F, 1.0F);
+        }
+        if (channel >= oldCount) {
+            live.active = channel == 0 && oldCount == 0;
+            live.visible = channel == 0;
+        }
+    }
+}
+
+void StateManager::saveCaptures() noexcept
+{
+    std::vector<Snapshot> snapshots = {};
+    std::vector<std::shared_ptr<const CompactState>> compacts = {};
+    for (const auto& state : saved) {
+        Snapshot snapshot;
+        snapshot.data = state.data;
+        snapshot.name = state.name;
+        snapshot.color = state.uniqueCol;
+        snapshots.push_back(snapshot);
+        compacts.push_back(state.data == nullptr ? state.compact : nullptr);
+    }
+
+    // hidden captures have to be expanded for this, the file stores full states.
+    // that is a full calc for every one of them, so it happens next to the ui, spread over a pool that is only around for the save.
+    saving = true;
+    saveThread = std::thread([this, snapshots = std::move(snapshots), compacts = std::move(compacts), path = snapshotPath]() mutable {
+        WorkerPool pool;
+        pool.parallelFor(snapshots.size(), [&snapshots, &compacts](size_t index) {
+            if (compacts[index] != nullptr) {
+                snapshots[index].data = std::make_shared<const StateData>(compacts[index]->expand());
+            }
+        });
+
+        SnapshotFile file;
+        saveError = file.save(path, snapshots) ? "" : file.getError();
+        saving = false;
+    });
+}
+
+void StateManager::loadCaptures() noexcept
+{
+    SnapshotFile file;
+    if (!file.load(snapshotPath)) {
+        snapshotError = file.getError();
+        return;
+    }
+
+    // hidden, so a file with hundreds of captures is only read as far as somebody looks at it
+    for (const auto& snapshot : file.getSnapshots()) {
+        DisplayState state;
+        state.data = snapshot.data;
+        state.name = snapshot.name;
+        state.uniqueCol = snapshot.color;
+        state.active = false;
+        state.visible = false;
+        addCapture(state);
+    }
+    snapshotError.clear();
+}
+
+void StateManager::takeTriggeredCaptures(AudioHandler& audioHandler) noexcept
+{
+    // named after when they happened, sessions with triggers run for hours
+    auto now = std::time(nullptr);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    std::array<char, 16> timeString = {};
+    std::strftime(timeString.data(), timeString.size(), "%H:%M:%S", &local);
+
+    // hidden, there might be a lot of them and nobody is watching
+    for (auto& capture : audioHandler.takeTriggeredCaptures()) {
+        for (size_t channel = 0; channel < capture.channels.size(); ++channel) {
+            if (saved.size() >= maxCaptures) {
+                ++skippedTriggers;
+                continue;
+            }
+            DisplayState state;
+            state.compact = capture.channels[channel];
+            state.name = std::string(timeString.data()) + " " + capture.reason;
+            if (capture.channels.size() > 1) {
+                state.name += " (" + std::to_string(channel + 1) + ")";
+            }
+            state.name += state.compact->isReducedLoad() ? " (reduced load)" : "";
+            state.uniqueCol = randColor();
+            state.active = false;
+            state.visible = false;
+            addCapture(state);
+        }
+    }
+}
+
+void StateManager::addCapture(DisplayState state) noexcept
+{
+    state.id = nextCaptureId++;
+    saved.push_back(std::move(state));
+}
+
+std::shared_ptr<const StateData> StateManager::getFullData(const DisplayState& state) noexcept
+{
+    if (state.data != nullptr || state.compact == nullptr) {
+        return state.data;
+    }
+    return expanded.get(state.compact);
+}
+
+void StateManager::drawTraceMath() noexcept
+{
+    ImGui::Separator();
+    ImGui::Checkbox("Trace Math", &traceEnabled);
+    if (!traceEnabled) {
+        return;
+    }
+
+    if (ImGui::BeginCombo("##traceOperation", getStr(traceOperation).c_str())) {
+        for (auto operation : { TraceOperation::PowerAverage, TraceOperation::ComplexAverage, TraceOperation::CoherenceWeightedAverage, TraceOperation::Difference, TraceOperation::Ratio }) {
+            if (ImGui::Selectable(getStr(operation).c_str(), operation == traceOperation)) {
+                traceOperation = operation;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    if (isAverage(traceOperation)) {
+        ImGui::TextWrapped("Averaging %d ticked captures", static_cast<int>(traceAverage.getMemberCount()));
+    } else {
+        ImGui::TextWrapped("First ticked capture against the second");
+    }
+}
+
+void StateManager::updateTraceMath() noexcept
+{
+    // the averages keep running sums, so only the captures that were ticked or unticked are touched
     for (auto& state : saved) {
+        if (state.derived || state.inTraceMath == traceAverage.contains(state.id)) {
+            continue;
+        }
+        if (!state.inTraceMath) {
+            traceAverage.remove(state.id, &mathPool);
+            continue;
+        }
+        auto data = getFullData(state);
+        if (data != nullptr && !traceAverage.add(state.id, *data, &mathPool)) {
+            // a different length than the others, it can not go in
+            state.inTraceMath = false;
+        }
+    }
+
+    std::shared_ptr<const StateData> result = nullptr;
+    if (traceEnabled && isAverage(traceOperation)) {
+        result = traceAverage.getResult(traceOperation, &mathPool);
+    } else if (traceEnabled) {
+        std::vector<const DisplayState*> compared = {};
+        for (const auto& state : saved) {
+            if (!state.derived && state.inTraceMath && compared.size() < 2) {
+                compared.push_back(&state);
+            }
+        }
+        if (compared.size() == 2) {
+            auto key = std::make_tuple(compared[0]->id, compared[1]->id, traceOperation);
+            if (comparedResult == nullptr || key != comparedKey) {
+                auto first = getFullData(*compared[0]);
+                auto second = getFullData(*compared[1]);
+                comparedResult = first != nullptr && second != nullptr ? traceCompare(*first, *second, traceOperation, &mathPool) : nullptr;
+                comparedKey = key;
+            }
+            result = comparedResult;
+        }
+    }
+
+    // the result shows up as a capture of its own, so it can be looked at, named and saved like any other
+    auto derived = std::find_if(saved.begin(), saved.end(), [](const DisplayState& state) {
+        return state.derived;
+    });
+    if (result == nullptr) {
+        if (derived != saved.end()) {
+            saved.erase(derived);
+        }
+        return;
+    }
+    if (derived == saved.end()) {
+        DisplayState state;
+        state.derived = true;
+        state.uniqueCol = randColor();
         state.active = false;
+        addCapture(state);
+        derived = std::prev(saved.end());
+    }
+    if (derived->data != result) {
+        derived->data = result;
+        derived->name = getStr(traceOperation);
     }
 }
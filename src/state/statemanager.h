@@ -19,28 +19,107 @@
 #define laa_statemanager_h
 
 #include "audio/audiohandler.h"
+#include "shared.h"
+#include "state/compactstate.h"
+#include "state/tracemath.h"
+#include <atomic>
 #include <list>
+#include <thread>
+#include <tuple>
 
 ImColor randColor();
 
+/**
+ * \brief A state as the views see it: the data, and how to draw it
+ */
+struct DisplayState {
+    /// the data. live states share it with the audio handler, so it is never written to
+    std::shared_ptr<const StateData> data = nullptr;
+    /// captures made in this session. their data is only there while they are shown, see StateCache
+    std::shared_ptr<const CompactState> compact = nullptr;
+    /// identifies a capture for trace math. 0 for live states
+    uint64_t id = 0;
+    /// if this capture goes into the trace math
+    bool inTraceMath = false;
+    /// true for the trace math result. it is rebuilt whenever its members change.
+    bool derived = false;
+    /// color to draw this state in, packed like IM_COL32. defaults to white
+    uint32_t uniqueCol = 0xFFFFFFFF; // NOLINT white
+    /// name of this state
+    std::string name = "";
+    /// if this state is active
+    bool active = true;
+    /// if this state is visible
+    bool visible = true;
+};
+
 class StateManager {
 public:
     StateManager() noexcept;
-    ~StateManager() noexcept = default;
+    ~StateManager() noexcept;
     void update(AudioHandler& audioHandler);
 
     [[nodiscard]] const StateData& getLive() const noexcept;
 
-    [[nodiscard]] const std::list<StateData>& getSaved() const noexcept;
+    [[nodiscard]] const std::vector<DisplayState>& getLiveChannels() const noexcept;
+
+    [[nodiscard]] const std::list<DisplayState>& getSaved() const noexcept;
 
 private:
     void deactivateAll();
+    void resizeLive(size_t channelCount);
+    /// gives a capture an id and adds it
+    void addCapture(DisplayState state) noexcept;
+    /// the full data of a capture. nullptr while it is being expanded
+    std::shared_ptr<const StateData> getFullData(const DisplayState& state) noexcept;
+    /// brings the trace math in line with the captures, and the result with the trace math
+    void updateTraceMath() noexcept;
+    /// draws the trace math settings
+    void drawTraceMath() noexcept;
+    /// adds what the trigger rules of audioHandler captured
+    void takeTriggeredCaptures(AudioHandler& audioHandler) noexcept;
+    /// writes all captures to snapshotPath, in the background. see saving
+    void saveCaptures() noexcept;
+    /// adds the captures in snapshotPath
+    void loadCaptures() noexcept;
     size_t lastFrame = 0;
-    StateData liveState = {};
-    bool liveVisible = true;
-    bool liveActive = true;
+    /// how many frames back the live channels show. 0 for the newest frame.
+    size_t historyAge = 0;
+    /// one live state per measurement channel. they keep their ui settings across frames, the data is swapped out
+    std::vector<DisplayState> liveChannels = {};
+
+    /// captures own a copy of their data, holding on to a snapshot would keep its frame from being reused
+    std::list<DisplayState> saved = {};
+    /// full states of the captures that were shown last
+    StateCache expanded;
+
+    /// id of the next capture
+    uint64_t nextCaptureId = 1;
+    /// if the trace math result is shown
+    bool traceEnabled = false;
+    /// what the trace math does
+    TraceOperation traceOperation = TraceOperation::PowerAverage;
+    /// running averages over the captures that have inTraceMath set
+    TraceAverage traceAverage = {};
+    /// the last result of traceCompare()
+    std::shared_ptr<const StateData> comparedResult = nullptr;
+    /// ids and operation comparedResult was made for
+    std::tuple<uint64_t, uint64_t, TraceOperation> comparedKey = {};
+    /// trace math runs on the ui thread, this spreads it out
+    WorkerPool mathPool = {};
+    /// triggered captures that did not fit anymore
+    size_t skippedTriggers = 0;
 
-    std::list<StateData> saved = {};
+    /// file for save and load
+    std::string snapshotPath = {};
+    /// what went wrong on the last save or load
+    std::string snapshotError = {};
+    /// expands the hidden captures and writes them out
+    std::thread saveThread = {};
+    /// true while saveThread is busy
+    std::atomic<bool> saving = false;
+    /// what went wrong in saveThread. handed to snapshotError once it is done.
+    std::string saveError = {};
 };
 
 #endif //laa_statemanager_h
@@ -0,0 +1,285 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tracemath.h"
+#include "dsp/fftplan.h"
+#include "dsp/reduce.h"
+#include "dsp/smoothing.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+/// bins per job. large enough that handing out a range costs nothing next to working through it
+constexpr size_t binsPerRange = 8192;
+
+/**
+ * \brief Run job over [0, count) in ranges of binsPerRange, spread over pool
+ * \param count number of bins
+ * \param pool nullptr runs it all on the caller
+ * \param job called with the first bin and the number of bins of a range
+ */
+template <class Job>
+void forBinRanges(size_t count, WorkerPool* pool, const Job& job) noexcept
+{
+    size_t ranges = (count + binsPerRange - 1) / binsPerRange;
+    auto runRange = [count, &job](size_t range) {
+        size_t first = range * binsPerRange;
+        job(first, std::min(binsPerRange, count - first));
+    };
+    if (pool != nullptr && ranges > 1) {
+        pool->parallelFor(ranges, runRange);
+    } else {
+        for (size_t range = 0; range < ranges; ++range) {
+            runRange(range);
+        }
+    }
+}
+
+/// complex values as doubles, for the kernels. std::complex<double> is laid out as two doubles.
+const double* asReal(const Complex* values) noexcept
+{
+    return reinterpret_cast<const double*>(values); // NOLINT
+}
+
+/// complex values as doubles, for the kernels
+double* asReal(Complex* values) noexcept
+{
+    return reinterpret_cast<double*>(values); // NOLINT
+}
+
+/**
+ * \brief Everything that follows from the transfer function, magnitude and coherence of a result
+ * \param result the result, with transferFunction, avgMag and coherence filled in
+ */
+void finishTrace(StateData& result) noexcept
+{
+    // same as State does it: normalized idft of the transfer function. the plan keeps the input intact.
+    auto dFftLen = static_cast<double>(result.fftLen);
+    fftw_plan inversePlan = getBestFftPlan(result.fftLen, FftKind::ComplexToReal).load();
+    if (inversePlan != nullptr) {
+        // NOLINTNEXTLINE
+        fftw_execute_dft_c2r(inversePlan, reinterpret_cast<fftw_complex*>(result.transferFunction.data()), result.impulseResponse.data());
+    }
+    for (auto& value : result.impulseResponse) {
+        value /= dFftLen;
+    }
+    std::copy(result.impulseResponse.begin(), result.impulseResponse.end(), result.smoothedImpulseResponse.begin());
+
+    smooth(result.smoothedAvgMag, result.avgMag);
+    smooth(result.smoothedTransferFunction, result.transferFunction);
+    smooth(result.smoothedCoherence, result.coherence);
+}
+} // namespace
+
+std::string getStr(const TraceOperation& operation) noexcept
+{
+    switch (operation) {
+    case TraceOperation::PowerAverage:
+        return "Power Average";
+    case TraceOperation::ComplexAverage:
+        return "Complex Average";
+    case TraceOperation::CoherenceWeightedAverage:
+        return "Coherence Weighted Average";
+    case TraceOperation::Difference:
+        return "Difference";
+    case TraceOperation::Ratio:
+        return "Ratio";
+    }
+
+    return "";
+}
+
+bool isAverage(const TraceOperation& operation) noexcept
+{
+    return operation != TraceOperation::Difference && operation != TraceOperation::Ratio;
+}
+
+bool TraceAverage::add(uint64_t id, const StateData& data, WorkerPool* pool) noexcept
+{
+    if (contains(id) || data.fftLen == 0 || (!members.empty() && data.fftLen != fftLen)) {
+        return false;
+    }
+
+    if (members.empty()) {
+        fftLen = data.fftLen;
+        bins = fftLen / 2 + 1;
+        sampleRate = data.sampleRate;
+        fftDuration = data.fftDuration;
+        sumTransfer.assign(bins, 0.0);
+        sumTransferPower.assign(bins, 0.0);
+        sumWeightedTransfer.assign(bins, 0.0);
+        sumCoherence.assign(bins, 0.0);
+        sumMag.assign(bins, 0.0);
+        sumMagPower.assign(bins, 0.0);
+        sumWeightedMag.assign(bins, 0.0);
+    }
+
+    // a silent bin has a coherence of 0/0. it would stay in the sums for good, so it goes in as nothing.
+    Member member;
+    member.id = id;
+    member.values.resize(4 * bins);
+    forBinRanges(bins, pool, [this, &data, &member](size_t first, size_t count) {
+        auto finite = [](double value) { return std::isfinite(value) ? static_cast<float>(value) : 0.0F; };
+        for (size_t bin = first; bin < first + count; ++bin) {
+            member.values[2 * bin] = finite(data.transferFunction[bin].real());
+            member.values[2 * bin + 1] = finite(data.transferFunction[bin].imag());
+            member.values[2 * bins + bin] = finite(data.avgMag[bin]);
+            member.values[3 * bins + bin] = finite(data.coherence[bin]);
+        }
+    });
+    members.push_back(std::move(member));
+    accumulateMember(members.back(), pool);
+    return true;
+}
+
+bool TraceAverage::remove(uint64_t id, WorkerPool* pool) noexcept
+{
+    auto iter = std::find_if(members.begin(), members.end(), [id](const Member& member) { return member.id == id; });
+    if (iter == members.end()) {
+        return false;
+    }
+
+    members.erase(iter);
+    if (members.empty()) {
+        clear();
+        return true;
+    }
+
+    // taking it back out would leave rounding errors behind, so the sums start over with the members left
+    for (auto* sums : { &sumTransferPower, &sumCoherence, &sumMag, &sumMagPower, &sumWeightedMag }) {
+        std::fill(sums->begin(), sums->end(), 0.0);
+    }
+    std::fill(sumTransfer.begin(), sumTransfer.end(), 0.0);
+    std::fill(sumWeightedTransfer.begin(), sumWeightedTransfer.end(), 0.0);
+    for (const auto& member : members) {
+        accumulateMember(member, pool);
+    }
+    return true;
+}
+
+void TraceAverage::clear() noexcept
+{
+    members.clear();
+    fftLen = 0;
+    bins = 0;
+    result = nullptr;
+}
+
+bool TraceAverage::contains(uint64_t id) const noexcept
+{
+    return std::any_of(members.begin(), members.end(), [id](const Member& member) { return member.id == id; });
+}
+
+size_t TraceAverage::getMemberCount() const noexcept
+{
+    return members.size();
+}
+
+std::shared_ptr<const StateData> TraceAverage::getResult(TraceOperation operation, WorkerPool* pool) noexcept
+{
+    if (members.empty() || !isAverage(operation)) {
+        return nullptr;
+    }
+    if (result != nullptr && resultOperation == operation) {
+        return result;
+    }
+
+    auto newResult = std::make_shared<StateData>(fftLen);
+    newResult->sampleRate = sampleRate;
+    newResult->fftDuration = fftDuration;
+    auto& data = *newResult;
+    auto scale = 1.0 / static_cast<double>(members.size());
+    forBinRanges(bins, pool, [this, &data, operation, scale](size_t first, size_t count) {
+        for (size_t bin = first; bin < first + count; ++bin) {
+            data.coherence[bin] = sumCoherence[bin] * scale;
+            switch (operation) {
+            case TraceOperation::PowerAverage: {
+                // the magnitude of the rms, and the phase of the complex average
+                auto phase = std::arg(sumTransfer[bin]);
+                data.transferFunction[bin] = std::polar(std::sqrt(sumTransferPower[bin] * scale), phase);
+                data.avgMag[bin] = std::sqrt(sumMagPower[bin] * scale);
+                break;
+            }
+            case TraceOperation::CoherenceWeightedAverage:
+                // where nothing is coherent, every member counts the same
+                if (sumCoherence[bin] > 0.0) {
+                    data.transferFunction[bin] = sumWeightedTransfer[bin] / sumCoherence[bin];
+                    data.avgMag[bin] = sumWeightedMag[bin] / sumCoherence[bin];
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                data.transferFunction[bin] = sumTransfer[bin] * scale;
+                data.avgMag[bin] = sumMag[bin] * scale;
+                break;
+            }
+        }
+    });
+    finishTrace(data);
+
+    result = newResult;
+    resultOperation = operation;
+    return result;
+}
+
+void TraceAverage::accumulateMember(const Member& member, WorkerPool* pool) noexcept
+{
+    forBinRanges(bins, pool, [this, &member](size_t first, size_t count) {
+        // the kernels work on doubles
+        const float* values = member.values.data();
+        std::vector<double> transfer(values + 2 * first, values + 2 * (first + count)); // NOLINT
+        std::vector<double> mag(values + 2 * bins + first, values + 2 * bins + first + count); // NOLINT
+        std::vector<double> coherence(values + 3 * bins + first, values + 3 * bins + first + count); // NOLINT
+        accumulate(asReal(sumTransfer.data() + first), transfer.data(), 1.0, 2 * count); // NOLINT
+        accumulateMagSquared(sumTransferPower.data() + first, transfer.data(), 1.0, count); // NOLINT
+        accumulateWeightedComplex(asReal(sumWeightedTransfer.data() + first), transfer.data(), coherence.data(), 1.0, count); // NOLINT
+        accumulate(sumCoherence.data() + first, coherence.data(), 1.0, count); // NOLINT
+        accumulate(sumMag.data() + first, mag.data(), 1.0, count); // NOLINT
+        accumulateSquares(sumMagPower.data() + first, mag.data(), 1.0, count); // NOLINT
+        accumulateWeighted(sumWeightedMag.data() + first, mag.data(), coherence.data(), 1.0, count); // NOLINT
+    });
+    result = nullptr;
+}
+
+std::shared_ptr<const StateData> traceCompare(const StateData& first, const StateData& second, TraceOperation operation, WorkerPool* pool) noexcept
+{
+    if (isAverage(operation) || first.fftLen == 0 || first.fftLen != second.fftLen) {
+        return nullptr;
+    }
+
+    auto newResult = std::make_shared<StateData>(first.fftLen);
+    newResult->sampleRate = first.sampleRate;
+    newResult->fftDuration = first.fftDuration;
+    auto& data = *newResult;
+    bool ratio = operation == TraceOperation::Ratio;
+    forBinRanges(first.fftLen, pool, [&data, &first, &second, ratio](size_t firstBin, size_t count) {
+        for (size_t bin = firstBin; bin < firstBin + count; ++bin) {
+            if (ratio) {
+                data.transferFunction[bin] = first.transferFunction[bin] / second.transferFunction[bin];
+                data.avgMag[bin] = first.avgMag[bin] / second.avgMag[bin];
+            } else {
+                data.transferFunction[bin] = first.transferFunction[bin] - second.transferFunction[bin];
+                data.avgMag[bin] = std::abs(first.avgMag[bin] - second.avgMag[bin]);
+            }
+            data.coherence[bin] = std::min(first.coherence[bin], second.coherence[bin]);
+        }
+    });
+    finishTrace(data);
+
+    return newResult;
+}
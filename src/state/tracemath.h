@@ -0,0 +1,172 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_tracemath_h
+#define laa_tracemath_h
+
+#include "statedata.h"
+#include "workerpool.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * \brief What to derive from a set of captures
+ */
+enum class TraceOperation {
+    /// rms of the magnitudes, phase of the complex average
+    PowerAverage,
+    /// mean of the complex transfer functions
+    ComplexAverage,
+    /// complex average, every bin weighted by its coherence
+    CoherenceWeightedAverage,
+    /// first capture minus the second
+    Difference,
+    /// first capture divided by the second
+    Ratio
+};
+
+/**
+ * \brief Convert the TraceOperation enum to a string
+ * \param operation TraceOperation to stringify
+ * \return operation as a string
+ */
+std::string getStr(const TraceOperation& operation) noexcept;
+
+/**
+ * \brief Check if an operation is an average over all members, or works on two captures
+ * \param operation the operation
+ * \return true for the averages
+ */
+bool isAverage(const TraceOperation& operation) noexcept;
+
+/**
+ * \brief Averages over a set of captures, kept up to date as captures come and go
+ *
+ * Running sums over all members are kept for every average at once, so adding a member is one pass over its bins,
+ * and switching between the averages does not need the members again.
+ * Every member keeps what it put into the sums, as floats: 16 bytes per bin, for the fftLen/2+1 bins that carry anything.
+ * Removing a member builds the sums again from the ones left, so nothing of it stays behind, not even rounding errors.
+ * Both those passes and building the result are split into bin ranges, which are spread over a WorkerPool.
+ */
+class TraceAverage {
+public:
+    /**
+     * \brief Add a capture
+     * \param id identifies the capture, for remove() and contains()
+     * \param data the capture. only what goes into the sums is kept. non-finite bins go in as zero.
+     * \param pool spreads the work. nullptr runs it all on the caller.
+     * \return false if it is already in, or its length does not match the other members
+     */
+    bool add(uint64_t id, const StateData& data, WorkerPool* pool) noexcept;
+
+    /**
+     * \brief Remove a capture
+     * \param id what add() got
+     * \param pool spreads the work. nullptr runs it all on the caller.
+     * \return false if it was not in
+     */
+    bool remove(uint64_t id, WorkerPool* pool) noexcept;
+
+    /**
+     * \brief Remove all captures
+     */
+    void clear() noexcept;
+
+    /**
+     * \brief Check if a capture is in
+     * \param id what add() got
+     * \return true if it is in
+     */
+    [[nodiscard]] bool contains(uint64_t id) const noexcept;
+
+    /**
+     * \brief Number of captures
+     * \return member count
+     */
+    [[nodiscard]] size_t getMemberCount() const noexcept;
+
+    /**
+     * \brief The average. Only built again if the members or the operation changed.
+     * \param operation which average
+     * \param pool spreads the work. nullptr runs it all on the caller.
+     * \return the result. nullptr without members, or if operation is not an average.
+     */
+    std::shared_ptr<const StateData> getResult(TraceOperation operation, WorkerPool* pool) noexcept;
+
+private:
+    /**
+     * \brief What a member put into the sums
+     */
+    struct Member {
+        /// what add() got
+        uint64_t id = 0;
+        /// the transfer function (real and imaginary part per bin), then the magnitude, then the coherence. bins values each.
+        std::vector<float> values = {};
+    };
+
+    /**
+     * \brief Add a member to the sums
+     * \param member the member
+     * \param pool spreads the work
+     */
+    void accumulateMember(const Member& member, WorkerPool* pool) noexcept;
+
+    /// the members
+    std::vector<Member> members = {};
+    /// length of all members
+    size_t fftLen = 0;
+    /// bins in the sums. the ones above fftLen/2 carry nothing.
+    size_t bins = 0;
+    /// sample rate of the first member
+    double sampleRate = 0.0;
+    /// fft duration of the first member
+    double fftDuration = 0.0;
+    /// sum of the transfer functions
+    ComplexVec sumTransfer = {};
+    /// sum of the squared transfer function magnitudes
+    RealVec sumTransferPower = {};
+    /// sum of the transfer functions, weighted by coherence
+    ComplexVec sumWeightedTransfer = {};
+    /// sum of the coherence, the weights of the weighted sums
+    RealVec sumCoherence = {};
+    /// sum of the magnitudes
+    RealVec sumMag = {};
+    /// sum of the squared magnitudes
+    RealVec sumMagPower = {};
+    /// sum of the magnitudes, weighted by coherence
+    RealVec sumWeightedMag = {};
+    /// the last result
+    std::shared_ptr<const StateData> result = nullptr;
+    /// operation result was built for
+    TraceOperation resultOperation = TraceOperation::ComplexAverage;
+};
+
+/**
+ * \brief Difference or ratio of two captures
+ * \param first the first capture
+ * \param second what is taken from it, or what it is divided by
+ * \param operation TraceOperation::Difference or TraceOperation::Ratio
+ * \param pool spreads the work. nullptr runs it all on the caller.
+ * \return the result. nullptr if the lengths do not match or operation is an average.
+ *
+ * The coherence of the result is the lower of the two, it is only as trustworthy as the worse one.
+ */
+std::shared_ptr<const StateData> traceCompare(const StateData& first, const StateData& second, TraceOperation operation, WorkerPool* pool) noexcept;
+
+#endif //laa_tracemath_h
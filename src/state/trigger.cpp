@@ -0,0 +1,122 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trigger.h"
+#include "dsp/reduce.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+
+std::string getStr(const TriggerKind& kind) noexcept
+{
+    switch (kind) {
+    case TriggerKind::Coherence:
+        return "Coherence";
+    case TriggerKind::Level:
+        return "Level";
+    case TriggerKind::Interval:
+        return "Interval";
+    }
+
+    return "";
+}
+
+double TriggerRule::measure(const StateData& data) const noexcept
+{
+    if (kind == TriggerKind::Interval || data.fftLen == 0 || data.sampleRate <= 0.0) {
+        return 0.0;
+    }
+
+    // bins of the band, only the lower half of the spectrum means anything
+    auto binWidth = data.sampleRate / static_cast<double>(data.fftLen);
+    auto toBin = [binWidth, &data](double frequency) {
+        return std::min(static_cast<size_t>(std::max(frequency, 0.0) / binWidth), data.fftLen / 2);
+    };
+    size_t first = toBin(lowFrequency);
+    size_t last = std::max(toBin(highFrequency), first + 1);
+    size_t count = last - first;
+
+    if (kind == TriggerKind::Coherence) {
+        return sum(data.coherence.data() + first, count) / static_cast<double>(count); // NOLINT
+    }
+
+    // both halves of the spectrum, so a full scale sine comes out at about -3dB
+    double power = 2.0 * sumSquares(data.avgMag.data() + first, count); // NOLINT
+    return 10.0 * std::log10(std::max(power, 1e-30));
+}
+
+std::string TriggerRule::toString() const noexcept
+{
+    std::array<char, 96> text = {};
+    switch (kind) {
+    case TriggerKind::Coherence:
+        std::snprintf(text.data(), text.size(), "Coherence %.0f-%.0fHz > %.2f", lowFrequency, highFrequency, threshold);
+        break;
+    case TriggerKind::Level:
+        std::snprintf(text.data(), text.size(), "Level %.0f-%.0fHz > %.1fdB", lowFrequency, highFrequency, threshold);
+        break;
+    case TriggerKind::Interval:
+        std::snprintf(text.data(), text.size(), "Every %.0fs", threshold);
+        break;
+    }
+
+    return text.data();
+}
+
+Trigger::Trigger(const TriggerRule& newRule) noexcept
+    : rule(newRule)
+{
+}
+
+bool Trigger::check(const StateData& data, double time) noexcept
+{
+    if (!started) {
+        // nothing fires on the very first frame, a value that is already above the threshold did not cross it.
+        // intervals count from here, the others may fire right away
+        started = true;
+        lastFired = rule.kind == TriggerKind::Interval ? time : time - rule.holdOff;
+        wasAbove = rule.kind != TriggerKind::Interval && rule.measure(data) > rule.threshold;
+        return false;
+    }
+    if (!rule.enabled) {
+        return false;
+    }
+
+    if (rule.kind == TriggerKind::Interval) {
+        if (time - lastFired < std::max(rule.threshold, 0.0)) {
+            return false;
+        }
+        lastFired = time;
+        return true;
+    }
+
+    bool above = rule.measure(data) > rule.threshold;
+    bool crossed = above && !wasAbove;
+    wasAbove = above;
+    if (!crossed || time - lastFired < rule.holdOff) {
+        return false;
+    }
+    lastFired = time;
+    return true;
+}
+
+const TriggerRule& Trigger::getRule() const noexcept
+{
+    return rule;
+}
@@ -0,0 +1,115 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_trigger_h
+#define laa_trigger_h
+
+#include "statedata.h"
+
+#include <string>
+
+/**
+ * \brief What a trigger rule looks at
+ */
+enum class TriggerKind {
+    /// mean coherence in a band goes above the threshold
+    Coherence,
+    /// level in a band, in dB, goes above the threshold
+    Level,
+    /// every threshold seconds
+    Interval
+};
+
+/**
+ * \brief Convert the TriggerKind enum to a string
+ * \param kind TriggerKind to stringify
+ * \return kind as a string
+ */
+std::string getStr(const TriggerKind& kind) noexcept;
+
+/**
+ * \brief A rule for capturing frames without anybody pressing a button
+ */
+struct TriggerRule {
+    /// what to look at
+    TriggerKind kind = TriggerKind::Coherence;
+    /// measurement channel to look at
+    size_t channel = 0;
+    /// lower edge of the band, in Hz
+    double lowFrequency = 200.0;
+    /// upper edge of the band, in Hz
+    double highFrequency = 2000.0;
+    /// coherence (0 to 1), level (dB) or interval (seconds)
+    double threshold = 0.9;
+    /// seconds after firing in which the rule does not fire again
+    double holdOff = 5.0;
+    /// off rules are skipped
+    bool enabled = true;
+
+    /**
+     * \brief The value the rule compares against threshold
+     * \param data a processed state
+     * \return mean coherence or level in the band. 0 for Interval.
+     */
+    [[nodiscard]] double measure(const StateData& data) const noexcept;
+
+    /**
+     * \brief Describe the rule, for naming what it captured
+     * \return something like "Coherence 200-2000Hz > 0.90"
+     */
+    [[nodiscard]] std::string toString() const noexcept;
+};
+
+/**
+ * \brief A rule, and what it needs to remember between frames
+ *
+ * Level and coherence rules fire when their value goes above the threshold, not while it stays there.
+ */
+class Trigger {
+public:
+    /**
+     * \brief ctor
+     * \param newRule the rule
+     */
+    explicit Trigger(const TriggerRule& newRule) noexcept;
+
+    /**
+     * \brief Check a frame
+     * \param data the rules channel of the frame
+     * \param time seconds since some fixed point, only differences matter
+     * \return true if the frame should be captured
+     */
+    bool check(const StateData& data, double time) noexcept;
+
+    /**
+     * \brief The rule
+     * \return the rule
+     */
+    [[nodiscard]] const TriggerRule& getRule() const noexcept;
+
+private:
+    /// the rule
+    TriggerRule rule;
+    /// if the value was above the threshold on the last frame
+    bool wasAbove = true;
+    /// time of the last firing
+    double lastFired = 0.0;
+    /// false until the first check, so intervals start counting from there
+    bool started = false;
+};
+
+#endif //laa_trigger_h
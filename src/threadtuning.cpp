@@ -0,0 +1,177 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "threadtuning.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+#ifdef __linux__
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+std::string getStr(const ThreadPriority& priority) noexcept
+{
+    switch (priority) {
+    case ThreadPriority::Normal:
+        return "Normal";
+    case ThreadPriority::Fifo:
+        return "Realtime (FIFO)";
+    case ThreadPriority::RoundRobin:
+        return "Realtime (RR)";
+    }
+
+    return "";
+}
+
+#ifdef __linux__
+// does the actual work for both overloads of applyThreadTuning
+static std::string applyToHandle(pthread_t handle, const ThreadTuning& tuning) noexcept
+{
+    std::string error;
+
+    // if we are not allowed to, the thread just stays where it is. no reason to give up on the affinity.
+    int policy = SCHED_OTHER;
+    sched_param param = {};
+    if (tuning.priority != ThreadPriority::Normal) {
+        policy = tuning.priority == ThreadPriority::Fifo ? SCHED_FIFO : SCHED_RR;
+        param.sched_priority = std::clamp(tuning.priorityLevel, sched_get_priority_min(policy), sched_get_priority_max(policy));
+    }
+    int res = pthread_setschedparam(handle, policy, &param);
+    if (res != 0) {
+        error += std::string("Priority: ") + std::strerror(res);
+        if (res == EPERM) {
+            error += " (needs CAP_SYS_NICE or an rtprio limit)";
+        }
+        error += ". ";
+    }
+
+    // an empty mask means no restrictions, so allow every cpu there is
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (tuning.affinityMask == 0 || (cpu < ThreadTuning::maxCpus && (tuning.affinityMask & (1ULL << cpu)) != 0)) {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    res = pthread_setaffinity_np(handle, sizeof(cpus), &cpus);
+    if (res != 0) {
+        error += std::string("Affinity: ") + std::strerror(res) + ". ";
+    }
+
+    return error;
+}
+#endif
+
+std::string applyThreadTuning(std::thread& thread, const ThreadTuning& tuning) noexcept
+{
+#ifdef __linux__
+    return applyToHandle(thread.native_handle(), tuning);
+#else
+    static_cast<void>(thread);
+    return applyThreadTuning(tuning);
+#endif
+}
+
+std::string applyThreadTuning(const ThreadTuning& tuning) noexcept
+{
+#ifdef __linux__
+    return applyToHandle(pthread_self(), tuning);
+#else
+    if (tuning.priority == ThreadPriority::Normal && tuning.affinityMask == 0) {
+        return "";
+    }
+    return "Thread tuning is not supported on this platform. ";
+#endif
+}
+
+std::string lockProcessMemory(bool lock) noexcept
+{
+#ifdef __linux__
+    // the state pool grows from the processing thread until the history is full, so most of it comes after the lock.
+    // locking what comes later too makes allocations over the memlock limit fail, so that is only done without a limit.
+    rlimit limit = {};
+    bool unlimited = geteuid() == 0 || (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY);
+    int res = lock ? mlockall(unlimited ? MCL_CURRENT | MCL_FUTURE : MCL_CURRENT) : munlockall();
+    if (res != 0) {
+        std::string error = std::string("Memory lock: ") + std::strerror(errno);
+        if (errno == ENOMEM || errno == EPERM) {
+            error += " (check the memlock limit)";
+        }
+        return error + ". ";
+    }
+    if (lock && !unlimited) {
+        return "Memory lock: only what is allocated so far, the memlock limit is not unlimited. ";
+    }
+    return "";
+#else
+    if (!lock) {
+        return "";
+    }
+    return "Memory locking is not supported on this platform. ";
+#endif
+}
+
+unsigned int getCpuCount() noexcept
+{
+    return std::clamp(std::thread::hardware_concurrency(), 1U, ThreadTuning::maxCpus);
+}
+
+std::string getCpuName() noexcept
+{
+    std::string name;
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    // the brand string is spread over three cpuid leaves, 16 bytes each
+    std::array<unsigned int, 12> brand = {};
+    if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004) {
+        for (unsigned int leaf = 0; leaf < 3; ++leaf) {
+            __get_cpuid(0x80000002 + leaf, &brand[leaf * 4], &brand[leaf * 4 + 1], &brand[leaf * 4 + 2], &brand[leaf * 4 + 3]);
+        }
+        name.assign(reinterpret_cast<const char*>(brand.data()), brand.size() * sizeof(unsigned int)); // NOLINT
+        name = name.c_str();
+    }
+#endif
+#ifdef __linux__
+    // everything else on linux, arm mostly
+    std::ifstream cpuInfo("/proc/cpuinfo");
+    std::string line;
+    while (name.empty() && std::getline(cpuInfo, line)) {
+        auto colon = line.find(':');
+        if (colon != std::string::npos && (line.rfind("model name", 0) == 0 || line.rfind("Hardware", 0) == 0)) {
+            name = line.substr(colon + 1);
+        }
+    }
+#endif
+
+    // vendors pad the name with spaces
+    auto first = name.find_first_not_of(' ');
+    auto last = name.find_last_not_of(' ');
+    if (first == std::string::npos) {
+        return "Unknown CPU";
+    }
+    return name.substr(first, last - first + 1);
+}
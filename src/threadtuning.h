@@ -0,0 +1,105 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_threadtuning_h
+#define laa_threadtuning_h
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+/**
+ * \brief Scheduling class for a thread
+ */
+enum class ThreadPriority {
+    /// whatever the os does by default
+    Normal,
+    /// SCHED_FIFO: runs until it blocks or something more important comes along
+    Fifo,
+    /// SCHED_RR: like Fifo, but shares time with threads of the same priority
+    RoundRobin
+};
+
+/**
+ * \brief Convert the ThreadPriority enum to a string
+ * \param priority ThreadPriority to stringify
+ * \return priority as a string
+ */
+std::string getStr(const ThreadPriority& priority) noexcept;
+
+/**
+ * \brief Scheduling and cpu placement for a thread
+ *
+ * All of this is opt-in. The defaults leave the thread alone.
+ * Only implemented on linux, elsewhere applying anything but the defaults reports an error.
+ */
+struct ThreadTuning {
+    /// Lowest realtime priority level
+    static constexpr int minPriorityLevel = 1;
+    /// Highest realtime priority level
+    static constexpr int maxPriorityLevel = 99;
+    /// Number of cpus an affinity mask can address
+    static constexpr unsigned int maxCpus = 64;
+
+    /// scheduling class
+    ThreadPriority priority = ThreadPriority::Normal;
+    /// priority level within Fifo and RoundRobin, minPriorityLevel..maxPriorityLevel
+    int priorityLevel = 10;
+    /// one bit per cpu the thread may run on. 0 means all of them.
+    uint64_t affinityMask = 0;
+};
+
+/**
+ * \brief Apply tuning to a thread
+ * \param thread the thread
+ * \param tuning what to apply
+ * \return empty on success, otherwise what went wrong. The thread keeps running either way.
+ */
+std::string applyThreadTuning(std::thread& thread, const ThreadTuning& tuning) noexcept;
+
+/**
+ * \brief Apply tuning to the calling thread
+ * \param tuning what to apply
+ * \return empty on success, otherwise what went wrong. The thread keeps running either way.
+ */
+std::string applyThreadTuning(const ThreadTuning& tuning) noexcept;
+
+/**
+ * \brief Lock all memory the process has into ram, or unlock it again
+ * \param lock true to lock, false to unlock
+ * \return empty on success, otherwise what went wrong
+ *
+ * If the memlock limit is unlimited (or we are root), everything allocated later is locked as well.
+ * That is all of the history once it filled up, fftLen * 176 bytes per frame and channel, plus captures and the ui.
+ * With a limit, allocating past it would fail, so only what is allocated right now is locked, and the result says so.
+ * Call it again after allocating something big that should be locked.
+ */
+std::string lockProcessMemory(bool lock) noexcept;
+
+/**
+ * \brief Number of cpus, capped to ThreadTuning::maxCpus
+ * \return cpu count
+ */
+unsigned int getCpuCount() noexcept;
+
+/**
+ * \brief Model name of the cpu, as the cpu or the os reports it
+ * \return the name. "Unknown CPU" if there is no way to find out.
+ */
+std::string getCpuName() noexcept;
+
+#endif //laa_threadtuning_h
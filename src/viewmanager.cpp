@@ -16,6 +16,7 @@
  */
 
 #include "viewmanager.h"
+#include "dsp/fftplan.h"
 
 float sidebarWidth(ImVec2 windowSize) noexcept
 {
@@ -34,15 +35,35 @@ float halfHeight(ImVec2 windowSize) noexcept
     return windowSize.y / 2.0F;
 }
 
+ViewManager::ViewManager(std::chrono::steady_clock::time_point launchTime) noexcept
+{
+    setupThread = std::thread([this, launchTime]() {
+        audioHandler = std::make_unique<AudioHandler>(launchTime);
+        audioReady = true;
+    });
+}
+
+ViewManager::~ViewManager() noexcept
+{
+    if (setupThread.joinable()) {
+        setupThread.join();
+    }
+}
+
 void ViewManager::update(ImVec2 windowSize) noexcept
 {
+    // the views just show nothing until there is data, only the sidebar needs the audio handler
     ImGui::SetNextWindowPos(ImVec2(0.0F, 0.0F));
     ImGui::SetNextWindowSize(ImVec2(sidebarWidth(windowSize), halfHeight(windowSize)));
-    audioHandler.update();
+    if (audioReady) {
+        audioHandler->update();
 
-    ImGui::SetNextWindowPos(ImVec2(0.0F, halfHeight(windowSize)));
-    ImGui::SetNextWindowSize(ImVec2(sidebarWidth(windowSize), halfHeight(windowSize)));
-    stateManager.update(audioHandler);
+        ImGui::SetNextWindowPos(ImVec2(0.0F, halfHeight(windowSize)));
+        ImGui::SetNextWindowSize(ImVec2(sidebarWidth(windowSize), halfHeight(windowSize)));
+        stateManager.update(*audioHandler);
+    } else {
+        drawStartup();
+    }
 
     drawSelectorAndContent(windowSize, 0.0F);
     drawSelectorAndContent(windowSize, halfHeight(windowSize));
@@ -83,8 +104,29 @@ void ViewManager::drawSelectorAndContent(ImVec2 windowSize, float offset) noexce
         coherenceView.update(stateManager, idHint);
         ImGui::EndTabItem();
     }
+    if (ImGui::BeginTabItem("Room")) {
+        roomView.update(stateManager, audioReady ? audioHandler.get() : nullptr, idHint);
+        ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Spectrogram")) {
+        spectrogramView.update(audioReady ? audioHandler.get() : nullptr, idHint);
+        ImGui::EndTabItem();
+    }
 
     ImGui::EndTabBar();
     ImGui::PopID();
     ImGui::End();
 }
+
+void ViewManager::drawStartup() noexcept
+{
+    ImGui::Begin("Audio Settings", nullptr, ImGuiWindowFlags_NoDecoration);
+    ImGui::TextWrapped("Setting up audio...");
+    size_t pendingPlans = getPendingFftPlans();
+    size_t finishedPlans = getFinishedFftPlans();
+    if (pendingPlans > 0) {
+        ImGui::TextWrapped("Optimizing ffts: %d/%d", static_cast<int>(finishedPlans), static_cast<int>(finishedPlans + pendingPlans));
+        ImGui::ProgressBar(static_cast<float>(finishedPlans) / static_cast<float>(finishedPlans + pendingPlans));
+    }
+    ImGui::End();
+}
@@ -24,18 +24,48 @@
 #include "irview.h"
 #include "magview.h"
 #include "phaseview.h"
+#include "roomview.h"
 #include "shared.h"
 #include "signalview.h"
+#include "spectrogramview.h"
 #include "state/statemanager.h"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
 class ViewManager {
 public:
+    /**
+     * \brief ctor. Sets up the audio in the background, the views work right away.
+     * \param launchTime when the program started, for the startup stats
+     */
+    explicit ViewManager(std::chrono::steady_clock::time_point launchTime) noexcept;
+    /// dtor. waits for the setup if it is still going
+    ~ViewManager() noexcept;
+    /// deleted
+    ViewManager(const ViewManager&) = delete;
+    /// deleted
+    ViewManager(ViewManager&&) = delete;
+    /// deleted
+    ViewManager& operator=(const ViewManager&) = delete;
+    /// deleted
+    ViewManager& operator=(ViewManager&&) = delete;
+
     void update(ImVec2 windowSize) noexcept;
 
 private:
     void drawSelectorAndContent(ImVec2 windowSize, float offset) noexcept;
+    /// stands in for the audio settings while the audio is set up
+    void drawStartup() noexcept;
 
-    AudioHandler audioHandler = {};
+    /// probing devices can take a while, so this is made on setupThread
+    std::unique_ptr<AudioHandler> audioHandler = nullptr;
+    /// makes audioHandler
+    std::thread setupThread = {};
+    /// true once audioHandler can be used
+    std::atomic<bool> audioReady = false;
     StateManager stateManager = {};
     SignalView signalView = {};
     MagView fftView = {};
@@ -43,6 +73,8 @@ private:
     IrView irView = {};
     FreqView freqView = {};
     CoherenceView coherenceView = {};
+    SpectrogramView spectrogramView = {};
+    RoomView roomView = {};
 };
 
 #endif //laa_viewmanager_h
@@ -0,0 +1,148 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workerpool.h"
+
+/// index of the calling thread in its pool. 0 for threads that are not in any.
+static thread_local size_t currentThreadIndex = 0;
+/// the pool the calling thread belongs to. nullptr for threads that are not in any.
+static thread_local const WorkerPool* currentPool = nullptr;
+
+WorkerPool::WorkerPool() noexcept
+    : WorkerPool(0)
+{
+}
+
+WorkerPool::WorkerPool(size_t threadCount) noexcept
+{
+    if (threadCount == 0) {
+        // the caller works along, so leave one core for it
+        size_t cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 0;
+    }
+
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([this, i]() {
+            currentThreadIndex = i + 1;
+            currentPool = this;
+            this->worker();
+        });
+    }
+}
+
+WorkerPool::~WorkerPool() noexcept
+{
+    lock.lock();
+    terminate = true;
+    lock.unlock();
+    wake.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const Job& job) noexcept
+{
+    if (count == 0) {
+        return;
+    }
+
+    // nothing to gain from waking anyone up
+    if (threads.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            job(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> runGuard(runLock);
+
+    std::unique_lock<std::mutex> guard(lock);
+    currentJob = &job;
+    jobCount = count;
+    nextIndex = 0;
+    busyWorkers = threads.size();
+    ++generation;
+    guard.unlock();
+    wake.notify_all();
+
+    // we are not just waiting around
+    drain();
+
+    guard.lock();
+    finished.wait(guard, [this]() {
+        return busyWorkers == 0;
+    });
+    currentJob = nullptr;
+}
+
+size_t WorkerPool::getThreadCount() const noexcept
+{
+    return threads.size();
+}
+
+size_t WorkerPool::getCurrentThreadIndex() const noexcept
+{
+    // threads of other pools have indices of their own, they count as outsiders here
+    return currentPool == this ? currentThreadIndex : 0;
+}
+
+std::string WorkerPool::applyTuning(const ThreadTuning& tuning) noexcept
+{
+    // they all fail for the same reason, so one message is enough
+    std::string error;
+    for (auto& thread : threads) {
+        auto threadError = applyThreadTuning(thread, tuning);
+        if (error.empty()) {
+            error = threadError;
+        }
+    }
+
+    return error;
+}
+
+void WorkerPool::worker() noexcept
+{
+    size_t doneGeneration = 0;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this, doneGeneration]() {
+            return terminate || generation != doneGeneration;
+        });
+        if (terminate) {
+            return;
+        }
+
+        doneGeneration = generation;
+        guard.unlock();
+        drain();
+        guard.lock();
+
+        --busyWorkers;
+        if (busyWorkers == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void WorkerPool::drain() noexcept
+{
+    for (size_t i = nextIndex++; i < jobCount; i = nextIndex++) {
+        (*currentJob)(i);
+    }
+}
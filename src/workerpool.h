@@ -0,0 +1,117 @@
+/*
+ * This file is part of LAA
+ * Copyright (c) 2020 Malte Kießling
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef laa_workerpool_h
+#define laa_workerpool_h
+
+#include "threadtuning.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief A fixed set of threads that run index based jobs
+ *
+ * The thread calling parallelFor() works along, so a pool with no threads at all just runs everything inline.
+ */
+class WorkerPool {
+public:
+    /// a job. called once for every index
+    using Job = std::function<void(size_t index)>;
+
+    /// ctor. one thread less than there are cores
+    WorkerPool() noexcept;
+    /**
+     * \brief ctor
+     * \param threadCount number of threads to spin up. 0 means one less than the number of cores.
+     */
+    explicit WorkerPool(size_t threadCount) noexcept;
+    /// dtor. joins all threads
+    ~WorkerPool() noexcept;
+    /// deleted
+    WorkerPool(const WorkerPool&) = delete;
+    /// deleted
+    WorkerPool(WorkerPool&&) = delete;
+    /// deleted
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    /// deleted
+    WorkerPool& operator=(WorkerPool&&) = delete;
+
+    /**
+     * \brief Run job for every index in 0..count and wait until all of them are done
+     * \param count number of indices
+     * \param job the job to run
+     *
+     * Indices are handed out one by one, so uneven jobs still balance out.
+     * Calls from different threads are serialized. Never call it from inside a job of the same pool, that deadlocks.
+     */
+    void parallelFor(size_t count, const Job& job) noexcept;
+
+    /**
+     * \brief Number of threads in the pool, not counting the caller of parallelFor
+     * \return thread count
+     */
+    [[nodiscard]] size_t getThreadCount() const noexcept;
+
+    /**
+     * \brief Which thread of this pool the calling thread is. Lets jobs keep per thread scratch space.
+     * \return 1..getThreadCount() for threads of this pool, 0 for any other thread, threads of other pools included
+     */
+    [[nodiscard]] size_t getCurrentThreadIndex() const noexcept;
+
+    /**
+     * \brief Apply priority and affinity to all threads of the pool
+     * \param tuning what to apply
+     * \return empty on success, otherwise what went wrong
+     */
+    std::string applyTuning(const ThreadTuning& tuning) noexcept;
+
+private:
+    /// thread main
+    void worker() noexcept;
+    /// grab indices of the current job until there are none left
+    void drain() noexcept;
+
+    /// the threads
+    std::vector<std::thread> threads = {};
+    /// serializes parallelFor
+    std::mutex runLock = {};
+    /// protects everything below
+    std::mutex lock = {};
+    /// wakes up the workers for a new job
+    std::condition_variable wake = {};
+    /// wakes up parallelFor when the workers are done
+    std::condition_variable finished = {};
+    /// the current job. only valid while parallelFor runs
+    const Job* currentJob = nullptr;
+    /// number of indices of the current job
+    size_t jobCount = 0;
+    /// next index to hand out
+    std::atomic<size_t> nextIndex = 0;
+    /// counts up for every job, so workers know if they already did the current one
+    size_t generation = 0;
+    /// number of workers still busy with the current job
+    size_t busyWorkers = 0;
+    /// kills off the workers
+    bool terminate = false;
+};
+
+#endif //laa_workerpool_h